@@ -0,0 +1,39 @@
+# Ruby Integer <-> GMP::Integer conversion benchmark.
+#
+# Compares the limb-level conversions (GMP::Integer.new(Integer), #to_i and
+# mixed arithmetic with Bignum operands) against the decimal string
+# round-trip they replaced, for operands from 64 bits up to 10M bits.
+#
+# Run it from the directory where the extension was built:
+#   ruby -I. bench/conversion.rb
+
+require 'benchmark'
+require 'gmp'
+
+SIZES = [64, 256, 1_024, 16_384, 262_144, 1_048_576, 10_485_760]
+
+# Runs the block enough times to take a measurable amount of time, and
+# returns the average time per call in microseconds
+def measure
+	n = 1
+	loop do
+		t = Benchmark.realtime { n.times { yield } }
+		return t * 1_000_000 / n if t > 0.2 || n >= 1 << 20
+		n *= 4
+	end
+end
+
+printf("%10s %14s %14s %14s %14s %14s\n", "bits", "new(Integer)",
+       "new(to_s)", "to_i", "to_s.to_i", "z + Bignum")
+
+SIZES.each do |bits|
+	big = (1 << (bits - 1)) + rand(1 << (bits - 2))
+	z = GMP::Integer.new(big)
+	
+	printf("%10d %14.2f %14.2f %14.2f %14.2f %14.2f\n", bits,
+	       measure { GMP::Integer.new(big) },
+	       measure { GMP::Integer.new(big.to_s) },
+	       measure { z.to_i },
+	       measure { z.to_s.to_i },
+	       measure { z + big })
+end
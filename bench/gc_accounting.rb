@@ -0,0 +1,39 @@
+# Peak RSS with and without GC accounting of GMP's limb memory.
+#
+# Repeatedly multiplies a large GMP::Integer, dropping every product, and
+# reports the peak resident set size (VmHWM) and number of collections of a
+# child process run with GC accounting off and on. Without accounting, the
+# GC only sees the small wrapper objects and lets the garbage limbs pile up.
+#
+# Run it from the directory where the extension was built (Linux only):
+#   ruby -I. bench/gc_accounting.rb
+
+require 'rbconfig'
+
+BITS = [1_048_576, 4_194_304, 16_777_216]
+ITERATIONS = 200
+
+CHILD = <<'CODE'
+require 'gmp'
+bits, iterations = ARGV.map(&:to_i)
+x = GMP::Integer.new((1 << bits) - 1)
+iterations.times { |i| x * (i + 1) }
+puts [File.read('/proc/self/status')[/VmHWM:\s*(\d+)/, 1], GC.count].join(' ')
+CODE
+
+# Runs the workload in a fresh interpreter, returning [peak RSS in kB, GCs]
+def run(bits, accounting)
+	env = { 'RGMP_GC_ACCOUNTING' => accounting ? '1' : '0' }
+	out = IO.popen([env, RbConfig.ruby, *$:.map { |d| "-I#{d}" }, '-e', CHILD,
+	                bits.to_s, ITERATIONS.to_s], &:read)
+	out.split.map(&:to_i)
+end
+
+printf("%10s %14s %8s %14s %8s\n", "bits", "RSS off (kB)", "GCs",
+       "RSS on (kB)", "GCs")
+
+BITS.each do |bits|
+	off = run(bits, false)
+	on = run(bits, true)
+	printf("%10d %14d %8d %14d %8d\n", bits, off[0], off[1], on[0], on[1])
+end
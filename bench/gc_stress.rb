@@ -0,0 +1,48 @@
+# GC stress benchmark: a long-lived Hash of GMP::Integer values.
+#
+# Builds a Hash with 10M GMP::Integer values (or as many as given on the
+# command line), promotes it to the old generation, then times minor GCs
+# while short-lived garbage is being allocated. Write-barrier-unprotected
+# ("shady") values would all sit in the remembered set and be rescanned on
+# every minor GC; protected ones are skipped once they are old.
+#
+# Run it from the directory where the extension was built:
+#   ruby -I. bench/gc_stress.rb [entries]
+
+require 'benchmark'
+require 'gmp'
+
+ENTRIES = (ARGV[0] || 10_000_000).to_i
+MINOR_GCS = 50
+
+build = Benchmark.realtime do
+	$table = {}
+	ENTRIES.times { |i| $table[i] = GMP::Integer.new(i * 1_000_003) }
+end
+
+# A few full GCs promote the table and its values to the old generation
+4.times { GC.start }
+
+def minor_gc_time
+	Benchmark.realtime do
+		MINOR_GCS.times do
+			10_000.times { Object.new }
+			GC.start(full_mark: false)
+		end
+	end / MINOR_GCS
+end
+
+compact = GC.respond_to?(:compact) ? Benchmark.realtime { GC.compact } : nil
+stat = GC.stat
+
+printf("%-36s %12d\n", "entries", ENTRIES)
+printf("%-36s %12.2f\n", "build time (s)", build)
+printf("%-36s %12.3f\n", "avg minor GC (ms)", minor_gc_time * 1000)
+printf("%-36s %12.3f\n", "full GC (ms)", Benchmark.realtime { GC.start } * 1000)
+printf("%-36s %12.3f\n", "GC.compact (ms)", compact * 1000) if compact
+printf("%-36s %12d\n", "old objects", stat[:old_objects])
+printf("%-36s %12d\n", "remembered WB-unprotected objects",
+       stat[:remembered_wb_unprotected_objects])
+
+# The values must survive compaction intact
+raise "corrupted table" unless $table[ENTRIES - 1].to_i == (ENTRIES - 1) * 1_000_003
@@ -0,0 +1,236 @@
+# GMP::Integer vs Ruby Integer benchmark suite.
+#
+# Times GMP::Integer's arithmetic (+, -, *, /, %, **), bitwise (<<, >>, &,
+# |, ^) and number-theoretic (powermod, gcd, lcm, sqrt, root, fac, fib)
+# operations and its conversions (to_s, new(String)) against the equivalent
+# Ruby Integer code, for operand sizes from 64 bits up to
+# 100M bits, and prints the results as JSON on stdout (progress goes to
+# stderr). For each case, "crossover_bits" is the smallest measured size from
+# which GMP stays faster than Ruby for every larger size, or null if it never
+# does. All times are in microseconds per call, including the Ruby/C boundary
+# costs (argument checks, result object allocation).
+#
+# Sizes are the operand size in bits; for fac and fib they are the size of the
+# result instead. Each case has its own size cap, since e.g. a 100M-bit
+# powermod would take hours, and once a single call of one side exceeds
+# BENCH_BUDGET seconds, larger sizes are skipped for that side (recorded as
+# null).
+#
+# Run it from the directory where the extension was built:
+#   ruby -I. bench/integer.rb > integer.json
+#
+# Environment:
+#   BENCH_MAX_BITS  largest size to try (default 100_000_000)
+#   BENCH_ONLY      comma-separated case names to run (default: all)
+#   BENCH_BUDGET    seconds allowed for a single call (default 10)
+
+require 'benchmark'
+require 'json'
+require 'rbconfig'
+require 'gmp'
+
+MAX_BITS = Integer(ENV.fetch('BENCH_MAX_BITS', 100_000_000))
+BUDGET = Float(ENV.fetch('BENCH_BUDGET', 10))
+ONLY = ENV['BENCH_ONLY'] && ENV['BENCH_ONLY'].split(',')
+
+SIZES = [64, 256, 1_024, 4_096, 16_384, 65_536, 262_144, 1_048_576,
+         4_194_304, 16_777_216, 67_108_864, 100_000_000].select { |b| b <= MAX_BITS }
+
+# A random odd number of exactly the given number of bits
+def random_bits(bits)
+	(1 << (bits - 1)) | rand(1 << (bits - 1)) | 1
+end
+
+# Smallest k such that k! has at least the given number of bits
+def factorial_argument(bits)
+	k, log = 1, 0.0
+	while log < bits
+		k += 1
+		log += Math.log2(k)
+	end
+	k
+end
+
+# Integer n-th root by Newton's iteration from above, as the Ruby baseline for
+# GMP::Integer.root
+def ruby_root(a, n)
+	x = 1 << ((a.bit_length + n - 1) / n)
+	loop do
+		y = ((n - 1) * x + a / x ** (n - 1)) / n
+		return x if y >= x
+		x = y
+	end
+end
+
+# Fibonacci by fast doubling, as the Ruby baseline for GMP::Integer.fib
+def ruby_fib(n)
+	a, b = 0, 1
+	n.bit_length.downto(1) do |i|
+		c = a * ((b << 1) - a)
+		d = a * a + b * b
+		a, b = (n[i - 1] == 1) ? [d, c + d] : [c, d]
+	end
+	a
+end
+
+# Each case maps a size to [gmp callable, ruby callable]
+CASES = {
+	'+' => [MAX_BITS, lambda { |bits|
+		a, b = random_bits(bits), random_bits(bits)
+		za, zb = GMP::Integer.new(a), GMP::Integer.new(b)
+		[-> { za + zb }, -> { a + b }]
+	}],
+	'-' => [MAX_BITS, lambda { |bits|
+		a, b = random_bits(bits), random_bits(bits)
+		za, zb = GMP::Integer.new(a), GMP::Integer.new(b)
+		[-> { za - zb }, -> { a - b }]
+	}],
+	'*' => [MAX_BITS, lambda { |bits|
+		a, b = random_bits(bits), random_bits(bits)
+		za, zb = GMP::Integer.new(a), GMP::Integer.new(b)
+		[-> { za * zb }, -> { a * b }]
+	}],
+	'/' => [MAX_BITS, lambda { |bits|
+		a, b = random_bits(2 * bits), random_bits(bits)
+		za, zb = GMP::Integer.new(a), GMP::Integer.new(b)
+		[-> { za / zb }, -> { a / b }]
+	}],
+	'%' => [MAX_BITS, lambda { |bits|
+		a, b = random_bits(2 * bits), random_bits(bits)
+		za, zb = GMP::Integer.new(a), GMP::Integer.new(b)
+		[-> { za % zb }, -> { a % b }]
+	}],
+	'<<' => [MAX_BITS, lambda { |bits|
+		a = random_bits(bits)
+		za = GMP::Integer.new(a)
+		[-> { za << bits }, -> { a << bits }]
+	}],
+	'>>' => [MAX_BITS, lambda { |bits|
+		a = random_bits(bits)
+		za = GMP::Integer.new(a)
+		[-> { za >> (bits / 2) }, -> { a >> (bits / 2) }]
+	}],
+	'&' => [MAX_BITS, lambda { |bits|
+		a, b = random_bits(bits), random_bits(bits)
+		za, zb = GMP::Integer.new(a), GMP::Integer.new(b)
+		[-> { za & zb }, -> { a & b }]
+	}],
+	'|' => [MAX_BITS, lambda { |bits|
+		a, b = random_bits(bits), random_bits(bits)
+		za, zb = GMP::Integer.new(a), GMP::Integer.new(b)
+		[-> { za | zb }, -> { a | b }]
+	}],
+	'^' => [MAX_BITS, lambda { |bits|
+		a, b = random_bits(bits), random_bits(bits)
+		za, zb = GMP::Integer.new(a), GMP::Integer.new(b)
+		[-> { za ^ zb }, -> { a ^ b }]
+	}],
+	'**' => [MAX_BITS / 8, lambda { |bits|
+		a = random_bits(bits)
+		za = GMP::Integer.new(a)
+		[-> { za ** 7 }, -> { a ** 7 }]
+	}],
+	'powermod' => [65_536, lambda { |bits|
+		a, e, m = random_bits(bits), random_bits(bits), random_bits(bits)
+		za, ze, zm = GMP::Integer.new(a), GMP::Integer.new(e), GMP::Integer.new(m)
+		[-> { GMP::Integer.powermod(za, ze, zm) }, -> { a.pow(e, m) }]
+	}],
+	'gcd' => [MAX_BITS, lambda { |bits|
+		a, b = random_bits(bits), random_bits(bits)
+		za, zb = GMP::Integer.new(a), GMP::Integer.new(b)
+		[-> { GMP::Integer.gcd(za, zb) }, -> { a.gcd(b) }]
+	}],
+	'lcm' => [MAX_BITS, lambda { |bits|
+		a, b = random_bits(bits), random_bits(bits)
+		za, zb = GMP::Integer.new(a), GMP::Integer.new(b)
+		[-> { GMP::Integer.lcm(za, zb) }, -> { a.lcm(b) }]
+	}],
+	'sqrt' => [MAX_BITS, lambda { |bits|
+		a = random_bits(bits)
+		za = GMP::Integer.new(a)
+		[-> { GMP::Integer.sqrt(za) }, -> { Integer.sqrt(a) }]
+	}],
+	'root' => [MAX_BITS, lambda { |bits|
+		a = random_bits(bits)
+		za = GMP::Integer.new(a)
+		[-> { GMP::Integer.root(za, 3) }, -> { ruby_root(a, 3) }]
+	}],
+	'fac' => [MAX_BITS, lambda { |bits|
+		k = factorial_argument(bits)
+		[-> { GMP::Integer.fac(k) }, -> { (1..k).inject(1, :*) }]
+	}],
+	'fib' => [MAX_BITS, lambda { |bits|
+		n = (bits / Math.log2((1 + Math.sqrt(5)) / 2)).ceil
+		[-> { GMP::Integer.fib(n) }, -> { ruby_fib(n) }]
+	}],
+	'to_s' => [MAX_BITS, lambda { |bits|
+		a = random_bits(bits)
+		za = GMP::Integer.new(a)
+		[-> { za.to_s }, -> { a.to_s }]
+	}],
+	'new(String)' => [MAX_BITS, lambda { |bits|
+		s = random_bits(bits).to_s
+		[-> { GMP::Integer.new(s) }, -> { Integer(s) }]
+	}],
+}
+
+# Runs the callable enough times to take a measurable amount of time, and
+# returns the average time per call in microseconds, or nil if a single call
+# exceeds the budget
+def measure(callable)
+	n = 1
+	loop do
+		t = Benchmark.realtime { n.times { callable.call } }
+		return nil if n == 1 && t > BUDGET
+		return (t * 1_000_000 / n).round(3) if t > 0.2 || n >= 1 << 20
+		n *= 4
+	end
+end
+
+# Smallest size from which GMP is faster for all larger sizes; a size where
+# only Ruby ran out of budget counts as a GMP win
+def crossover(sizes, gmp, ruby)
+	result = nil
+	sizes.each_index.reverse_each do |i|
+		next if gmp[i].nil? && ruby[i].nil?
+		break if gmp[i].nil? || (ruby[i] && ruby[i] <= gmp[i])
+		result = sizes[i]
+	end
+	result
+end
+
+results = {}
+
+CASES.each do |name, (cap, setup)|
+	next if ONLY && !ONLY.include?(name)
+
+	sizes = SIZES.select { |bits| bits <= cap }
+	gmp_times, ruby_times = [], []
+	gmp_done = ruby_done = false
+
+	sizes.each do |bits|
+		$stderr.printf("%-12s %10d bits\n", name, bits)
+		gmp, ruby = setup.call(bits)
+		gmp_times << (gmp_done ? nil : measure(gmp))
+		ruby_times << (ruby_done ? nil : measure(ruby))
+		gmp_done ||= gmp_times.last.nil?
+		ruby_done ||= ruby_times.last.nil?
+		GC.start
+	end
+
+	results[name] = {
+		sizes: sizes,
+		gmp_us: gmp_times,
+		ruby_us: ruby_times,
+		speedup: gmp_times.zip(ruby_times).map { |g, r| g && r && (r / g).round(3) },
+		crossover_bits: crossover(sizes, gmp_times, ruby_times),
+	}
+end
+
+puts JSON.pretty_generate({
+	ruby: RUBY_DESCRIPTION,
+	ruby_bignum_uses_gmp: RbConfig::CONFIG['LIBS'].to_s.include?('gmp'),
+	gmp_version: GMP::GMP_VERSION,
+	budget_seconds: BUDGET,
+	results: results,
+})
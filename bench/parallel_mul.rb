@@ -0,0 +1,70 @@
+# GMP::Integer.parallel_mul scaling benchmark.
+#
+# Times GMP::Integer.parallel_mul on two random operands of the same size,
+# for 1 up to N threads, against a plain single-threaded multiplication
+# (GMP.parallel_threshold = nil), and prints the results as JSON on stdout
+# (progress goes to stderr). Speedups are relative to the single-threaded
+# multiplication. All times are in seconds per call (best of BENCH_REPEAT).
+#
+# Run it from the directory where the extension was built:
+#   ruby -I. bench/parallel_mul.rb > parallel_mul.json
+#
+# Environment:
+#   BENCH_LIMBS    comma-separated operand sizes in limbs
+#                  (default 65536,262144,1048576,4194304)
+#   BENCH_THREADS  largest thread count to try (default: GMP.threads)
+#   BENCH_REPEAT   calls per measurement (default 3)
+
+require 'benchmark'
+require 'etc'
+require 'json'
+require 'gmp'
+
+LIMBS = ENV.fetch('BENCH_LIMBS', '65536,262144,1048576,4194304').split(',').map { |l| Integer(l) }
+MAX_THREADS = Integer(ENV.fetch('BENCH_THREADS', GMP.threads))
+REPEAT = Integer(ENV.fetch('BENCH_REPEAT', 3))
+
+# 1, 2, 4, ... up to MAX_THREADS, plus MAX_THREADS itself
+THREADS = (0..).lazy.map { |i| 1 << i }.take_while { |t| t < MAX_THREADS }.to_a | [MAX_THREADS]
+
+# A random number of exactly the given number of limbs
+def random_limbs(limbs)
+	bits = 64 * limbs
+	GMP::Integer.new((1 << (bits - 1)) | rand(1 << (bits - 1)))
+end
+
+def best_time
+	(1..REPEAT).map { Benchmark.realtime { yield } }.min.round(6)
+end
+
+results = {}
+
+LIMBS.each do |limbs|
+	a, b = random_limbs(limbs), random_limbs(limbs)
+
+	$stderr.printf("%10d limbs, serial\n", limbs)
+	threshold = GMP.parallel_threshold
+	GMP.parallel_threshold = nil
+	serial = best_time { a * b }
+	GMP.parallel_threshold = threshold
+
+	times = THREADS.map do |threads|
+		$stderr.printf("%10d limbs, %3d threads\n", limbs, threads)
+		best_time { GMP::Integer.parallel_mul(a, b, threads: threads) }
+	end
+
+	results[limbs] = {
+		serial_s: serial,
+		threads: THREADS,
+		parallel_s: times,
+		speedup: times.map { |t| (serial / t).round(3) },
+	}
+	GC.start
+end
+
+puts JSON.pretty_generate({
+	ruby: RUBY_DESCRIPTION,
+	gmp_version: GMP::GMP_VERSION,
+	processors: Etc.nprocessors,
+	results: results,
+})
@@ -0,0 +1,53 @@
+# GMP::Rational accumulation benchmark: allocating operators vs in-place.
+#
+# Sums a harmonic-like series of rationals (1/k scaled by a numerator of the
+# given size) with `acc = acc + x` and with `acc.add!(x)`, and accumulates
+# products with `acc = acc + x * y` against `acc.addmul(x, y)`. Reports the
+# time per step and the number of objects allocated over the whole run.
+#
+# Run it from the directory where the extension was built:
+#   ruby -I. bench/rational_inplace.rb
+
+require 'benchmark'
+require 'gmp'
+
+SIZES = [64, 1_024, 16_384]
+STEPS = 20_000
+
+# Returns [microseconds per step, objects allocated] for the block
+def measure
+	GC.start
+	before = GC.stat(:total_allocated_objects)
+	t = Benchmark.realtime { yield }
+	[t * 1_000_000 / STEPS, GC.stat(:total_allocated_objects) - before]
+end
+
+printf("%8s %12s %10s %12s %10s %12s %10s %12s %10s\n", "bits",
+       "a = a + x", "objs", "a.add!(x)", "objs",
+       "a = a + x*y", "objs", "a.addmul", "objs")
+
+SIZES.each do |bits|
+	num = GMP::Integer.new((1 << (bits - 1)) + 1)
+	terms = (1..64).map { |k| GMP::Rational.new("#{num}/#{k}") }
+	factors = (1..64).map { |k| GMP::Integer.new(2 * k + 1) }
+	
+	plain = measure do
+		acc = GMP::Rational.new("0")
+		STEPS.times { |i| acc = acc + terms[i & 63] }
+	end
+	inplace = measure do
+		acc = GMP::Rational.new("0")
+		STEPS.times { |i| acc.add!(terms[i & 63]) }
+	end
+	fused_plain = measure do
+		acc = GMP::Rational.new("0")
+		STEPS.times { |i| acc = acc + terms[i & 63] * factors[i & 63] }
+	end
+	fused = measure do
+		acc = GMP::Rational.new("0")
+		STEPS.times { |i| acc.addmul(terms[i & 63], factors[i & 63]) }
+	end
+	
+	printf("%8d %12.2f %10d %12.2f %10d %12.2f %10d %12.2f %10d\n", bits,
+	       *plain, *inplace, *fused_plain, *fused)
+end
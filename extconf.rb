@@ -13,4 +13,12 @@ if not have_library('gmp')
 	raise "Missing GMP library"
 end
 
+# Lets the GC accounting hooks tell whether they may call ruby_xmalloc
+have_func('ruby_thread_has_gvl_p')
+
+# Instrumentation counters behind GMP.stats (ruby extconf.rb --with-stats)
+if with_config('stats')
+	$CFLAGS += ' -DRGMP_STATS'
+end
+
 create_makefile('gmp')
@@ -17,11 +17,683 @@
 */
 
 #include "rgmp.h"
+#include "ruby/thread.h"
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
 
-VALUE mGMP;
+VALUE mGMP, mGMPPrimes;
 VALUE cGMPInteger, cGMPRational, cGMPFloat;
+VALUE cGMPModulus, cGMPModInt, cGMPPowmTable, cGMPCRTBasis;
+VALUE eGMPDeadlineExceeded;
 VALUE gmpversion, mpfrversion;
 
+////////////////////////////////////////////////////////////////////
+//// Conversion helpers (shared by GMP::Integer, Rational and Float)
+// Loads a Ruby Integer (Fixnum or Bignum) into an already initialized mpz_t.
+// Bignums are packed straight into the mpz_t's limbs, so there is no
+// decimal string round-trip (nor the two heap strings it used to cost).
+void
+num2mpz( mpz_t z, VALUE num ) {
+	if (FIXNUM_P(num)) {
+		mpz_set_si(z, FIX2LONG(num));
+		return;
+	}
+	
+	// Number of limbs needed to hold the absolute value
+	size_t bytes = rb_absint_size(num, NULL);
+	size_t limbs = (bytes + sizeof(mp_limb_t) - 1) / sizeof(mp_limb_t);
+	
+	if (limbs == 0) {
+		mpz_set_ui(z, 0);
+		return;
+	}
+	
+	mp_limb_t *d = mpz_limbs_write(z, limbs);
+	int sign = rb_integer_pack(num, d, limbs, sizeof(mp_limb_t), 0,
+			INTEGER_PACK_LSWORD_FIRST | INTEGER_PACK_NATIVE_BYTE_ORDER);
+	mpz_limbs_finish(z, (sign < 0) ? -(mp_size_t) limbs : (mp_size_t) limbs);
+}
+
+// Creates a Ruby Integer out of a mpz_t, returning a Fixnum whenever the
+// value fits in one and unpacking the limbs into a Bignum otherwise.
+VALUE
+mpz2num( mpz_t z ) {
+	if (mpz_fits_slong_p(z))
+		return LONG2NUM(mpz_get_si(z));
+	
+	int flags = INTEGER_PACK_LSWORD_FIRST | INTEGER_PACK_NATIVE_BYTE_ORDER;
+	if (mpz_sgn(z) < 0)
+		flags |= INTEGER_PACK_NEGATIVE;
+	
+	return rb_integer_unpack(mpz_limbs_read(z), mpz_size(z),
+			sizeof(mp_limb_t), 0, flags);
+}
+
+// Loads a Ruby Integer (Fixnum or Bignum) into an already initialized mpf_t
+// (or mpfr_t, when MPFR is present), going through a temporary mpz_t.
+void
+num2mpf( mpf_t f, VALUE num ) {
+	if (FIXNUM_P(num)) {
+		mpf_set_si(f, FIX2LONG(num));
+		return;
+	}
+	
+	mpz_t z;
+	mpz_init(z);
+	RGMP_COUNT(STAT_TEMPORARIES, 1);
+	num2mpz(z, num);
+	mpf_set_z(f, z);
+	mpz_clear(z);
+}
+
+// Classifies an operand, so that binary operators can pick the matching GMP
+// primitive with a single switch (instead of TYPE() plus class comparisons).
+// Subclasses of the GMP classes are classified as their parent.
+enum operand_kind
+operand_kind( VALUE obj ) {
+	if (FIXNUM_P(obj))
+		return OPERAND_FIXNUM;
+	
+	if (SPECIAL_CONST_P(obj))
+		return RB_FLOAT_TYPE_P(obj) ? OPERAND_FLOAT : OPERAND_OTHER;
+	
+	switch (BUILTIN_TYPE(obj)) {
+		case T_BIGNUM:
+			return OPERAND_BIGNUM;
+		case T_FLOAT:
+			return OPERAND_FLOAT;
+		case T_DATA: {
+			if (!RTYPEDDATA_P(obj))
+				return OPERAND_OTHER;
+			
+			const rb_data_type_t *type = RTYPEDDATA_TYPE(obj);
+			if (type == &integer_type)
+				return OPERAND_INTEGER;
+			if (type == &rational_type)
+				return OPERAND_RATIONAL;
+			if (type == &float_type)
+				return OPERAND_GMPF;
+			return OPERAND_OTHER;
+		}
+		default:
+			return OPERAND_OTHER;
+	}
+}
+
+// Loads any integral value (GMP::Integer, Fixnum or Bignum) into an already
+// initialized mpz_t, raising TypeError for anything else
+void
+integral2mpz( mpz_t z, VALUE value ) {
+	switch (operand_kind(value)) {
+		case OPERAND_INTEGER:
+			mpz_set(z, MPZ_OF(value));
+			break;
+		case OPERAND_FIXNUM:
+		case OPERAND_BIGNUM:
+			num2mpz(z, value);
+			break;
+		default:
+			rb_raise(rb_eTypeError, "expected GMP::Integer or Integer, got %s", rb_obj_classname(value));
+	}
+}
+//// end of conversion helpers
+////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////
+//// GC accounting (opt-in)
+// By default, GMP allocates limbs with plain malloc, behind the GC's back:
+// a GMP::Integer looks like a few dozen bytes to Ruby even when it holds
+// megabytes of limbs, so a loop churning big numbers can grow to gigabytes
+// before a collection is ever triggered. When enabled, limbs are allocated
+// through ruby_xmalloc and friends, so they count towards the malloc limit
+// and trigger collections like any other Ruby allocation.
+//
+// ruby_xmalloc may only be called with the GVL held, though, so when GMP
+// runs without it the hooks fall back to plain malloc and just report the
+// size change with rb_gc_adjust_memory_usage (which only updates counters).
+// Both kinds of blocks come from the same malloc, so they can be mixed
+// freely, as can blocks allocated before the mode was switched on or off.
+#ifdef HAVE_RUBY_THREAD_HAS_GVL_P
+// Exported by the interpreter, but not declared in its public headers
+extern int ruby_thread_has_gvl_p(void);
+#define HAS_GVL() ruby_thread_has_gvl_p()
+#else
+#define HAS_GVL() 0
+#endif
+
+static void *(*default_alloc)(size_t);
+static void *(*default_realloc)(void *, size_t, size_t);
+static void (*default_free)(void *, size_t);
+static int gc_accounting = 0;
+
+// The functions currently handling limb memory (default or accounted)
+static void *(*limb_alloc)(size_t);
+static void *(*limb_realloc)(void *, size_t, size_t);
+static void (*limb_free)(void *, size_t);
+
+static void *
+accounted_alloc( size_t size ) {
+	if (HAS_GVL())
+		return ruby_xmalloc(size);
+	
+	void *p = default_alloc(size);
+	rb_gc_adjust_memory_usage((ssize_t) size);
+	return p;
+}
+
+static void *
+accounted_realloc( void *ptr, size_t old_size, size_t new_size ) {
+	if (HAS_GVL())
+		return ruby_xrealloc(ptr, new_size);
+	
+	void *p = default_realloc(ptr, old_size, new_size);
+	rb_gc_adjust_memory_usage((ssize_t) new_size - (ssize_t) old_size);
+	return p;
+}
+
+static void
+accounted_free( void *ptr, size_t size ) {
+	if (HAS_GVL()) {
+		ruby_xfree(ptr);
+		return;
+	}
+	
+	default_free(ptr, size);
+	rb_gc_adjust_memory_usage(-(ssize_t) size);
+}
+
+#ifdef RGMP_STATS
+// With stats compiled in, GMP always goes through these, which count the
+// limb bytes and hand the request over to the current limb functions
+static void *
+counted_alloc( size_t size ) {
+	RGMP_COUNT(STAT_LIMB_BYTES, size);
+	return limb_alloc(size);
+}
+
+static void *
+counted_realloc( void *ptr, size_t old_size, size_t new_size ) {
+	if (new_size > old_size)
+		RGMP_COUNT(STAT_LIMB_BYTES, new_size - old_size);
+	return limb_realloc(ptr, old_size, new_size);
+}
+
+static void
+counted_free( void *ptr, size_t size ) {
+	limb_free(ptr, size);
+}
+#endif
+
+static void
+set_gc_accounting( int enable ) {
+	if (enable) {
+		limb_alloc = accounted_alloc;
+		limb_realloc = accounted_realloc;
+		limb_free = accounted_free;
+	} else {
+		limb_alloc = default_alloc;
+		limb_realloc = default_realloc;
+		limb_free = default_free;
+	}
+	
+#ifdef RGMP_STATS
+	mp_set_memory_functions(counted_alloc, counted_realloc, counted_free);
+#else
+	mp_set_memory_functions(limb_alloc, limb_realloc, limb_free);
+#endif
+	
+	gc_accounting = enable;
+}
+
+// GMP.gc_accounting = true/false
+static VALUE
+gmp_set_gc_accounting( VALUE self, VALUE enable ) {
+	set_gc_accounting(RTEST(enable));
+	return enable;
+}
+
+// GMP.gc_accounting?
+static VALUE
+gmp_gc_accounting_p( VALUE self ) {
+	return gc_accounting ? Qtrue : Qfalse;
+}
+//// end of GC accounting
+////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////
+//// Running kernels without the GVL
+// GMP calls whose estimated size reaches nogvl_threshold limbs release the
+// GVL, so other Ruby threads keep running meanwhile, and several threads
+// can crunch big numbers on several cores at once. Callers first copy
+// everything the kernel touches out of the Ruby objects. Without the GVL,
+// another thread could mutate an operand in place, and GC compaction could
+// move the embedded structs. Results are swapped back in once the GVL is
+// reacquired (see z_kernel in gmpz.c and f_kernel in gmpf.c).
+//
+// Such kernels can be interrupted (Thread#raise, Thread#kill, Ctrl-C) and
+// bounded by GMP.with_deadline. Ruby's unblocking function only raises a
+// flag: kernels split into chunks poll it between chunks and stop early,
+// monolithic ones (a single mpz_mul...) run to completion first. Either
+// way, the pending interrupt is raised as soon as the GVL is back.
+size_t nogvl_threshold = 1024;
+
+static ID id_deadline;
+
+#ifdef RGMP_STATS
+// Checkpoint of the kernel running on this native thread (the calling one
+// or a worker), whose counts go to the method that started it
+static __thread rgmp_checkpoint *stats_kernel;
+static void stats_charge_kernel(rgmp_checkpoint *);
+#endif
+
+static double
+monotonic_now( void ) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// Whether the kernel should stop now; callable without the GVL
+int
+rgmp_poll( rgmp_checkpoint *cp ) {
+	if (rgmp_stopped(cp))
+		return 1;
+	
+	int cancelled = __atomic_load_n(&cp->cancelled, __ATOMIC_ACQUIRE);
+	if (!cancelled && cp->has_deadline && monotonic_now() >= cp->deadline)
+		cancelled = 1;
+	
+	// Never reset to 0 here: another worker may have stopped already
+	if (cancelled)
+		__atomic_store_n(&cp->stopped, 1, __ATOMIC_RELEASE);
+	return cancelled;
+}
+
+static void
+rgmp_unblock( void *cp ) {
+	__atomic_store_n(&((rgmp_checkpoint *) cp)->cancelled, 1, __ATOMIC_RELEASE);
+}
+
+// Raises GMP::DeadlineExceeded past the checkpoint's deadline, then
+// whatever interrupt is pending for the current thread
+static VALUE
+rgmp_check_interrupts( VALUE p ) {
+	rgmp_checkpoint *cp = (rgmp_checkpoint *) p;
+	
+	if (cp->has_deadline && monotonic_now() >= cp->deadline)
+		rb_raise(eGMPDeadlineExceeded, "GMP computation exceeded its deadline");
+	rb_thread_check_ints();
+	
+	return Qnil;
+}
+
+typedef struct {
+	void *(*func)(void *);
+	void *data;
+	rgmp_checkpoint *cp;
+	int completed;
+} rgmp_job;
+
+static void *
+rgmp_job_run( void *p ) {
+	rgmp_job *job = p;
+#ifdef RGMP_STATS
+	stats_kernel = job->cp;
+#endif
+	job->func(job->data);
+	job->completed = !rgmp_stopped(job->cp);
+#ifdef RGMP_STATS
+	stats_kernel = NULL;
+#endif
+	return NULL;
+}
+
+// Runs func(data) without the GVL until it completes. Returns 0 then, or
+// the tag of the exception that interrupted it: the caller must free its
+// temporaries and rb_jump_tag it. A kernel stopped by an interrupt that
+// did not raise (e.g. a signal trap) is run again from scratch, so func
+// must leave its inputs untouched.
+int
+rgmp_without_gvl( void *(*func)(void *), void *data, rgmp_checkpoint *cp ) {
+	rgmp_job job = { func, data, cp, 0 };
+	int state = 0;
+	
+	VALUE deadline = rb_thread_local_aref(rb_thread_current(), id_deadline);
+	cp->has_deadline = !NIL_P(deadline);
+	cp->deadline = cp->has_deadline ? NUM2DBL(deadline) : 0.0;
+#ifdef RGMP_STATS
+	cp->method = rb_frame_this_func();
+	memset(cp->counts, 0, sizeof(cp->counts));
+#endif
+	
+	while (!job.completed) {
+		rb_protect(rgmp_check_interrupts, (VALUE) cp, &state);
+		if (state)
+			break;
+		
+		// Unlike rb_thread_call_without_gvl, this variant never raises:
+		// with an interrupt pending, it returns without running the job
+		__atomic_store_n(&cp->cancelled, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&cp->stopped, 0, __ATOMIC_RELAXED);
+		rb_thread_call_without_gvl2(rgmp_job_run, &job, rgmp_unblock, cp);
+	}
+	
+#ifdef RGMP_STATS
+	stats_charge_kernel(cp);
+#endif
+	return state;
+}
+
+static VALUE
+gmp_restore_deadline( VALUE previous ) {
+	rb_thread_local_aset(rb_thread_current(), id_deadline, previous);
+	return Qnil;
+}
+
+// GMP.with_deadline(seconds) { ... }
+// Any kernel started by the block (from this thread) after the given
+// number of seconds raises GMP::DeadlineExceeded, and chunked kernels
+// still running by then stop and raise it too. Nested blocks can only
+// shorten the deadline. Only kernels large enough to release the GVL are
+// checked (see GMP.nogvl_threshold); small operations always complete.
+static VALUE
+gmp_with_deadline( VALUE self, VALUE seconds ) {
+	rb_need_block();
+	
+	double deadline = monotonic_now() + NUM2DBL(seconds);
+	VALUE previous = rb_thread_local_aref(rb_thread_current(), id_deadline);
+	if (!NIL_P(previous) && NUM2DBL(previous) < deadline)
+		deadline = NUM2DBL(previous);
+	
+	rb_thread_local_aset(rb_thread_current(), id_deadline, DBL2NUM(deadline));
+	return rb_ensure(rb_yield, Qnil, gmp_restore_deadline, previous);
+}
+
+// GMP.nogvl_threshold = limbs (nil never releases the GVL)
+static VALUE
+gmp_set_nogvl_threshold( VALUE self, VALUE limbs ) {
+	if (NIL_P(limbs)) {
+		nogvl_threshold = SIZE_MAX;
+	} else {
+		long l = NUM2LONG(limbs);
+		// Zero-sized work stands for calls that raise, which must not run
+		// without the GVL
+		nogvl_threshold = (l < 1) ? 1 : (size_t) l;
+	}
+	return limbs;
+}
+
+// GMP.nogvl_threshold
+static VALUE
+gmp_get_nogvl_threshold( VALUE self ) {
+	return (nogvl_threshold == SIZE_MAX) ? Qnil : SIZET2NUM(nogvl_threshold);
+}
+//// end of running kernels without the GVL
+////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////
+//// Native worker threads
+// Kernels running without the GVL may split their work into independent
+// tasks and run them on plain pthreads, which never touch Ruby objects (the
+// GC accounting hooks see them as GVL-less threads). Workers are started
+// per call, which costs tens of microseconds against the seconds of work
+// that make parallelism worthwhile.
+unsigned rgmp_threads = 1;
+size_t parallel_threshold = 65536;
+
+typedef struct {
+	void (*task)(void *, size_t);
+	void *data;
+	size_t count, next;
+	size_t done;			// tasks run to their end
+	rgmp_checkpoint *cp;
+} rgmp_pool;
+
+static void *
+rgmp_pool_worker( void *p ) {
+	rgmp_pool *pool = p;
+#ifdef RGMP_STATS
+	stats_kernel = pool->cp;
+#endif
+	
+	for (;;) {
+		size_t i = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+		if (i >= pool->count || rgmp_poll(pool->cp))
+			break;
+		pool->task(pool->data, i);
+		__atomic_fetch_add(&pool->done, 1, __ATOMIC_RELAXED);
+	}
+	return NULL;
+}
+
+// Runs task(data, i) for every i in [0, count) on up to threads threads,
+// the calling one included, and returns once all are done (or the
+// checkpoint stopped them, in which case it is left stopped even if the
+// workers raced past the poll). Must be called without the GVL.
+void
+rgmp_parallel_for( size_t count, unsigned threads, void (*task)(void *, size_t), void *data, rgmp_checkpoint *cp ) {
+	rgmp_pool pool = { task, data, count, 0, 0, cp };
+	pthread_t workers[RGMP_MAX_THREADS];
+	unsigned started = 0;
+	
+	if (threads > count)
+		threads = (unsigned) count;
+	if (threads > RGMP_MAX_THREADS)
+		threads = RGMP_MAX_THREADS;
+	
+	// Falls back to fewer threads if some cannot be created
+	while (started + 1 < threads && pthread_create(&workers[started], NULL, rgmp_pool_worker, &pool) == 0)
+		started++;
+	
+	rgmp_pool_worker(&pool);
+	while (started > 0)
+		pthread_join(workers[--started], NULL);
+	
+	// A task skipped by any worker leaves a hole in the result
+	if (pool.done < count)
+		__atomic_store_n(&cp->stopped, 1, __ATOMIC_RELEASE);
+}
+
+// Reads the threads: option of a parallel method, falling back to the given
+// default when absent, and the method's own keyword, if any, into *value
+// (nil when absent). Any other keyword raises ArgumentError.
+unsigned
+rgmp_options( VALUE options, unsigned fallback, const char *name, VALUE *value ) {
+	ID table[2];
+	VALUE values[2] = { Qundef, Qundef };
+	table[0] = rb_intern("threads");
+	if (name != NULL) {
+		table[1] = rb_intern(name);
+		*value = Qnil;
+	}
+	if (NIL_P(options))
+		return fallback;
+	
+	rb_get_kwargs(options, table, 0, (name != NULL) ? 2 : 1, values);
+	if (name != NULL && values[1] != Qundef)
+		*value = values[1];
+	
+	VALUE t = values[0];
+	if (t == Qundef || NIL_P(t))
+		return fallback;
+	
+	long l = NUM2LONG(t);
+	if (l < 1 || l > RGMP_MAX_THREADS)
+		rb_raise(rb_eRangeError, "thread count must be between 1 and %d", RGMP_MAX_THREADS);
+	return (unsigned) l;
+}
+
+// Reads the threads: option of a parallel method that takes no other keyword
+unsigned
+rgmp_threads_option( VALUE options, unsigned fallback ) {
+	return rgmp_options(options, fallback, NULL, NULL);
+}
+
+// GMP.threads = count
+// Number of threads used by parallel kernels (defaults to the number of
+// online processors)
+static VALUE
+gmp_set_threads( VALUE self, VALUE count ) {
+	long l = NUM2LONG(count);
+	if (l < 1 || l > RGMP_MAX_THREADS)
+		rb_raise(rb_eRangeError, "thread count must be between 1 and %d", RGMP_MAX_THREADS);
+	
+	rgmp_threads = (unsigned) l;
+	return count;
+}
+
+// GMP.threads
+static VALUE
+gmp_get_threads( VALUE self ) {
+	return UINT2NUM(rgmp_threads);
+}
+
+// GMP.parallel_threshold = limbs (nil never runs operators in parallel)
+static VALUE
+gmp_set_parallel_threshold( VALUE self, VALUE limbs ) {
+	if (NIL_P(limbs)) {
+		parallel_threshold = SIZE_MAX;
+	} else {
+		long l = NUM2LONG(limbs);
+		parallel_threshold = (l < 1) ? 1 : (size_t) l;
+	}
+	return limbs;
+}
+
+// GMP.parallel_threshold
+static VALUE
+gmp_get_parallel_threshold( VALUE self ) {
+	return (parallel_threshold == SIZE_MAX) ? Qnil : SIZET2NUM(parallel_threshold);
+}
+//// end of native worker threads
+////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////
+//// Instrumentation counters (compiled in with --with-stats)
+// Every count is attributed to the Ruby method currently running (e.g. :+,
+// :to_s or :new), found through rb_frame_this_func. The counters live in a
+// st_table keyed by the method's ID, touched only with the GVL held. Kernels
+// running without it count atomically into their checkpoint, which records
+// the calling method before the GVL is released, and the totals are charged
+// to it once the GVL is back. Counts made outside any method or kernel go to
+// a separate array, updated atomically, and are reported under
+// :"(unattributed)".
+#ifdef RGMP_STATS
+static st_table *stats_table;
+static size_t stats_unattributed[STAT_COUNT];
+
+// Adds n to the method's counter; needs the GVL
+static void
+stats_charge( ID method, enum rgmp_stat stat, size_t n ) {
+	st_data_t counters;
+	
+	if (stats_table == NULL || method == 0) {
+		__atomic_fetch_add(&stats_unattributed[stat], n, __ATOMIC_RELAXED);
+		return;
+	}
+	
+	if (!st_lookup(stats_table, (st_data_t) method, &counters)) {
+		// Plain calloc: this may run inside GMP's allocation hooks
+		counters = (st_data_t) calloc(STAT_COUNT, sizeof(size_t));
+		if (counters == 0)
+			return;
+		st_insert(stats_table, (st_data_t) method, counters);
+	}
+	
+	((size_t *) counters)[stat] += n;
+}
+
+// Hands the counts of a finished (or interrupted) kernel over to its method
+static void
+stats_charge_kernel( rgmp_checkpoint *cp ) {
+	for (int i = 0; i < STAT_COUNT; i++) {
+		if (cp->counts[i] > 0)
+			stats_charge(cp->method, (enum rgmp_stat) i, cp->counts[i]);
+		cp->counts[i] = 0;
+	}
+}
+
+void
+rgmp_count( enum rgmp_stat stat, size_t n ) {
+	if (!HAS_GVL()) {
+		size_t *counters = (stats_kernel != NULL) ? stats_kernel->counts : stats_unattributed;
+		__atomic_fetch_add(&counters[stat], n, __ATOMIC_RELAXED);
+		return;
+	}
+	
+	stats_charge(rb_frame_this_func(), stat, n);
+}
+
+// Builds the {counter name => count} hash of one method
+static VALUE
+stats_counters_hash( const size_t *counters ) {
+	VALUE hash = rb_hash_new();
+	
+	rb_hash_aset(hash, ID2SYM(rb_intern("objects")), SIZET2NUM(counters[STAT_OBJECTS]));
+	rb_hash_aset(hash, ID2SYM(rb_intern("temporaries")), SIZET2NUM(counters[STAT_TEMPORARIES]));
+	rb_hash_aset(hash, ID2SYM(rb_intern("string_conversions")), SIZET2NUM(counters[STAT_STRING_CONVERSIONS]));
+	rb_hash_aset(hash, ID2SYM(rb_intern("limb_bytes")), SIZET2NUM(counters[STAT_LIMB_BYTES]));
+	
+	return hash;
+}
+
+static int
+stats_collect_i( st_data_t method, st_data_t counters, st_data_t result ) {
+	rb_hash_aset((VALUE) result, ID2SYM((ID) method),
+			stats_counters_hash((const size_t *) counters));
+	return ST_CONTINUE;
+}
+
+static int
+stats_free_i( st_data_t method, st_data_t counters, st_data_t arg ) {
+	free((void *) counters);
+	return ST_DELETE;
+}
+#endif
+
+// GMP.stats
+// Returns {method => {objects:, temporaries:, string_conversions:,
+// limb_bytes:}}, or nil when the counters were not compiled in
+static VALUE
+gmp_stats( VALUE self ) {
+#ifdef RGMP_STATS
+	size_t unattributed[STAT_COUNT];
+	int i;
+	
+	// The table is snapshotted first, since building the result allocates
+	// (and so may count) too
+	st_table *snapshot = st_copy(stats_table);
+	for (i = 0; i < STAT_COUNT; i++)
+		unattributed[i] = __atomic_load_n(&stats_unattributed[i], __ATOMIC_RELAXED);
+	
+	VALUE result = rb_hash_new();
+	st_foreach(snapshot, stats_collect_i, (st_data_t) result);
+	st_free_table(snapshot);
+	rb_hash_aset(result, ID2SYM(rb_intern("(unattributed)")),
+			stats_counters_hash(unattributed));
+	
+	return result;
+#else
+	return Qnil;
+#endif
+}
+
+// GMP.reset_stats
+static VALUE
+gmp_reset_stats( VALUE self ) {
+#ifdef RGMP_STATS
+	int i;
+	
+	st_foreach(stats_table, stats_free_i, 0);
+	for (i = 0; i < STAT_COUNT; i++)
+		__atomic_store_n(&stats_unattributed[i], 0, __ATOMIC_RELAXED);
+#endif
+	return Qnil;
+}
+//// end of instrumentation counters
+////////////////////////////////////////////////////////////////////
+
 void
 Init_gmp() {
 	mGMP = rb_define_module("GMP");
@@ -29,6 +701,11 @@ Init_gmp() {
 	cGMPInteger = rb_define_class_under(mGMP, "Integer", rb_cObject);
 	cGMPRational = rb_define_class_under(mGMP, "Rational", rb_cObject);
 	cGMPFloat = rb_define_class_under(mGMP, "Float", rb_cObject);
+	cGMPModulus = rb_define_class_under(mGMP, "Modulus", rb_cObject);
+	cGMPModInt = rb_define_class_under(mGMP, "ModInt", rb_cObject);
+	cGMPPowmTable = rb_define_class_under(mGMP, "PowmTable", rb_cObject);
+	cGMPCRTBasis = rb_define_class_under(mGMP, "CRTBasis", rb_cObject);
+	mGMPPrimes = rb_define_module_under(mGMP, "Primes");
 	
 	// Loads GMP::Integer into the extension
 	Init_gmpz();
@@ -39,6 +716,15 @@ Init_gmp() {
 	// Loads GMP::Float into the extension
 	Init_gmpf();
 	
+	// Loads GMP::Modulus, GMP::ModInt and GMP::PowmTable into the extension
+	Init_gmpmod();
+	
+	// Loads GMP::CRTBasis into the extension
+	Init_gmpcrt();
+	
+	// Loads GMP::Primes into the extension
+	Init_gmpprimes();
+	
 	// String containing the GMP version used to compile this
 	gmpversion = rb_str_new2(gmp_version);
 	rb_define_const(mGMP, "GMP_VERSION", gmpversion);
@@ -52,4 +738,36 @@ Init_gmp() {
 	// If MPFR was present during compile-time, this constant holds its version,
 	// otherwise it is set as Nil.
 	rb_define_const(mGMP, "MPFR_VERSION", mpfrversion);
+	
+	// Threshold for running kernels without the GVL
+	rb_define_singleton_method(mGMP, "nogvl_threshold=", gmp_set_nogvl_threshold, 1);
+	rb_define_singleton_method(mGMP, "nogvl_threshold", gmp_get_nogvl_threshold, 0);
+	
+	// Deadlines for kernels running without the GVL
+	id_deadline = rb_intern("__gmp_deadline__");
+	eGMPDeadlineExceeded = rb_define_class_under(mGMP, "DeadlineExceeded", rb_eRuntimeError);
+	rb_define_singleton_method(mGMP, "with_deadline", gmp_with_deadline, 1);
+	
+	// Native worker threads for parallel kernels
+	long processors = sysconf(_SC_NPROCESSORS_ONLN);
+	rgmp_threads = (processors < 1) ? 1 : (processors > RGMP_MAX_THREADS) ? RGMP_MAX_THREADS : (unsigned) processors;
+	rb_define_singleton_method(mGMP, "threads=", gmp_set_threads, 1);
+	rb_define_singleton_method(mGMP, "threads", gmp_get_threads, 0);
+	rb_define_singleton_method(mGMP, "parallel_threshold=", gmp_set_parallel_threshold, 1);
+	rb_define_singleton_method(mGMP, "parallel_threshold", gmp_get_parallel_threshold, 0);
+	
+	// Instrumentation counters
+#ifdef RGMP_STATS
+	stats_table = st_init_numtable();
+#endif
+	rb_define_singleton_method(mGMP, "stats", gmp_stats, 0);
+	rb_define_singleton_method(mGMP, "reset_stats", gmp_reset_stats, 0);
+	
+	// GC accounting of limb memory; off unless RGMP_GC_ACCOUNTING is set
+	mp_get_memory_functions(&default_alloc, &default_realloc, &default_free);
+	rb_define_singleton_method(mGMP, "gc_accounting=", gmp_set_gc_accounting, 1);
+	rb_define_singleton_method(mGMP, "gc_accounting?", gmp_gc_accounting_p, 0);
+	
+	const char *env = getenv("RGMP_GC_ACCOUNTING");
+	set_gc_accounting(env != NULL && *env != '\0' && strcmp(env, "0") != 0);
 }
@@ -0,0 +1,478 @@
+/*
+    rGMP is yet another GMP wrapper for Ruby
+    Copyright (C) 2009  Ralf Gunter
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <errno.h>
+#include <string.h>
+
+#include "gmp.h"
+#include "ruby.h"
+#include "rgmp.h"
+
+////////////////////////////////////////////////////////////////////
+//// GMP::CRTBasis
+// Chinese remaindering over a fixed set of pairwise coprime moduli m(i),
+// with M their product: x = sum of v(i) * M / m(i) mod M, where
+// v(i) = r(i) * c(i) mod m(i) and c(i) = (M / m(i))^-1 mod m(i). The sum is
+// gathered up the product tree of the moduli, each node combining its
+// children as v(l) * P(r) + v(r) * P(l), and c(i) comes from the remainder
+// tree: (M mod m(i)^2) / m(i) = (M / m(i)) mod m(i).
+typedef struct {
+	size_t n;
+	mpz_t *items;		// the moduli (the leaves of tree), then the c(i)
+	z_tree *tree;		// M at the root; NULL until initialized
+} rgmp_crt_basis;
+
+// Fewer moduli than this are combined one at a time by Garner's algorithm,
+// without building a basis (which only pays off for about a hundred
+// word-sized moduli, fewer larger ones)
+#define CRT_GARNER_MAX 64
+
+static void
+crt_basis_free( void *p ) {
+	rgmp_crt_basis *B = p;
+	if (B->tree != NULL) {
+		z_tree_free(B->tree);
+		xfree(B->tree);
+	}
+	for (size_t i = 0; B->items != NULL && i < 2 * B->n; i++)
+		mpz_clear(B->items[i]);
+	xfree(B->items);
+#ifndef TYPED_DATA_EMBEDDED
+	xfree(B);
+#endif
+}
+
+static size_t
+crt_basis_memsize( const void *p ) {
+	const rgmp_crt_basis *B = p;
+	if (B->tree == NULL)
+		return 0;
+	
+	size_t size = sizeof(z_tree);
+	for (int h = 0; h < B->tree->height; h++) {
+		const z_tree_level *L = &B->tree->level[h];
+		size += L->count * sizeof(mpz_t);
+		for (size_t i = 0; i < L->count; i++)
+			size += (size_t) L->nodes[i]->_mp_alloc * sizeof(mp_limb_t);
+	}
+	for (size_t i = 0; i < B->n; i++)
+		size += sizeof(mpz_t) + (size_t) B->items[B->n + i]->_mp_alloc * sizeof(mp_limb_t);
+	return size;
+}
+
+static const rb_data_type_t crt_basis_type = {
+	"GMP::CRTBasis",
+	{ NULL, crt_basis_free, crt_basis_memsize, },
+	NULL, NULL, RGMP_TYPED_FLAGS
+};
+
+VALUE
+crt_basis_allocate( VALUE klass ) {
+	rgmp_crt_basis *B;
+	VALUE obj = TypedData_Make_Struct(klass, rgmp_crt_basis, &crt_basis_type, B);
+	B->n = 0;
+	B->items = NULL;
+	B->tree = NULL;
+	return obj;
+}
+
+static rgmp_crt_basis *
+crt_basis_get( VALUE obj ) {
+	rgmp_crt_basis *B;
+	TypedData_Get_Struct(obj, rgmp_crt_basis, &crt_basis_type, B);
+	if (B->tree == NULL)
+		rb_raise(rb_eRuntimeError, "uninitialized basis");
+	return B;
+}
+
+// Loads and checks the moduli (at least one, all positive) of a z_items,
+// followed by extra scratch integers, and returns their size in limbs
+static size_t
+crt_load_moduli( z_items *z, long extra ) {
+	if (RARRAY_LEN(z->array) == 0)
+		rb_raise(rb_eArgError, "no moduli");
+	z_items_load(z, extra);
+	
+	size_t work = 0;
+	for (long i = 0; i < RARRAY_LEN(z->array); i++) {
+		if (mpz_sgn(z->items[i]) <= 0)
+			rb_raise(rb_eRangeError, "moduli must be positive");
+		work += mpz_size(z->items[i]);
+	}
+	return work;
+}
+
+// Loads the residues, an Array or a String of native unsigned longs (as
+// returned by mod_many's packed: true), into r[0 .. n - 1]
+static void
+crt_load_residues( mpz_t *r, size_t n, VALUE residues ) {
+	if (RB_TYPE_P(residues, T_STRING)) {
+		if ((size_t) RSTRING_LEN(residues) != n * sizeof(unsigned long))
+			rb_raise(rb_eArgError, "expected %zu packed residues, got %zu bytes", n, (size_t) RSTRING_LEN(residues));
+		const unsigned long *words = (const unsigned long *) RSTRING_PTR(residues);
+		for (size_t i = 0; i < n; i++)
+			mpz_set_ui(r[i], words[i]);
+		return;
+	}
+	
+	Check_Type(residues, T_ARRAY);
+	if ((size_t) RARRAY_LEN(residues) != n)
+		rb_raise(rb_eArgError, "expected %zu residues, got %ld", n, RARRAY_LEN(residues));
+	for (size_t i = 0; i < n; i++)
+		integral2mpz(r[i], rb_ary_entry(residues, i));
+}
+
+// x in (-M/2, M/2] instead of [0, M), with t as scratch space
+static void
+crt_symmetric( mpz_ptr x, mpz_srcptr M, mpz_ptr t ) {
+	mpz_mul_2exp(t, x, 1);
+	if (mpz_cmp(t, M) > 0)
+		mpz_sub(x, x, M);
+}
+
+// Building a basis: the moduli and their c(i) are moved into the object
+// once everything is done, and freed here otherwise
+typedef struct {
+	z_items z;			// the moduli, then their c(i)
+	size_t n;
+	rgmp_crt_basis *B;
+	z_tree tree;
+	size_t failed;		// 1 + a modulus sharing a factor with another
+	rgmp_checkpoint cp;
+} crt_build;
+
+static void
+crt_coefficient_task( void *data, size_t i ) {
+	crt_build *b = data;
+	mpz_ptr m = b->z.items[i], c = b->z.items[b->n + i];
+	mpz_divexact(c, c, m);
+	if (!mpz_invert(c, c, m))
+		b->failed = i + 1;
+}
+
+static void *
+crt_build_nogvl( void *p ) {
+	crt_build *b = p;
+	z_tree *T = &b->tree;
+	
+	z_tree_build(T, b->z.items, b->n);
+	if (!T->error && !rgmp_stopped(&b->cp))
+		z_tree_remainders(T, T->level[T->height - 1].nodes[0], b->z.items + b->n, 1);
+	if (!T->error && !rgmp_stopped(&b->cp))
+		rgmp_parallel_for(b->n, T->threads, crt_coefficient_task, b, &b->cp);
+	return NULL;
+}
+
+static VALUE
+crt_build_run( VALUE p ) {
+	crt_build *b = (crt_build *) p;
+	size_t work = crt_load_moduli(&b->z, RARRAY_LEN(b->z.array));
+	b->n = b->z.count / 2;
+	
+	z_tree_call(&b->tree, work, crt_build_nogvl, b, &b->cp);
+	if (b->failed)
+		rb_raise(rb_eArgError, "modulus %zu is not coprime to the others", b->failed - 1);
+	
+	// The basis takes over the moduli, their c(i) and the tree, which
+	// crt_build_free then leaves alone
+	rgmp_crt_basis *B = b->B;
+	B->tree = ALLOC(z_tree);
+	*B->tree = b->tree;
+	B->tree->cp = NULL;
+	B->n = b->n;
+	B->items = b->z.items;
+	b->tree.height = 0;
+	b->z.items = NULL;
+	b->z.count = 0;
+	return Qnil;
+}
+
+static VALUE
+crt_build_free( VALUE p ) {
+	crt_build *b = (crt_build *) p;
+	z_tree_free(&b->tree);
+	return z_items_free((VALUE) &b->z);
+}
+
+// Evaluating a basis, on a private copy of its tree (which is only read)
+typedef struct {
+	rgmp_crt_basis *B;
+	VALUE residues;
+	z_tree tree;
+	mpz_t *v;			// the residues, then the v(i)
+	size_t count;
+	mpz_ptr x;
+	rgmp_checkpoint cp;
+} crt_eval;
+
+static void
+crt_value_task( void *data, size_t i ) {
+	crt_eval *e = data;
+	size_t n = e->B->n;
+	mpz_ptr v = e->v[n + i];
+	mpz_srcptr m = e->B->items[i], c = e->B->items[n + i];
+	mpz_mod(v, e->v[i], m);
+	mpz_mul(v, v, c);
+	mpz_tdiv_r(v, v, m);
+}
+
+// One level up the tree: step.out[i] = v(2i) * P(2i + 1) + v(2i + 1) * P(2i),
+// with the values in step.above and the products in step.below
+static void
+crt_combine_task( void *data, size_t i ) {
+	z_tree_step *s = data;
+	if (2 * i + 1 < s->below_count) {
+		mpz_t t;
+		mpz_init(t);
+		z_mul_parallel(s->out[i], s->above[2 * i], s->below[2 * i + 1], s->threads, s->cp);
+		z_mul_parallel(t, s->above[2 * i + 1], s->below[2 * i], s->threads, s->cp);
+		mpz_add(s->out[i], s->out[i], t);
+		mpz_clear(t);
+	} else {
+		mpz_set(s->out[i], s->above[2 * i]);
+	}
+}
+
+static void *
+crt_eval_nogvl( void *p ) {
+	crt_eval *e = p;
+	z_tree *T = &e->tree;
+	size_t n = e->B->n;
+	rgmp_parallel_for(n, T->threads, crt_value_task, e, &e->cp);
+	
+	mpz_t *values = e->v + n;
+	size_t count = n;
+	for (int h = 1; h < T->height && !rgmp_stopped(&e->cp); h++) {
+		z_tree_level *below = &T->level[h - 1], *above = &T->level[h];
+		mpz_t *next = malloc(above->count * sizeof(mpz_t));
+		if (next == NULL) {
+			T->error = ENOMEM;
+			break;
+		}
+		for (size_t i = 0; i < above->count; i++)
+			mpz_init(next[i]);
+		
+		z_tree_step s = { below->nodes, values, next, below->count,
+				(above->count < T->threads) ? T->threads / above->count : 1, 0, T->cp };
+		rgmp_parallel_for(above->count, T->threads, crt_combine_task, &s, T->cp);
+		if (values != e->v + n)
+			z_tree_clear_nodes(values, count);
+		values = next;
+		count = above->count;
+	}
+	
+	if (!T->error && !rgmp_stopped(&e->cp))
+		mpz_tdiv_r(e->x, values[0], T->level[T->height - 1].nodes[0]);
+	if (values != e->v + n)
+		z_tree_clear_nodes(values, count);
+	return NULL;
+}
+
+static VALUE
+crt_eval_run( VALUE p ) {
+	crt_eval *e = (crt_eval *) p;
+	size_t n = e->B->n;
+	
+	e->v = ALLOC_N(mpz_t, 2 * n);
+	for (size_t i = 0; i < 2 * n; i++) {
+		mpz_init(e->v[i]);
+		e->count++;
+	}
+	RGMP_COUNT(STAT_TEMPORARIES, 2 * n);
+	crt_load_residues(e->v, n, e->residues);
+	
+	mpz_srcptr M = e->tree.level[e->tree.height - 1].nodes[0];
+	z_tree_call(&e->tree, work_product(mpz_size(M), 2), crt_eval_nogvl, e, &e->cp);
+	return Qnil;
+}
+
+static VALUE
+crt_eval_free( VALUE p ) {
+	crt_eval *e = (crt_eval *) p;
+	for (size_t i = 0; i < e->count; i++)
+		mpz_clear(e->v[i]);
+	xfree(e->v);
+	return Qnil;
+}
+
+// x = the residues recombined on basis, in [0, M) or (-M/2, M/2]. basis is
+// kept on this stack, which pins its struct while the GVL is released.
+static VALUE
+crt_basis_eval( VALUE basis, VALUE residues, int symmetric, unsigned threads ) {
+	crt_eval e;
+	memset(&e, 0, sizeof(e));
+	e.B = crt_basis_get(basis);
+	e.residues = residues;
+	e.tree = *e.B->tree;
+	e.tree.threads = threads;
+	
+	mpz_t *x;
+	VALUE result = integer_create(&x);
+	e.x = *x;
+	rb_ensure(crt_eval_run, (VALUE) &e, crt_eval_free, (VALUE) &e);
+	
+	if (symmetric) {
+		mpz_t t;
+		mpz_init(t);
+		crt_symmetric(*x, e.tree.level[e.tree.height - 1].nodes[0], t);
+		mpz_clear(t);
+	}
+	RB_GC_GUARD(basis);
+	return result;
+}
+
+// A one-off reconstruction by Garner's algorithm
+typedef struct {
+	z_items z;			// the moduli, the residues, then x, M, t and u
+	VALUE residues;
+	int symmetric;
+} crt_incremental;
+
+// Garner's algorithm, one modulus at a time: with x the solution modulo
+// M = m(0) * ... * m(i - 1), x + M * ((r(i) - x) * M^-1 mod m(i)) is the
+// solution modulo M * m(i)
+static VALUE
+crt_garner( VALUE p ) {
+	crt_incremental *g = (crt_incremental *) p;
+	long n = RARRAY_LEN(g->z.array);
+	crt_load_moduli(&g->z, n + 4);
+	
+	mpz_t *m = g->z.items, *r = g->z.items + n;
+	mpz_ptr x = r[n], M = r[n + 1], t = r[n + 2], u = r[n + 3];
+	crt_load_residues(r, n, g->residues);
+	
+	mpz_set_ui(x, 0);
+	mpz_set_ui(M, 1);
+	for (long i = 0; i < n; i++) {
+		mpz_sub(t, r[i], x);
+		mpz_mod(t, t, m[i]);
+		mpz_mod(u, M, m[i]);
+		if (!mpz_invert(u, u, m[i]))
+			rb_raise(rb_eArgError, "modulus %ld is not coprime to the others", i);
+		mpz_mul(t, t, u);
+		mpz_mod(t, t, m[i]);
+		mpz_addmul(x, M, t);
+		mpz_mul(M, M, m[i]);
+	}
+	if (g->symmetric)
+		crt_symmetric(x, M, t);
+	
+	mpz_t *result;
+	VALUE integer = integer_create(&result);
+	mpz_swap(*result, x);
+	return integer;
+}
+
+// Class constructor
+// Precomputes the product tree of pairwise coprime moduli and the
+// coefficients of every modulus, for GMP::CRTBasis#crt
+// {Array <GMP::Integer, Fixnum, Bignum>}, threads: {Fixnum} -> {GMP::CRTBasis}
+VALUE
+crt_basis_init( int argc, VALUE *argv, VALUE self ) {
+	VALUE moduli, options;
+	rb_scan_args(argc, argv, "1:", &moduli, &options);
+	Check_Type(moduli, T_ARRAY);
+	
+	rgmp_crt_basis *B;
+	TypedData_Get_Struct(self, rgmp_crt_basis, &crt_basis_type, B);
+	if (B->tree != NULL)
+		rb_raise(rb_eRuntimeError, "basis already initialized");
+	
+	crt_build b;
+	memset(&b, 0, sizeof(b));
+	b.z.array = moduli;
+	b.B = B;
+	b.tree.threads = rgmp_threads_option(options, 0);
+	rb_ensure(crt_build_run, (VALUE) &b, crt_build_free, (VALUE) &b);
+	
+	return Qnil;
+}
+
+// The residues (an Array, or a String of native unsigned longs) recombined
+// into the only x in [0, M) congruent to each of them, or in (-M/2, M/2]
+// with symmetric: true, for signed results
+// {Array <GMP::Integer, Fixnum, Bignum>, String}, symmetric: {TrueClass, FalseClass}, threads: {Fixnum} -> {GMP::Integer}
+VALUE
+crt_basis_crt( int argc, VALUE *argv, VALUE self ) {
+	VALUE residues, options, symmetric;
+	rb_scan_args(argc, argv, "1:", &residues, &options);
+	
+	unsigned threads = rgmp_options(options, 0, "symmetric", &symmetric);
+	return crt_basis_eval(self, residues, RTEST(symmetric), threads);
+}
+
+// The product of the moduli
+// {} -> {GMP::Integer}
+VALUE
+crt_basis_modulus( VALUE self ) {
+	z_tree *T = crt_basis_get(self)->tree;
+	mpz_t *r;
+	VALUE result = integer_create(&r);
+	mpz_set(*r, T->level[T->height - 1].nodes[0]);
+	return result;
+}
+
+// {} -> {Fixnum}
+VALUE
+crt_basis_size( VALUE self ) {
+	return SIZET2NUM(crt_basis_get(self)->n);
+}
+// The x congruent to every residue modulo the matching modulus, in [0, M)
+// or (-M/2, M/2] with symmetric: true, M being the product of the moduli.
+// moduli is an Array of pairwise coprime moduli, combined one by one for
+// a few of them and through a product tree (see GMP::CRTBasis) otherwise,
+// or a GMP::CRTBasis to reuse. residues may be an Array or a String of
+// native unsigned longs, as returned by mod_many's packed: true.
+// {Array <GMP::Integer, Fixnum, Bignum>, String}, {Array <GMP::Integer, Fixnum, Bignum>, GMP::CRTBasis}, symmetric: {TrueClass, FalseClass}, threads: {Fixnum} -> {GMP::Integer}
+VALUE
+z_crt_singleton( int argc, VALUE *argv, VALUE klass ) {
+	VALUE residues, moduli, options, symmetric_option;
+	rb_scan_args(argc, argv, "2:", &residues, &moduli, &options);
+	
+	unsigned threads = rgmp_options(options, 0, "symmetric", &symmetric_option);
+	int symmetric = RTEST(symmetric_option);
+	
+	if (!rb_typeddata_is_kind_of(moduli, &crt_basis_type)) {
+		Check_Type(moduli, T_ARRAY);
+		if (RARRAY_LEN(moduli) < CRT_GARNER_MAX) {
+			crt_incremental g;
+			memset(&g, 0, sizeof(g));
+			g.z.array = moduli;
+			g.residues = residues;
+			g.symmetric = symmetric;
+			return rb_ensure(crt_garner, (VALUE) &g, z_items_free, (VALUE) &g.z);
+		}
+		moduli = rb_class_new_instance(1, &moduli, cGMPCRTBasis);
+	}
+	return crt_basis_eval(moduli, residues, symmetric, threads);
+}
+//// end of GMP::CRTBasis
+////////////////////////////////////////////////////////////////////
+
+void
+Init_gmpcrt() {
+	// GMP::CRTBasis
+	rb_define_alloc_func(cGMPCRTBasis, crt_basis_allocate);
+	rb_define_method(cGMPCRTBasis, "initialize", crt_basis_init, -1);
+	rb_define_method(cGMPCRTBasis, "crt", crt_basis_crt, -1);
+	rb_define_method(cGMPCRTBasis, "modulus", crt_basis_modulus, 0);
+	rb_define_method(cGMPCRTBasis, "size", crt_basis_size, 0);
+	
+	// Singletons/Class methods
+	rb_define_singleton_method(cGMPInteger, "crt", z_crt_singleton, -1);
+}
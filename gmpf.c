@@ -16,6 +16,8 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <float.h>
+
 #include "gmp.h"
 #include "ruby.h"
 #include "rgmp.h"
@@ -29,19 +31,50 @@
 //// Fundamental methods
 // Garbage collection
 void
-float_mark( mpf_t *f ) {}
-
-void
-float_free( mpf_t *f ) {
+float_free( void *p ) {
+	mpf_t *f = p;
 	mpf_clear(*f);
+#ifndef TYPED_DATA_EMBEDDED
+	xfree(f);
+#endif
+}
+
+// Reports the limb memory held by the number, which the GC cannot see
+size_t
+float_memsize( const void *p ) {
+	const mpf_t *f = p;
+#ifdef MPFR
+	size_t limbs = (mpfr_get_prec(*f) + GMP_NUMB_BITS - 1) / GMP_NUMB_BITS;
+#else
+	size_t limbs = (*f)->_mp_prec + 1;
+#endif
+	return limbs * sizeof(mp_limb_t);
 }
 
+const rb_data_type_t float_type = {
+	"GMP::Float",
+	{ NULL, float_free, float_memsize, },
+	NULL, NULL, RGMP_TYPED_FLAGS
+};
+
 // Object allocation
+// The mpf_t lives inside the Ruby object itself (no separate malloc)
 VALUE
 float_allocate( VALUE klass ) {
-	mpf_t *f = malloc(sizeof(mpf_t));
+	mpf_t *f;
+	VALUE obj = TypedData_Make_Struct(klass, mpf_t, &float_type, f);
 	mpf_init(*f);
-	return Data_Wrap_Struct(klass, float_mark, float_free, f);
+	RGMP_COUNT(STAT_OBJECTS, 1);
+	return obj;
+}
+
+// Creates a new GMP::Float, pointing *f at its (initialized) mpf_t
+VALUE
+float_create( mpf_t **f ) {
+	VALUE obj = TypedData_Make_Struct(cGMPFloat, mpf_t, &float_type, *f);
+	mpf_init(**f);
+	RGMP_COUNT(STAT_OBJECTS, 1);
+	return obj;
 }
 
 // Class constructor
@@ -59,13 +92,13 @@ f_init( VALUE argc, VALUE *argv, VALUE self ) {
 	rb_scan_args(argc, argv, "11", &number, &precision);
 	
 	// Loads the (blank) new object
-	Data_Get_Struct(self, mpf_t, s);
+	TypedData_Get_Struct(self, mpf_t, &float_type, s);
 	
 	switch (TYPE(number)) {
 		case T_DATA: {
 			if (rb_obj_class(number) == cGMPFloat) {
 				mpf_t *ngf;
-				Data_Get_Struct(number, mpf_t, ngf);
+				TypedData_Get_Struct(number, mpf_t, &float_type, ngf);
 				mpf_set(*s, *ngf);
 			} else {
 				rb_raise(rb_eTypeError, "input data type not supported");
@@ -74,6 +107,7 @@ f_init( VALUE argc, VALUE *argv, VALUE self ) {
 		}
 		case T_STRING: {
 			mpf_set_str(*s, StringValuePtr(number), 10);
+			RGMP_COUNT(STAT_STRING_CONVERSIONS, 1);
 			break;
 		}
 		case T_FLOAT: {
@@ -105,11 +139,12 @@ VALUE
 f_to_string( VALUE self ) {
 	// Creates a mpf_t pointer and loads self into it
 	mpf_t *s;
-	Data_Get_Struct(self, mpf_t, s);
+	TypedData_Get_Struct(self, mpf_t, &float_type, s);
 	
 	// Creates the pointer to the string and loads it from GMP
 	mp_exp_t exp;
 	char *str = mpf_get_str(NULL, &exp, 10, 0, *s);
+	RGMP_COUNT(STAT_STRING_CONVERSIONS, 1);
 	
 	VALUE string = rb_str_new2(str);
 	free(str);
@@ -123,7 +158,7 @@ VALUE
 f_to_float( VALUE self ) {
 	// Creates a mpf_t pointer and loads self into it
 	mpf_t *s;
-	Data_Get_Struct(self, mpf_t, s);
+	TypedData_Get_Struct(self, mpf_t, &float_type, s);
 	
 	// Converts mpf_t to C double, truncating if required (done internally)
 	double result = mpf_get_d(*s);
@@ -135,132 +170,153 @@ f_to_float( VALUE self ) {
 
 ////////////////////////////////////////////////////////////////////
 //// Binary arithmetical operators
-// Addition (+)
-// {GMP::Float, Float, Fixnum, Bignum} -> {GMP::Float}
-VALUE
-f_addition( VALUE self, VALUE summand ) {
-	// Creates pointers to self's and the result's mpf_t structures
-	mpf_t *r = malloc(sizeof(*r));
-	mpf_t *f;
-	
-	// Loads self into *f
-	Data_Get_Struct(self, mpf_t, f);
-	
-	// Inits the result
-	mpf_init(*r);
-	
-	// Decides what to do based on the summand's type/class
-	switch (TYPE(summand)) {
-		case T_DATA: {
-			if (rb_obj_class(summand) == cGMPFloat) {
-				mpf_t *sd;
-				Data_Get_Struct(summand, mpf_t, sd);
-				mpf_add(*r, *f, *sd);
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
+// Operand dispatch (see f_operator in rgmp.h)
+// f_apply classifies the operand once and calls the matching entry of the
+// operator. Entries left as NULL fall back to converting the operand to a
+// temporary mpf_t (exactly, whenever the precision allows it) and calling
+// the mpf_t entry; with MPFR, every operand type has a native function, so
+// that only happens for the odd operator.
+// r = f OP other (r may be f itself)
+void
+f_apply( mpf_ptr r, mpf_srcptr f, VALUE other, const f_operator *op ) {
+	mpf_t tempOther;
+	
+	switch (operand_kind(other)) {
+		case OPERAND_GMPF: {
+			if (op->ff == NULL)
+				break;
+			op->ff(r, f, MPF_OF(other));
+			return;
+		}
+		case OPERAND_FIXNUM: {
+			if (op->fl != NULL) {
+				op->fl(r, f, FIX2LONG(other));
+				return;
 			}
-			break;
+			
+			if (op->ff == NULL)
+				break;
+			mpf_init2(tempOther, sizeof(long) * CHAR_BIT);
+			RGMP_COUNT(STAT_TEMPORARIES, 1);
+			mpf_set_si(tempOther, FIX2LONG(other));
+			op->ff(r, f, tempOther);
+			mpf_clear(tempOther);
+			return;
 		}
-		case T_FLOAT: {
-#ifndef MPFR
-			// GMP does not provide support for adding a mpf_t to a C double
-			// so first we have to convert Ruby's Float to a mpf_t and then do
-			// the operation
-			mpf_t tempSufl;
-			mpf_init_set_d(tempSufl, NUM2DBL(summand));
-			mpf_add(*r, *f, tempSufl);
-			mpf_clear(tempSufl);
-#else
-			double ds = NUM2DBL(summand);
-			mpfr_add_d(*r, *f, ds, GMP_RNDN);
-#endif
-			break;
+		case OPERAND_FLOAT: {
+			if (op->fd != NULL) {
+				op->fd(r, f, RFLOAT_VALUE(other));
+				return;
+			}
+			
+			if (op->ff == NULL)
+				break;
+			mpf_init2(tempOther, DBL_MANT_DIG);
+			RGMP_COUNT(STAT_TEMPORARIES, 1);
+			mpf_set_d(tempOther, RFLOAT_VALUE(other));
+			op->ff(r, f, tempOther);
+			mpf_clear(tempOther);
+			return;
 		}
-		case T_FIXNUM: {
-			// Likewise, Ruby's Fixnum should first be converted to a mpf_float
-			// to keep the sign.
-			// I have a feeling this can be done otherwise, with some size
-			// checking, though it would still feel like a bad hack.
-			mpf_t tempSufi;
-			mpf_init_set_si(tempSufi, FIX2LONG(summand));
-			mpf_add(*r, *f, tempSufi);
-			mpf_clear(tempSufi);
-			break;
+		case OPERAND_INTEGER: {
+			if (op->fz != NULL) {
+				op->fz(r, f, MPZ_OF(other));
+				return;
+			}
+			
+			if (op->ff == NULL)
+				break;
+			mpf_init2(tempOther, mpz_sizeinbase(MPZ_OF(other), 2));
+			RGMP_COUNT(STAT_TEMPORARIES, 1);
+			mpf_set_z(tempOther, MPZ_OF(other));
+			op->ff(r, f, tempOther);
+			mpf_clear(tempOther);
+			return;
 		}
-		case T_BIGNUM: {
-			mpf_t tempSub;
-			VALUE str = rb_big2str(summand, 10);
-			mpf_init_set_str(tempSub, StringValuePtr(str), 10);
-			mpf_add(*r, *f, tempSub);
-			mpf_clear(tempSub);
-			break;
+		case OPERAND_BIGNUM: {
+			mpz_t tempBig;
+			mpz_init(tempBig);
+			RGMP_COUNT(STAT_TEMPORARIES, 1);
+			num2mpz(tempBig, other);
+			
+			if (op->fz != NULL) {
+				op->fz(r, f, tempBig);
+			} else if (op->ff != NULL) {
+				mpf_init2(tempOther, mpz_sizeinbase(tempBig, 2));
+				RGMP_COUNT(STAT_TEMPORARIES, 1);
+				mpf_set_z(tempOther, tempBig);
+				op->ff(r, f, tempOther);
+				mpf_clear(tempOther);
+			} else {
+				mpz_clear(tempBig);
+				break;
+			}
+			
+			mpz_clear(tempBig);
+			return;
+		}
+		case OPERAND_RATIONAL: {
+			if (op->fq != NULL) {
+				op->fq(r, f, MPQ_OF(other));
+				return;
+			}
+			
+			if (op->ff == NULL)
+				break;
+			mpf_init2(tempOther, mpf_get_prec(r));
+			RGMP_COUNT(STAT_TEMPORARIES, 1);
+			mpf_set_q(tempOther, MPQ_OF(other));
+			op->ff(r, f, tempOther);
+			mpf_clear(tempOther);
+			return;
 		}
 		default: {
-			rb_raise(rb_eTypeError, "input data type not supported");
+			break;
 		}
 	}
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	rb_raise(rb_eTypeError, "input data type not supported");
 }
 
-// Subtraction (-)
-// {GMP::Float, Float, Fixnum, Bignum} -> {GMP::Float}
-VALUE
-f_subtraction( VALUE self, VALUE subtraend ) {
-	// Creates pointers to self's and the result's mpf_t structures
-	mpf_t *r = malloc(sizeof(*r));
-	mpf_t *f;
-	
-	// Loads self into *f
-	Data_Get_Struct(self, mpf_t, f);
-	
-	// Inits the result
-	mpf_init(*r);
+// Loads any operand f_apply takes, for the in-place methods taking more than
+// one source or a source of their own: a GMP::Float as it is, others into a
+// temporary GMP::Float kept alive through *holder (the caller must
+// RB_GC_GUARD it), exactly but for rationals, which are rounded to prec bits
+static mpf_srcptr
+f_operand( VALUE other, unsigned long prec, VALUE *holder ) {
+	mpf_t *t;
 	
-	// Decides what to do based on the subtraend's type/class
-	switch (TYPE(subtraend)) {
-		case T_DATA: {
-			if (rb_obj_class(subtraend) == cGMPFloat) {
-				mpf_t *sd;
-				Data_Get_Struct(subtraend, mpf_t, sd);
-				mpf_sub(*r, *f, *sd);
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
+	switch (operand_kind(other)) {
+		case OPERAND_GMPF: {
+			return MPF_OF(other);
+		}
+		case OPERAND_FIXNUM: {
+			*holder = float_create(&t);
+			mpf_set_prec(*t, sizeof(long) * CHAR_BIT);
+			mpf_set_si(*t, FIX2LONG(other));
 			break;
 		}
-		case T_FLOAT: {
-#ifndef MPFR
-			// GMP does not provide support for adding a mpf_t to a C double
-			// so first we have to convert Ruby's Float to a mpf_t and then do
-			// the operation
-			mpf_t tempSufl;
-			mpf_init_set_d(tempSufl, NUM2DBL(subtraend));
-			mpf_sub(*r, *f, tempSufl);
-			mpf_clear(tempSufl);
-#else
-			double ds = NUM2DBL(subtraend);
-			mpfr_sub_d(*r, *f, ds, GMP_RNDN);
-#endif
+		case OPERAND_FLOAT: {
+			*holder = float_create(&t);
+			mpf_set_prec(*t, DBL_MANT_DIG);
+			mpf_set_d(*t, RFLOAT_VALUE(other));
 			break;
 		}
-		case T_FIXNUM: {
-			// Likewise, Ruby's Fixnum should first be converted to a mpf_float
-			// to keep the sign.
-			// I have a feeling this can be done otherwise, with some size
-			// checking, though it would still feel like a bad hack.
-			mpf_t tempSufi;
-			mpf_init_set_si(tempSufi, FIX2LONG(subtraend));
-			mpf_sub(*r, *f, tempSufi);
-			mpf_clear(tempSufi);
+		case OPERAND_INTEGER:
+		case OPERAND_BIGNUM: {
+			mpz_t *z;
+			VALUE integer = integer_create(&z);
+			integral2mpz(*z, other);
+			*holder = float_create(&t);
+			mpf_set_prec(*t, mpz_sizeinbase(*z, 2) + 1);
+			mpf_set_z(*t, *z);
+			RB_GC_GUARD(integer);
 			break;
 		}
-		case T_BIGNUM: {
-			mpf_t tempSub;
-			VALUE str = rb_big2str(subtraend, 10);
-			mpf_init_set_str(tempSub, StringValuePtr(str), 10);
-			mpf_sub(*r, *f, tempSub);
-			mpf_clear(tempSub);
+		case OPERAND_RATIONAL: {
+			*holder = float_create(&t);
+			mpf_set_prec(*t, prec);
+			mpf_set_q(*t, MPQ_OF(other));
 			break;
 		}
 		default: {
@@ -268,178 +324,178 @@ f_subtraction( VALUE self, VALUE subtraend ) {
 		}
 	}
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return *t;
 }
 
-// Multiplication (*)
-// {GMP::Float, Float, Fixnum, Bignum} -> {GMP::Float}
+#ifdef MPFR
+// MPFR has a native function for every operand type; these only add the
+// rounding mode
+#define F_MPFR_OPERATOR(name) \
+static void \
+f_##name##_mpf( mpf_ptr r, mpf_srcptr f, mpf_srcptr o ) { \
+	mpfr_##name(r, f, o, GMP_RNDN); \
+} \
+static void \
+f_##name##_long( mpf_ptr r, mpf_srcptr f, long l ) { \
+	mpfr_##name##_si(r, f, l, GMP_RNDN); \
+} \
+static void \
+f_##name##_double( mpf_ptr r, mpf_srcptr f, double d ) { \
+	mpfr_##name##_d(r, f, d, GMP_RNDN); \
+} \
+static void \
+f_##name##_mpz( mpf_ptr r, mpf_srcptr f, mpz_srcptr z ) { \
+	mpfr_##name##_z(r, f, z, GMP_RNDN); \
+} \
+static void \
+f_##name##_mpq( mpf_ptr r, mpf_srcptr f, mpq_srcptr q ) { \
+	mpfr_##name##_q(r, f, q, GMP_RNDN); \
+} \
+const f_operator f_##name##_op = { \
+	f_##name##_mpf, f_##name##_long, f_##name##_double, \
+	f_##name##_mpz, f_##name##_mpq \
+};
+
+F_MPFR_OPERATOR(add)
+F_MPFR_OPERATOR(sub)
+F_MPFR_OPERATOR(mul)
+F_MPFR_OPERATOR(div)
+
+static void
+f_pow_mpf( mpf_ptr r, mpf_srcptr f, mpf_srcptr e ) {
+	mpfr_pow(r, f, e, GMP_RNDN);
+}
+
+static void
+f_pow_long( mpf_ptr r, mpf_srcptr f, long l ) {
+	mpfr_pow_si(r, f, l, GMP_RNDN);
+}
+
+static void
+f_pow_mpz( mpf_ptr r, mpf_srcptr f, mpz_srcptr z ) {
+	mpfr_pow_z(r, f, z, GMP_RNDN);
+}
+
+const f_operator f_pow_op = { f_pow_mpf, f_pow_long, NULL, f_pow_mpz, NULL };
+#else
+// Plain GMP only has unsigned long variants, so the sign is handled here
+static void
+f_add_long( mpf_ptr r, mpf_srcptr f, long l ) {
+	if (l >= 0)
+		mpf_add_ui(r, f, l);
+	else
+		mpf_sub_ui(r, f, -(unsigned long) l);
+}
+
+static void
+f_sub_long( mpf_ptr r, mpf_srcptr f, long l ) {
+	if (l >= 0)
+		mpf_sub_ui(r, f, l);
+	else
+		mpf_add_ui(r, f, -(unsigned long) l);
+}
+
+static void
+f_mul_long( mpf_ptr r, mpf_srcptr f, long l ) {
+	mpf_mul_ui(r, f, (l >= 0) ? (unsigned long) l : -(unsigned long) l);
+	if (l < 0)
+		mpf_neg(r, r);
+}
+
+// Unlike MPFR, GMP has no infinities, so dividing by zero is an error
+static void
+f_div_mpf( mpf_ptr r, mpf_srcptr f, mpf_srcptr d ) {
+	if (mpf_sgn(d) == 0)
+		rb_raise(rb_eZeroDivError, "divided by 0");
+	mpf_div(r, f, d);
+}
+
+static void
+f_div_long( mpf_ptr r, mpf_srcptr f, long l ) {
+	if (l == 0)
+		rb_raise(rb_eZeroDivError, "divided by 0");
+	mpf_div_ui(r, f, (l > 0) ? (unsigned long) l : -(unsigned long) l);
+	if (l < 0)
+		mpf_neg(r, r);
+}
+
+static void
+f_div_double( mpf_ptr r, mpf_srcptr f, double d ) {
+	if (d == 0.0)
+		rb_raise(rb_eZeroDivError, "divided by 0");
+	
+	mpf_t tempDouble;
+	mpf_init2(tempDouble, DBL_MANT_DIG);
+	RGMP_COUNT(STAT_TEMPORARIES, 1);
+	mpf_set_d(tempDouble, d);
+	mpf_div(r, f, tempDouble);
+	mpf_clear(tempDouble);
+}
+
+// GMP only supports non-negative integral exponents
+static void
+f_pow_long( mpf_ptr r, mpf_srcptr f, long l ) {
+	if (l < 0)
+		rb_raise(rb_eRangeError, "exponent must be non-negative");
+	mpf_pow_ui(r, f, l);
+}
+
+const f_operator f_add_op = { mpf_add, f_add_long, NULL, NULL, NULL };
+const f_operator f_sub_op = { mpf_sub, f_sub_long, NULL, NULL, NULL };
+const f_operator f_mul_op = { mpf_mul, f_mul_long, NULL, NULL, NULL };
+const f_operator f_div_op = { f_div_mpf, f_div_long, f_div_double, NULL, NULL };
+const f_operator f_pow_op = { NULL, f_pow_long, NULL, NULL, NULL };
+#endif
+
+// Creates a new GMP::Float holding self OP other
 VALUE
-f_multiplication( VALUE self, VALUE multiplicand ) {
+f_binary_operation( VALUE self, VALUE other, const f_operator *op ) {
 	// Creates pointers to self's and the result's mpf_t structures
-	mpf_t *r = malloc(sizeof(*r));
+	mpf_t *r;
+	VALUE result = float_create(&r);
 	mpf_t *f;
 	
 	// Loads self into *f
-	Data_Get_Struct(self, mpf_t, f);
+	TypedData_Get_Struct(self, mpf_t, &float_type, f);
 	
-	// Inits the result
-	mpf_init(*r);
-	
-	// Decides what to do based on the multiplicand's type/class
-	switch (TYPE(multiplicand)) {
-		case T_DATA: {
-			if (rb_obj_class(multiplicand) == cGMPFloat) {
-				mpf_t *md;
-				Data_Get_Struct(multiplicand, mpf_t, md);
-				mpf_mul(*r, *f, *md);
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
-			break;
-		}
-		case T_FLOAT: {
-#ifndef MPFR
-			// GMP does not provide support for multiplying a mpf_t with a
-			// C double, so first we have to convert Ruby's Float to a mpf_t
-			// and then do the operation
-			mpf_t tempMufl;
-			mpf_init_set_d(tempMufl, NUM2DBL(multiplicand));
-			mpf_mul(*r, *f, tempMufl);
-			mpf_clear(tempMufl);
-#else
-			double dm = NUM2DBL(multiplicand);
-			mpfr_mul_d(*r, *f, dm, GMP_RNDN);
-#endif
-			break;
-		}
-		case T_FIXNUM: {
-			signed long ml = FIX2LONG(multiplicand);
-			mpf_mul_ui(*r, *f, (ml > 0) ? ml : -ml);
-			if (ml < 0)
-				mpf_neg(*r, *r);
-			break;
-		}
-		case T_BIGNUM: {
-			mpf_t tempMub;
-			VALUE str = rb_big2str(multiplicand, 10);
-			mpf_init_set_str(tempMub, StringValuePtr(str), 10);
-			mpf_mul(*r, *f, tempMub);
-			mpf_clear(tempMub);
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "input data type not supported");
-		}
-	}
+	f_apply(*r, *f, other, op);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
+}
+
+// Addition (+)
+// {GMP::Float, Float, Fixnum, Bignum, GMP::Integer, GMP::Rational} -> {GMP::Float}
+VALUE
+f_addition( VALUE self, VALUE summand ) {
+	return f_binary_operation(self, summand, &f_add_op);
+}
+
+// Subtraction (-)
+// {GMP::Float, Float, Fixnum, Bignum, GMP::Integer, GMP::Rational} -> {GMP::Float}
+VALUE
+f_subtraction( VALUE self, VALUE subtraend ) {
+	return f_binary_operation(self, subtraend, &f_sub_op);
+}
+
+// Multiplication (*)
+// {GMP::Float, Float, Fixnum, Bignum, GMP::Integer, GMP::Rational} -> {GMP::Float}
+VALUE
+f_multiplication( VALUE self, VALUE multiplicand ) {
+	return f_binary_operation(self, multiplicand, &f_mul_op);
 }
 
 // Division (/)
-// {GMP::Float, Float, Fixnum, Bignum} -> {GMP::Float}
+// {GMP::Float, Float, Fixnum, Bignum, GMP::Integer, GMP::Rational} -> {GMP::Float}
 VALUE
 f_division( VALUE self, VALUE dividend ) {
-	// Creates pointers to self's and the result's mpf_t structures
-	mpf_t *r = malloc(sizeof(*r));
-	mpf_t *f;
-	
-	// Loads self into *f
-	Data_Get_Struct(self, mpf_t, f);
-	
-	// Inits the result
-	mpf_init(*r);
-	
-	// Decides what to do based on the dividend's type/class
-	switch (TYPE(dividend)) {
-		case T_DATA: {
-			if (rb_obj_class(dividend) == cGMPFloat) {
-				mpf_t *dd;
-				Data_Get_Struct(dividend, mpf_t, dd);
-				mpf_div(*r, *f, *dd);
-			} else {
-				rb_raise(rb_eTypeError, "dividend's class not supported");
-			}
-			break;
-		}
-		case T_FLOAT: {
-#ifndef MPFR
-			// GMP does not provide support for dividing a mpf_t by a
-			// C double, so first we have to convert Ruby's Float to a mpf_t
-			// and then do the operation
-			mpf_t tempDifl;
-			mpf_init_set_d(tempDifl, NUM2DBL(dividend));
-			mpf_div(*r, *f, tempDifl);
-			mpf_clear(tempDifl);
-#else
-			double df = NUM2DBL(dividend);
-			mpfr_div_d(*r, *f, df, GMP_RNDN);
-#endif
-			break;
-		}
-		case T_FIXNUM: {
-			signed long dl = FIX2LONG(dividend);
-			mpf_div_ui(*r, *f, (dl > 0) ? dl : -dl);
-			if (dl < 0)
-				mpf_neg(*r, *r);
-			break;
-		}
-		case T_BIGNUM: {
-			mpf_t tempDib;
-			VALUE str = rb_big2str(dividend, 10);
-			mpf_init_set_str(tempDib, StringValuePtr(str), 10);
-			mpf_div(*r, *f, tempDib);
-			mpf_clear(tempDib);
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "dividend's class not supported");
-		}
-	}
-	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return f_binary_operation(self, dividend, &f_div_op);
 }
 
 // Exponentiation (**)
-// {(mpfr) GMP::Float, Fixnum} -> {GMP::Float}
+// {(mpfr) GMP::Float, Fixnum, (mpfr) Bignum, (mpfr) GMP::Integer} -> {GMP::Float}
 VALUE
 f_power( VALUE self, VALUE exponent ) {
-	// Creates pointers to self's and the result's mpf_t structures
-	mpf_t *r = malloc(sizeof(*r));
-	mpf_t *f;
-	
-	// Loads self into *f
-	Data_Get_Struct(self, mpf_t, f);
-	
-	// Inits the result
-	mpf_init(*r);
-	
-#ifndef MPFR
-	// GMP only supports positive integral exponents
-	if (!FIXNUM_P(exponent))
-		rb_raise(rb_eTypeError, "exponent must be a (positive) Fixnum");
-	mpf_pow_ui(*r, *f, FIX2LONG(exponent));
-#else
-	switch (TYPE(exponent)) {
-		case T_DATA: {
-			if (rb_obj_class(exponent) == cGMPFloat) {
-				mpfr_t *ef;
-				Data_Get_Struct(exponent, mpfr_t, ef);
-				mpfr_pow(*r, *f, *ef, GMP_RNDN);
-			} else {
-				rb_raise(rb_eTypeError, "exponent's type is not supported");
-			}
-			break;
-		}
-		case T_FIXNUM: {
-			mpfr_pow_si(*r, *f, FIX2LONG(exponent), GMP_RNDN);
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "exponent's type is not supported");
-		}
-	}
-#endif
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return f_binary_operation(self, exponent, &f_pow_op);
 }
 //// end of binary operator methods
 ////////////////////////////////////////////////////////////////////
@@ -458,287 +514,110 @@ f_positive( VALUE self ) {
 VALUE
 f_negation( VALUE self ) {
 	// Creates pointers to self's and the result's mpf_t structures
-	mpf_t *r = malloc(sizeof(*r));
+	mpf_t *r;
+	VALUE result = float_create(&r);
 	mpf_t *f;
 	
 	// Loads self into *f
-	Data_Get_Struct(self, mpf_t, f);
-	
-	// Inits the result
-	mpf_init(*r);
+	TypedData_Get_Struct(self, mpf_t, &float_type, f);
 	
 	// Negates i, and copies the result to r
 	mpf_neg(*r, *f);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 //// end of unary operator methods
 ////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////
 //// Comparison methods
-// Equality (==)
-// {GMP::Float, Float} -> {TrueClass, FalseClass}
-VALUE
-f_equality_test( VALUE self, VALUE other ) {
+// Compares self with other, returning a negative number, zero or a positive
+// number, like mpf_cmp
+int
+f_compare( VALUE self, VALUE other ) {
 	// Creates a mpf_t pointer and loads self in it
 	mpf_t *f;
-	Data_Get_Struct(self, mpf_t, f);
+	TypedData_Get_Struct(self, mpf_t, &float_type, f);
 	
-	// Immediate responses to avoid one object creation
-	switch (TYPE(other)) {
-		case T_DATA: {
-			if (rb_obj_class(other) == cGMPFloat) {
-				mpf_t *od;
-				Data_Get_Struct(other, mpf_t, od);
-				
-				if (mpf_cmp(*f, *od) == 0)
-					return Qtrue;
-				else
-					return Qfalse;
-			} else {
-				// I seriously need to start working on these error messages
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
-			break;
+	switch (operand_kind(other)) {
+		case OPERAND_GMPF: {
+			return mpf_cmp(*f, MPF_OF(other));
 		}
-		case T_FLOAT: {
-			double of = RFLOAT_VALUE(other);
-			
-			if (mpf_cmp_d(*f, of) == 0)
-				return Qtrue;
-			else
-				return Qfalse;
-			
-			break;
+		case OPERAND_FLOAT: {
+			return mpf_cmp_d(*f, RFLOAT_VALUE(other));
+		}
+		case OPERAND_FIXNUM: {
+			return mpf_cmp_si(*f, FIX2LONG(other));
+		}
+		case OPERAND_INTEGER: {
+#ifdef MPFR
+			return mpfr_cmp_z(*f, MPZ_OF(other));
+#else
+			return mpf_cmp_z(*f, MPZ_OF(other));
+#endif
+		}
+		case OPERAND_BIGNUM: {
+			mpz_t tempBig;
+			mpz_init(tempBig);
+			RGMP_COUNT(STAT_TEMPORARIES, 1);
+			num2mpz(tempBig, other);
+#ifdef MPFR
+			int result = mpfr_cmp_z(*f, tempBig);
+#else
+			int result = mpf_cmp_z(*f, tempBig);
+#endif
+			mpz_clear(tempBig);
+			return result;
 		}
 		default: {
 			rb_raise(rb_eTypeError, "input data type not supported");
 		}
 	}
-	
-	// I'm guessing no compilers will complain about the lack of this?
-	// Anyhow, just in case...
-	return Qfalse;
+}
+
+// Equality (==)
+// {GMP::Float, Float, Fixnum, Bignum, GMP::Integer} -> {TrueClass, FalseClass}
+VALUE
+f_equality_test( VALUE self, VALUE other ) {
+	return (f_compare(self, other) == 0) ? Qtrue : Qfalse;
 }
 
 // Greater than (>)
-// {GMP::Float, Float} -> {TrueClass, FalseClass}
+// {GMP::Float, Float, Fixnum, Bignum, GMP::Integer} -> {TrueClass, FalseClass}
 VALUE
 f_greater_than_test( VALUE self, VALUE other ) {
-	// Creates a mpf_t pointer and loads self in it
-	mpf_t *f;
-	Data_Get_Struct(self, mpf_t, f);
-	
-	// Immediate responses to avoid one object creation
-	switch (TYPE(other)) {
-		case T_DATA: {
-			if (rb_obj_class(other) == cGMPFloat) {
-				mpf_t *od;
-				Data_Get_Struct(other, mpf_t, od);
-				
-				if (mpf_cmp(*f, *od) > 0)
-					return Qtrue;
-				else
-					return Qfalse;
-			} else {
-				// I seriously need to start working on these error messages
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
-			break;
-		}
-		case T_FLOAT: {
-			double of = RFLOAT_VALUE(other);
-			
-			if (mpf_cmp_d(*f, of) > 0)
-				return Qtrue;
-			else
-				return Qfalse;
-			
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "input data type not supported");
-		}
-	}
-	
-	// I'm guessing no compilers will complain about the lack of this?
-	// Anyhow, just in case...
-	return Qfalse;
+	return (f_compare(self, other) > 0) ? Qtrue : Qfalse;
 }
 
-// Less than (>)
-// {GMP::Float, Float} -> {TrueClass, FalseClass}
+// Less than (<)
+// {GMP::Float, Float, Fixnum, Bignum, GMP::Integer} -> {TrueClass, FalseClass}
 VALUE
 f_less_than_test( VALUE self, VALUE other ) {
-	// Creates a mpf_t pointer and loads self in it
-	mpf_t *f;
-	Data_Get_Struct(self, mpf_t, f);
-	
-	// Immediate responses to avoid one object creation
-	switch (TYPE(other)) {
-		case T_DATA: {
-			if (rb_obj_class(other) == cGMPFloat) {
-				mpf_t *od;
-				Data_Get_Struct(other, mpf_t, od);
-				
-				if (mpf_cmp(*f, *od) < 0)
-					return Qtrue;
-				else
-					return Qfalse;
-			} else {
-				// I seriously need to start working on these error messages
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
-			break;
-		}
-		case T_FLOAT: {
-			double of = RFLOAT_VALUE(other);
-			
-			if (mpf_cmp_d(*f, of) < 0)
-				return Qtrue;
-			else
-				return Qfalse;
-			
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "input data type not supported");
-		}
-	}
-	
-	// I'm guessing no compilers will complain about the lack of this?
-	// Anyhow, just in case...
-	return Qfalse;
+	return (f_compare(self, other) < 0) ? Qtrue : Qfalse;
 }
 
 // Greater than or equal to (>=)
-// {GMP::Float, Float} -> {TrueClass, FalseClass}
+// {GMP::Float, Float, Fixnum, Bignum, GMP::Integer} -> {TrueClass, FalseClass}
 VALUE
 f_greater_than_or_equal_to_test( VALUE self, VALUE other ) {
-	// Creates a mpf_t pointer and loads self in it
-	mpf_t *f;
-	Data_Get_Struct(self, mpf_t, f);
-	
-	// Immediate responses to avoid one object creation
-	switch (TYPE(other)) {
-		case T_DATA: {
-			if (rb_obj_class(other) == cGMPFloat) {
-				mpf_t *od;
-				Data_Get_Struct(other, mpf_t, od);
-				
-				if (mpf_cmp(*f, *od) >= 0)
-					return Qtrue;
-				else
-					return Qfalse;
-			} else {
-				// I seriously need to start working on these error messages
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
-			break;
-		}
-		case T_FLOAT: {
-			double of = RFLOAT_VALUE(other);
-			
-			if (mpf_cmp_d(*f, of) >= 0)
-				return Qtrue;
-			else
-				return Qfalse;
-			
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "input data type not supported");
-		}
-	}
-	
-	// I'm guessing no compilers will complain about the lack of this?
-	// Anyhow, just in case...
-	return Qfalse;
+	return (f_compare(self, other) >= 0) ? Qtrue : Qfalse;
 }
 
 // Less than or equal to (<=)
-// {GMP::Float, Float} -> {TrueClass, FalseClass}
+// {GMP::Float, Float, Fixnum, Bignum, GMP::Integer} -> {TrueClass, FalseClass}
 VALUE
 f_less_than_or_equal_to_test( VALUE self, VALUE other ) {
-	// Creates a mpf_t pointer and loads self in it
-	mpf_t *f;
-	Data_Get_Struct(self, mpf_t, f);
-	
-	// Immediate responses to avoid one object creation
-	switch (TYPE(other)) {
-		case T_DATA: {
-			if (rb_obj_class(other) == cGMPFloat) {
-				mpf_t *od;
-				Data_Get_Struct(other, mpf_t, od);
-				
-				if (mpf_cmp(*f, *od) <= 0)
-					return Qtrue;
-				else
-					return Qfalse;
-			} else {
-				// I seriously need to start working on these error messages
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
-			break;
-		}
-		case T_FLOAT: {
-			double of = RFLOAT_VALUE(other);
-			
-			if (mpf_cmp_d(*f, of) <= 0)
-				return Qtrue;
-			else
-				return Qfalse;
-			
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "input data type not supported");
-		}
-	}
-	
-	// I'm guessing no compilers will complain about the lack of this?
-	// Anyhow, just in case...
-	return Qfalse;
+	return (f_compare(self, other) <= 0) ? Qtrue : Qfalse;
 }
 
 // Generic comparison (<=>)
-// {GMP::Float, Float} -> {Fixnum}
+// {GMP::Float, Float, Fixnum, Bignum, GMP::Integer} -> {Fixnum}
 VALUE
 f_generic_comparison( VALUE self, VALUE other ) {
-	// Creates a mpf_t pointer and loads self in it
-	mpf_t *f;
-	Data_Get_Struct(self, mpf_t, f);
-	
-	// Immediate responses to avoid one object creation
-	switch (TYPE(other)) {
-		case T_DATA: {
-			if (rb_obj_class(other) == cGMPFloat) {
-				mpf_t *od;
-				Data_Get_Struct(other, mpf_t, od);
-				
-				return INT2FIX(mpf_cmp(*f, *od));
-			} else {
-				// I seriously need to start working on these error messages
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
-			break;
-		}
-		case T_FLOAT: {
-			double of = RFLOAT_VALUE(other);
-			
-			return INT2FIX(mpf_cmp_d(*f, of));
-			
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "input data type not supported");
-		}
-	}
+	int result = f_compare(self, other);
 	
-	// I'm guessing no compilers will complain about the lack of this?
-	// Anyhow, just in case...
-	return Qfalse;
+	// mpf_cmp only promises the sign of its result
+	return INT2FIX((result > 0) - (result < 0));
 }
 //// end of comparison methods
 ////////////////////////////////////////////////////////////////////
@@ -751,7 +630,7 @@ VALUE
 f_integer( VALUE self ) {
 	// Creates a mpf_t pointer and loads self into it
 	mpf_t *s;
-	Data_Get_Struct(self, mpf_t, s);
+	TypedData_Get_Struct(self, mpf_t, &float_type, s);
 	
 	if (mpf_integer_p(*s))
 		return Qtrue;
@@ -768,18 +647,16 @@ f_integer( VALUE self ) {
 VALUE
 f_ceil( VALUE self ) {
 	// Creates pointers to self's and the result's mpf_t structures
-	mpf_t *r = malloc(sizeof(*r));
+	mpf_t *r;
+	VALUE result = float_create(&r);
 	mpf_t *s;
 	
 	// Loads self from Ruby
-	Data_Get_Struct(self, mpf_t, s);
-	
-	// Inits the result
-	mpf_init(*r);
+	TypedData_Get_Struct(self, mpf_t, &float_type, s);
 	
 	mpf_ceil(*r, *s);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Floor (rounds down)
@@ -787,18 +664,16 @@ f_ceil( VALUE self ) {
 VALUE
 f_floor( VALUE self ) {
 	// Creates pointers to self's and the result's mpf_t structures
-	mpf_t *r = malloc(sizeof(*r));
+	mpf_t *r;
+	VALUE result = float_create(&r);
 	mpf_t *s;
 	
 	// Loads self from Ruby
-	Data_Get_Struct(self, mpf_t, s);
-	
-	// Inits the result
-	mpf_init(*r);
+	TypedData_Get_Struct(self, mpf_t, &float_type, s);
 	
 	mpf_floor(*r, *s);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Truncate (rounds towards zero)
@@ -806,18 +681,16 @@ f_floor( VALUE self ) {
 VALUE
 f_truncate( VALUE self ) {
 	// Creates pointers to self's and the result's mpf_t structures
-	mpf_t *r = malloc(sizeof(*r));
+	mpf_t *r;
+	VALUE result = float_create(&r);
 	mpf_t *s;
 	
 	// Loads self from Ruby
-	Data_Get_Struct(self, mpf_t, s);
-	
-	// Inits the result
-	mpf_init(*r);
+	TypedData_Get_Struct(self, mpf_t, &float_type, s);
 	
 	mpf_trunc(*r, *s);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 //// end of rounding methods
 ////////////////////////////////////////////////////////////////////
@@ -832,7 +705,7 @@ f_set_precision( VALUE self, VALUE precision ) {
 	// Also loads the precision into an unsigned long.
 	mpf_t *s;
 	long longPrecision = FIX2INT(precision);
-	Data_Get_Struct(self, mpf_t, s);
+	TypedData_Get_Struct(self, mpf_t, &float_type, s);
 	
 #ifndef MPFR
 	// Sets the object's minimum precision
@@ -851,7 +724,7 @@ VALUE
 f_get_precision( VALUE self ) {
 	// Creates a mpf_t pointer and loads self in it.
 	mpf_t *s;
-	Data_Get_Struct(self, mpf_t, s);
+	TypedData_Get_Struct(self, mpf_t, &float_type, s);
 	
 	// Sets the object's minimum precision
 	long longPrecision = mpf_get_prec(*s);
@@ -867,8 +740,8 @@ f_swap( VALUE self, VALUE other ) {
 	mpf_t *f, *o;
 	
 	// Copies back the mpf_t pointers wrapped in ruby data objects
-	Data_Get_Struct(self, mpf_t, f);
-	Data_Get_Struct(other, mpf_t, o);
+	TypedData_Get_Struct(self, mpf_t, &float_type, f);
+	TypedData_Get_Struct(other, mpf_t, &float_type, o);
 	
 	// Swaps the contents of self and other
 	mpf_swap(*f, *o);
@@ -881,19 +754,17 @@ f_swap( VALUE self, VALUE other ) {
 VALUE
 f_absolute( VALUE self ) {
 	// Creates pointers to self's and the result's mpf_t structures
-	mpf_t *r = malloc(sizeof(*r));
+	mpf_t *r;
+	VALUE result = float_create(&r);
 	mpf_t *s;
 	
 	// Loads self from Ruby
-	Data_Get_Struct(self, mpf_t, s);
-	
-	// Inits the result
-	mpf_init(*r);
+	TypedData_Get_Struct(self, mpf_t, &float_type, s);
 	
 	// Sets the result as the absolute value of self
 	mpf_abs(*r, *s);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Relative difference ( |a - b|/a )
@@ -902,19 +773,17 @@ VALUE
 f_relative_difference( VALUE self, VALUE other ) {
 	// Creates pointers to self's, other's and result's mpf_t structures
 	mpf_t *f, *o;
-	mpf_t *r = malloc(sizeof(*r));
+	mpf_t *r;
+	VALUE result = float_create(&r);
 	
 	// Copies back the mpf_t pointers from ruby to C
-	Data_Get_Struct(self, mpf_t, f);
-	Data_Get_Struct(other, mpf_t, o);
-	
-	// Inits the result
-	mpf_init(*r);
+	TypedData_Get_Struct(self, mpf_t, &float_type, f);
+	TypedData_Get_Struct(other, mpf_t, &float_type, o);
 	
 	// Does the calculation
 	mpf_reldiff(*r, *f, *o);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Coercion (makes operations commutative)
@@ -927,6 +796,101 @@ f_coerce( VALUE self, VALUE other ) {
 //// end of other methods
 ////////////////////////////////////////////////////////////////////
 
+////////////////////////////////////////////////////////////////////
+//// Inplace methods (the caller inherits the result)
+// These round to self's own precision and reuse its limbs, instead of
+// allocating a new number at the default precision.
+// Sets self to self OP other
+static VALUE
+f_inplace_operation( VALUE self, VALUE other, const f_operator *op ) {
+	// Creates a mpf_t pointer and loads self in it
+	mpf_t *f;
+	TypedData_Get_Struct(self, mpf_t, &float_type, f);
+	
+	f_apply(*f, *f, other, op);
+	
+	return Qnil;
+}
+
+// Addition (in-place)
+// {GMP::Float, Float, Fixnum, Bignum, GMP::Integer, GMP::Rational} -> {NilClass}
+VALUE
+f_addition_inplace( VALUE self, VALUE summand ) {
+	return f_inplace_operation(self, summand, &f_add_op);
+}
+
+// Subtraction (in-place)
+// {GMP::Float, Float, Fixnum, Bignum, GMP::Integer, GMP::Rational} -> {NilClass}
+VALUE
+f_subtraction_inplace( VALUE self, VALUE subtraend ) {
+	return f_inplace_operation(self, subtraend, &f_sub_op);
+}
+
+// Multiplication (in-place)
+// {GMP::Float, Float, Fixnum, Bignum, GMP::Integer, GMP::Rational} -> {NilClass}
+VALUE
+f_multiplication_inplace( VALUE self, VALUE multiplicand ) {
+	return f_inplace_operation(self, multiplicand, &f_mul_op);
+}
+
+// Division (in-place)
+// {GMP::Float, Float, Fixnum, Bignum, GMP::Integer, GMP::Rational} -> {NilClass}
+VALUE
+f_division_inplace( VALUE self, VALUE dividend ) {
+	return f_inplace_operation(self, dividend, &f_div_op);
+}
+
+// Negation (in-place)
+// {} -> {NilClass}
+VALUE
+f_negation_inplace( VALUE self ) {
+	// Creates a mpf_t pointer and loads self in it
+	mpf_t *f;
+	TypedData_Get_Struct(self, mpf_t, &float_type, f);
+	
+	mpf_neg(*f, *f);
+	
+	return Qnil;
+}
+
+// Absolute value (in-place)
+// {} -> {NilClass}
+VALUE
+f_absolute_inplace( VALUE self ) {
+	// Creates a mpf_t pointer and loads self in it
+	mpf_t *f;
+	TypedData_Get_Struct(self, mpf_t, &float_type, f);
+	
+	mpf_abs(*f, *f);
+	
+	return Qnil;
+}
+
+// Square root (in-place); self = sqrt(self), or self = sqrt(radicand)
+// {[GMP::Float, Float, Fixnum, Bignum, GMP::Integer, GMP::Rational]} -> {NilClass}
+VALUE
+f_sqrt_inplace( int argc, VALUE *argv, VALUE self ) {
+	// Creates pointers to self's and the radicand's mpf_t structures
+	mpf_t *f;
+	mpf_srcptr rd;
+	VALUE radicand, holder = Qnil;
+	rb_scan_args(argc, argv, "01", &radicand);
+	
+	TypedData_Get_Struct(self, mpf_t, &float_type, f);
+	rd = *f;
+	if (!NIL_P(radicand))
+		rd = f_operand(radicand, mpf_get_prec(*f), &holder);
+	
+	if (mpf_sgn(rd) == -1)
+		rb_raise(rb_eRuntimeError, "radicand is negative");
+	mpf_sqrt(*f, rd);
+	
+	RB_GC_GUARD(holder);
+	return Qnil;
+}
+//// end of inplace methods
+////////////////////////////////////////////////////////////////////
+
 ////////////////////////////////////////////////////////////////////
 //// Singletons/Class methods
 // Sets the default floating point precision.
@@ -965,17 +929,15 @@ f_get_def_prec( VALUE klass ) {
 VALUE
 f_sqrt_singleton( VALUE klass, VALUE radicand ) {
 	// Creates pointer to the result's mpf_t structure
-	mpf_t *r = malloc(sizeof(*r));
-	
-	// Inits the result
-	mpf_init(*r);
+	mpf_t *r;
+	VALUE result = float_create(&r);
 	
 	// Decides what to do based on the radicand's type/class
 	switch (TYPE(radicand)) {
 		case T_DATA: {
 			if (rb_obj_class(radicand) == cGMPFloat) {
 				mpf_t *rd;
-				Data_Get_Struct(radicand, mpf_t, rd);
+				TypedData_Get_Struct(radicand, mpf_t, &float_type, rd);
 				if (mpf_sgn(*rd) == -1)
 					rb_raise(rb_eRuntimeError, "radicand is negative");
 				mpf_sqrt(*r, *rd);
@@ -987,6 +949,7 @@ f_sqrt_singleton( VALUE klass, VALUE radicand ) {
 		case T_FLOAT: {
 			mpf_t tempRafl;
 			mpf_init_set_d(tempRafl, NUM2DBL(radicand));
+			RGMP_COUNT(STAT_TEMPORARIES, 1);
 			if (mpf_sgn(tempRafl) == -1)
 				rb_raise(rb_eRuntimeError, "radicand is negative");
 			mpf_sqrt(*r, tempRafl);
@@ -998,12 +961,61 @@ f_sqrt_singleton( VALUE klass, VALUE radicand ) {
 		}
 	}
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 //// end of singletons/class methods
 ////////////////////////////////////////////////////////////////////
 
 #ifdef MPFR
+////////////////////////////////////////////////////////////////////
+//// Special functions without the GVL (see rgmp_without_gvl in gmp.c)
+typedef struct {
+	f_function function;
+	rgmp_checkpoint cp;
+	mpfr_t r, a;
+} f_kernel;
+
+static void *
+f_kernel_nogvl( void *p ) {
+	f_kernel *k = p;
+	k->function(k->r, k->a, GMP_RNDN);
+	return NULL;
+}
+
+// r = function(a), rounded to r's precision; the GVL is released when r is
+// precise enough for the function to take a while, in which case it works
+// on a copy of a and r only receives the result afterwards
+void
+f_function_apply( f_function function, mpfr_ptr r, mpfr_srcptr a ) {
+	// Special functions cost a few dozen multiplications at r's precision
+	size_t limbs = (mpfr_get_prec(r) + GMP_NUMB_BITS - 1) / GMP_NUMB_BITS;
+	if (!RGMP_NOGVL(16 * limbs)) {
+		function(r, a, GMP_RNDN);
+		return;
+	}
+	
+	f_kernel k;
+	k.function = function;
+	mpfr_init2(k.r, mpfr_get_prec(r));
+	mpfr_init2(k.a, mpfr_get_prec(a));
+	mpfr_set(k.a, a, GMP_RNDN);
+	RGMP_COUNT(STAT_TEMPORARIES, 2);
+	
+	// MPFR functions cannot be split, so an interrupt only takes effect
+	// once the function returns
+	int state = rgmp_without_gvl(f_kernel_nogvl, &k, &k.cp);
+	
+	if (!state)
+		mpfr_swap(r, k.r);
+	mpfr_clear(k.r);
+	mpfr_clear(k.a);
+	
+	if (state)
+		rb_jump_tag(state);
+}
+//// end of special functions without the GVL
+////////////////////////////////////////////////////////////////////
+
 ////////////////////////////////////////////////////////////////////
 //// Question-like methods
 // Is it Not a Number?
@@ -1012,7 +1024,7 @@ VALUE
 f_nan( VALUE self ) {
 	// Loads self into a mpfr_t structure
 	mpfr_t *s;
-	Data_Get_Struct(self, mpfr_t, s);
+	TypedData_Get_Struct(self, mpfr_t, &float_type, s);
 	
 	if (mpfr_nan_p(*s))
 		return Qtrue;
@@ -1026,7 +1038,7 @@ VALUE
 f_inf( VALUE self ) {
 	// Loads self into a mpfr_t structure
 	mpfr_t *s;
-	Data_Get_Struct(self, mpfr_t, s);
+	TypedData_Get_Struct(self, mpfr_t, &float_type, s);
 	
 	if (mpfr_inf_p(*s))
 		return Qtrue;
@@ -1040,7 +1052,7 @@ VALUE
 f_number( VALUE self ) {
 	// Loads self into a mpfr_t structure
 	mpfr_t *s;
-	Data_Get_Struct(self, mpfr_t, s);
+	TypedData_Get_Struct(self, mpfr_t, &float_type, s);
 	
 	if (mpfr_number_p(*s))
 		return Qtrue;
@@ -1054,7 +1066,7 @@ VALUE
 f_zero( VALUE self ) {
 	// Loads self into a mpfr_t structure
 	mpfr_t *s;
-	Data_Get_Struct(self, mpfr_t, s);
+	TypedData_Get_Struct(self, mpfr_t, &float_type, s);
 	
 	if (mpfr_zero_p(*s))
 		return Qtrue;
@@ -1071,19 +1083,17 @@ f_zero( VALUE self ) {
 VALUE
 f_sine( VALUE klass, VALUE angle ) {
 	// Creates pointers to the result's and angle's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *a;
 	
 	// Loads the angle from Ruby
-	Data_Get_Struct(angle, mpfr_t, a);
-	
-	// Inits the result
-	mpfr_init(*r);
+	TypedData_Get_Struct(angle, mpfr_t, &float_type, a);
 	
 	// Does the calculation
-	mpfr_sin(*r, *a, GMP_RNDN);
+	f_function_apply(mpfr_sin, *r, *a);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Cossine
@@ -1091,19 +1101,17 @@ f_sine( VALUE klass, VALUE angle ) {
 VALUE
 f_cossine( VALUE klass, VALUE angle ) {
 	// Creates pointers to the result's and angle's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *a;
 	
 	// Loads the angle from Ruby
-	Data_Get_Struct(angle, mpfr_t, a);
-	
-	// Inits the result
-	mpfr_init(*r);
+	TypedData_Get_Struct(angle, mpfr_t, &float_type, a);
 	
 	// Does the calculation
-	mpfr_cos(*r, *a, GMP_RNDN);
+	f_function_apply(mpfr_cos, *r, *a);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Tangent
@@ -1111,19 +1119,17 @@ f_cossine( VALUE klass, VALUE angle ) {
 VALUE
 f_tangent( VALUE klass, VALUE angle ) {
 	// Creates pointers to the result's and angle's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *a;
 	
 	// Loads the angle from Ruby
-	Data_Get_Struct(angle, mpfr_t, a);
-	
-	// Inits the result
-	mpfr_init(*r);
+	TypedData_Get_Struct(angle, mpfr_t, &float_type, a);
 	
 	// Does the calculation
-	mpfr_tan(*r, *a, GMP_RNDN);
+	f_function_apply(mpfr_tan, *r, *a);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Cotangent
@@ -1131,19 +1137,17 @@ f_tangent( VALUE klass, VALUE angle ) {
 VALUE
 f_cotangent( VALUE klass, VALUE angle ) {
 	// Creates pointers to the result's and angle's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *a;
 	
 	// Loads the angle from Ruby
-	Data_Get_Struct(angle, mpfr_t, a);
-	
-	// Inits the result
-	mpfr_init(*r);
+	TypedData_Get_Struct(angle, mpfr_t, &float_type, a);
 	
 	// Does the calculation
-	mpfr_cot(*r, *a, GMP_RNDN);
+	f_function_apply(mpfr_cot, *r, *a);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Secant
@@ -1151,19 +1155,17 @@ f_cotangent( VALUE klass, VALUE angle ) {
 VALUE
 f_secant( VALUE klass, VALUE angle ) {
 	// Creates pointers to the result's and angle's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *a;
 	
 	// Loads the angle from Ruby
-	Data_Get_Struct(angle, mpfr_t, a);
-	
-	// Inits the result
-	mpfr_init(*r);
+	TypedData_Get_Struct(angle, mpfr_t, &float_type, a);
 	
 	// Does the calculation
-	mpfr_sec(*r, *a, GMP_RNDN);
+	f_function_apply(mpfr_sec, *r, *a);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Cosecant
@@ -1171,19 +1173,17 @@ f_secant( VALUE klass, VALUE angle ) {
 VALUE
 f_cosecant( VALUE klass, VALUE angle ) {
 	// Creates pointers to the result's and angle's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *a;
 	
 	// Loads the angle from Ruby
-	Data_Get_Struct(angle, mpfr_t, a);
-	
-	// Inits the result
-	mpfr_init(*r);
+	TypedData_Get_Struct(angle, mpfr_t, &float_type, a);
 	
 	// Does the calculation
-	mpfr_csc(*r, *a, GMP_RNDN);
+	f_function_apply(mpfr_csc, *r, *a);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Array with sine and cossine
@@ -1191,23 +1191,18 @@ f_cosecant( VALUE klass, VALUE angle ) {
 VALUE
 f_sine_and_cossine( VALUE klass, VALUE angle ) {
 	// Creates pointers to the result's and angle's mpfr_t structures
-	mpfr_t *s = malloc(sizeof(*s));
-	mpfr_t *c = malloc(sizeof(*c));
+	mpfr_t *s;
+	VALUE sine = float_create(&s);
+	mpfr_t *c;
+	VALUE cossine = float_create(&c);
 	mpfr_t *a;
 	
 	// Loads the angle from Ruby
-	Data_Get_Struct(angle, mpfr_t, a);
-	
-	// Inits the result
-	mpfr_inits(*s, *c, (mpfr_ptr) 0);
+	TypedData_Get_Struct(angle, mpfr_t, &float_type, a);
 	
 	// Does the calculation
 	mpfr_sin_cos(*s, *c, *a, GMP_RNDN);
 	
-	// Converts the mpz_t results to VALUEs
-	VALUE sine = Data_Wrap_Struct(cGMPFloat, float_mark, float_free, s);
-	VALUE cossine = Data_Wrap_Struct(cGMPFloat, float_mark, float_free, c);
-	
 	// Creates the resulting array
 	VALUE array = rb_ary_new3(2, sine, cossine);
 	
@@ -1223,19 +1218,17 @@ f_sine_and_cossine( VALUE klass, VALUE angle ) {
 VALUE
 f_asine( VALUE klass, VALUE trig_value ) {
 	// Creates pointers to the result's and trig_value's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *a;
 	
 	// Loads the trig_value from Ruby
-	Data_Get_Struct(trig_value, mpfr_t, a);
-	
-	// Inits the result
-	mpfr_init(*r);
+	TypedData_Get_Struct(trig_value, mpfr_t, &float_type, a);
 	
 	// Does the calculation
-	mpfr_asin(*r, *a, GMP_RNDN);
+	f_function_apply(mpfr_asin, *r, *a);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Inverse cossine
@@ -1243,19 +1236,17 @@ f_asine( VALUE klass, VALUE trig_value ) {
 VALUE
 f_acossine( VALUE klass, VALUE trig_value ) {
 	// Creates pointers to the result's and trig_value's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *a;
 	
 	// Loads the trig_value from Ruby
-	Data_Get_Struct(trig_value, mpfr_t, a);
-	
-	// Inits the result
-	mpfr_init(*r);
+	TypedData_Get_Struct(trig_value, mpfr_t, &float_type, a);
 	
 	// Does the calculation
-	mpfr_acos(*r, *a, GMP_RNDN);
+	f_function_apply(mpfr_acos, *r, *a);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Inverse tangent
@@ -1263,19 +1254,17 @@ f_acossine( VALUE klass, VALUE trig_value ) {
 VALUE
 f_atangent( VALUE klass, VALUE trig_value ) {
 	// Creates pointers to the result's and trig_value's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *a;
 	
 	// Loads the trig_value from Ruby
-	Data_Get_Struct(trig_value, mpfr_t, a);
-	
-	// Inits the result
-	mpfr_init(*r);
+	TypedData_Get_Struct(trig_value, mpfr_t, &float_type, a);
 	
 	// Does the calculation
-	mpfr_atan(*r, *a, GMP_RNDN);
+	f_function_apply(mpfr_atan, *r, *a);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Array with hyperbolic sine and cossine
@@ -1283,23 +1272,18 @@ f_atangent( VALUE klass, VALUE trig_value ) {
 VALUE
 f_hsine_and_hcossine( VALUE klass, VALUE angle ) {
 	// Creates pointers to the result's and angle's mpfr_t structures
-	mpfr_t *s = malloc(sizeof(*s));
-	mpfr_t *c = malloc(sizeof(*c));
+	mpfr_t *s;
+	VALUE sine = float_create(&s);
+	mpfr_t *c;
+	VALUE cossine = float_create(&c);
 	mpfr_t *a;
 	
 	// Loads the angle from Ruby
-	Data_Get_Struct(angle, mpfr_t, a);
-	
-	// Inits the result
-	mpfr_inits(*s, *c, (mpfr_ptr) 0);
+	TypedData_Get_Struct(angle, mpfr_t, &float_type, a);
 	
 	// Does the calculation
 	mpfr_sinh_cosh(*s, *c, *a, GMP_RNDN);
 	
-	// Converts the mpz_t results to VALUEs
-	VALUE sine = Data_Wrap_Struct(cGMPFloat, float_mark, float_free, s);
-	VALUE cossine = Data_Wrap_Struct(cGMPFloat, float_mark, float_free, c);
-	
 	// Creates the resulting array
 	VALUE array = rb_ary_new3(2, sine, cossine);
 	
@@ -1315,19 +1299,17 @@ f_hsine_and_hcossine( VALUE klass, VALUE angle ) {
 VALUE
 f_ahsine( VALUE klass, VALUE trig_value ) {
 	// Creates pointers to the result's and trig_value's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *a;
 	
 	// Loads the trig_value from Ruby
-	Data_Get_Struct(trig_value, mpfr_t, a);
-	
-	// Inits the result
-	mpfr_init(*r);
+	TypedData_Get_Struct(trig_value, mpfr_t, &float_type, a);
 	
 	// Does the calculation
-	mpfr_asinh(*r, *a, GMP_RNDN);
+	f_function_apply(mpfr_asinh, *r, *a);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Inverse hyperbolic cossine
@@ -1335,19 +1317,17 @@ f_ahsine( VALUE klass, VALUE trig_value ) {
 VALUE
 f_ahcossine( VALUE klass, VALUE trig_value ) {
 	// Creates pointers to the result's and trig_value's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *a;
 	
 	// Loads the trig_value from Ruby
-	Data_Get_Struct(trig_value, mpfr_t, a);
-	
-	// Inits the result
-	mpfr_init(*r);
+	TypedData_Get_Struct(trig_value, mpfr_t, &float_type, a);
 	
 	// Does the calculation
-	mpfr_acosh(*r, *a, GMP_RNDN);
+	f_function_apply(mpfr_acosh, *r, *a);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Inverse hyperbolic tangent
@@ -1355,19 +1335,17 @@ f_ahcossine( VALUE klass, VALUE trig_value ) {
 VALUE
 f_ahtangent( VALUE klass, VALUE trig_value ) {
 	// Creates pointers to the result's and trig_value's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *a;
 	
 	// Loads the trig_value from Ruby
-	Data_Get_Struct(trig_value, mpfr_t, a);
-	
-	// Inits the result
-	mpfr_init(*r);
+	TypedData_Get_Struct(trig_value, mpfr_t, &float_type, a);
 	
 	// Does the calculation
-	mpfr_atanh(*r, *a, GMP_RNDN);
+	f_function_apply(mpfr_atanh, *r, *a);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 //// end of inverse hyperbolic trigonometry functions
 ////////////////////////////////////////////////////////////////////
@@ -1379,19 +1357,17 @@ f_ahtangent( VALUE klass, VALUE trig_value ) {
 VALUE
 f_hsine( VALUE klass, VALUE angle ) {
 	// Creates pointers to the result's and angle's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *a;
 	
 	// Loads the angle from Ruby
-	Data_Get_Struct(angle, mpfr_t, a);
-	
-	// Inits the result
-	mpfr_init(*r);
+	TypedData_Get_Struct(angle, mpfr_t, &float_type, a);
 	
 	// Does the calculation
-	mpfr_sinh(*r, *a, GMP_RNDN);
+	f_function_apply(mpfr_sinh, *r, *a);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Hyperbolic cossine
@@ -1399,19 +1375,17 @@ f_hsine( VALUE klass, VALUE angle ) {
 VALUE
 f_hcossine( VALUE klass, VALUE angle ) {
 	// Creates pointers to the result's and angle's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *a;
 	
 	// Loads the angle from Ruby
-	Data_Get_Struct(angle, mpfr_t, a);
-	
-	// Inits the result
-	mpfr_init(*r);
+	TypedData_Get_Struct(angle, mpfr_t, &float_type, a);
 	
 	// Does the calculation
-	mpfr_cosh(*r, *a, GMP_RNDN);
+	f_function_apply(mpfr_cosh, *r, *a);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Hyperbolic tangent
@@ -1419,19 +1393,17 @@ f_hcossine( VALUE klass, VALUE angle ) {
 VALUE
 f_htangent( VALUE klass, VALUE angle ) {
 	// Creates pointers to the result's and angle's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *a;
 	
 	// Loads the angle from Ruby
-	Data_Get_Struct(angle, mpfr_t, a);
-	
-	// Inits the result
-	mpfr_init(*r);
+	TypedData_Get_Struct(angle, mpfr_t, &float_type, a);
 	
 	// Does the calculation
-	mpfr_tanh(*r, *a, GMP_RNDN);
+	f_function_apply(mpfr_tanh, *r, *a);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Hyperbolic cotangent
@@ -1439,19 +1411,17 @@ f_htangent( VALUE klass, VALUE angle ) {
 VALUE
 f_hcotangent( VALUE klass, VALUE angle ) {
 	// Creates pointers to the result's and angle's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *a;
 	
 	// Loads the angle from Ruby
-	Data_Get_Struct(angle, mpfr_t, a);
-	
-	// Inits the result
-	mpfr_init(*r);
+	TypedData_Get_Struct(angle, mpfr_t, &float_type, a);
 	
 	// Does the calculation
-	mpfr_coth(*r, *a, GMP_RNDN);
+	f_function_apply(mpfr_coth, *r, *a);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Hyperbolic secant
@@ -1459,19 +1429,17 @@ f_hcotangent( VALUE klass, VALUE angle ) {
 VALUE
 f_hsecant( VALUE klass, VALUE angle ) {
 	// Creates pointers to the result's and angle's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *a;
 	
 	// Loads the angle from Ruby
-	Data_Get_Struct(angle, mpfr_t, a);
-	
-	// Inits the result
-	mpfr_init(*r);
+	TypedData_Get_Struct(angle, mpfr_t, &float_type, a);
 	
 	// Does the calculation
-	mpfr_sech(*r, *a, GMP_RNDN);
+	f_function_apply(mpfr_sech, *r, *a);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Hyperbolic cosecant
@@ -1479,19 +1447,17 @@ f_hsecant( VALUE klass, VALUE angle ) {
 VALUE
 f_hcosecant( VALUE klass, VALUE angle ) {
 	// Creates pointers to the result's and angle's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *a;
 	
 	// Loads the angle from Ruby
-	Data_Get_Struct(angle, mpfr_t, a);
-	
-	// Inits the result
-	mpfr_init(*r);
+	TypedData_Get_Struct(angle, mpfr_t, &float_type, a);
 	
 	// Does the calculation
-	mpfr_csch(*r, *a, GMP_RNDN);
+	f_function_apply(mpfr_csch, *r, *a);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 //// end of hyperbolic trigonometric functions
 ////////////////////////////////////////////////////////////////////
@@ -1503,19 +1469,17 @@ f_hcosecant( VALUE klass, VALUE angle ) {
 VALUE
 f_logn( VALUE klass, VALUE logarithmand ) {
 	// Creates pointers to the result's and logarithmand's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *l;
 	
 	// Loads the logarithmand from Ruby
-	Data_Get_Struct(logarithmand, mpfr_t, l);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(logarithmand, mpfr_t, &float_type, l);
 	
 	// Does the calculation
-	mpfr_log(*r, *l, GMP_RNDN);
+	f_function_apply(mpfr_log, *r, *l);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Base 2 logarithm
@@ -1523,19 +1487,17 @@ f_logn( VALUE klass, VALUE logarithmand ) {
 VALUE
 f_log2( VALUE klass, VALUE logarithmand ) {
 	// Creates pointers to the result's and logarithmand's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *l;
 	
 	// Loads the logarithmand from Ruby
-	Data_Get_Struct(logarithmand, mpfr_t, l);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(logarithmand, mpfr_t, &float_type, l);
 	
 	// Does the calculation
-	mpfr_log2(*r, *l, GMP_RNDN);
+	f_function_apply(mpfr_log2, *r, *l);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Base 10 logarithm
@@ -1543,19 +1505,17 @@ f_log2( VALUE klass, VALUE logarithmand ) {
 VALUE
 f_log10( VALUE klass, VALUE logarithmand ) {
 	// Creates pointers to the result's and logarithmand's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *l;
 	
 	// Loads the logarithmand from Ruby
-	Data_Get_Struct(logarithmand, mpfr_t, l);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(logarithmand, mpfr_t, &float_type, l);
 	
 	// Does the calculation
-	mpfr_log10(*r, *l, GMP_RNDN);
+	f_function_apply(mpfr_log10, *r, *l);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 //// end of logarithm methods
 ////////////////////////////////////////////////////////////////////
@@ -1567,19 +1527,17 @@ f_log10( VALUE klass, VALUE logarithmand ) {
 VALUE
 f_exp( VALUE klass, VALUE exponent ) {
 	// Creates pointers to the result's and exponent's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *e;
 	
 	// Loads the exponent from Ruby
-	Data_Get_Struct(exponent, mpfr_t, e);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(exponent, mpfr_t, &float_type, e);
 	
 	// Does the calculation
-	mpfr_exp(*r, *e, GMP_RNDN);
+	f_function_apply(mpfr_exp, *r, *e);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Base 2 exponentiation
@@ -1587,19 +1545,17 @@ f_exp( VALUE klass, VALUE exponent ) {
 VALUE
 f_exp2( VALUE klass, VALUE exponent ) {
 	// Creates pointers to the result's and exponent's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *e;
 	
 	// Loads the exponent from Ruby
-	Data_Get_Struct(exponent, mpfr_t, e);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(exponent, mpfr_t, &float_type, e);
 	
 	// Does the calculation
-	mpfr_exp2(*r, *e, GMP_RNDN);
+	f_function_apply(mpfr_exp2, *r, *e);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Base 10 exponentiation
@@ -1607,19 +1563,17 @@ f_exp2( VALUE klass, VALUE exponent ) {
 VALUE
 f_exp10( VALUE klass, VALUE exponent ) {
 	// Creates pointers to the result's and exponent's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *e;
 	
 	// Loads the exponent from Ruby
-	Data_Get_Struct(exponent, mpfr_t, e);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(exponent, mpfr_t, &float_type, e);
 	
 	// Does the calculation
-	mpfr_exp10(*r, *e, GMP_RNDN);
+	f_function_apply(mpfr_exp10, *r, *e);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 //// end of logarithm methods
 ////////////////////////////////////////////////////////////////////
@@ -1631,19 +1585,17 @@ f_exp10( VALUE klass, VALUE exponent ) {
 VALUE
 f_bessel_first_0( VALUE klass, VALUE number ) {
 	// Creates pointer to the result's and number's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *n;
 	
 	// Loads the number from Ruby
-	Data_Get_Struct(number, mpfr_t, n);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(number, mpfr_t, &float_type, n);
 	
 	// Does the calculation
-	mpfr_j0(*r, *n, GMP_RNDN);
+	f_function_apply(mpfr_j0, *r, *n);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Of the first kind and order 1
@@ -1651,19 +1603,17 @@ f_bessel_first_0( VALUE klass, VALUE number ) {
 VALUE
 f_bessel_first_1( VALUE klass, VALUE number ) {
 	// Creates pointer to the result's and number's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *n;
 	
 	// Loads the number from Ruby
-	Data_Get_Struct(number, mpfr_t, n);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(number, mpfr_t, &float_type, n);
 	
 	// Does the calculation
-	mpfr_j1(*r, *n, GMP_RNDN);
+	f_function_apply(mpfr_j1, *r, *n);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Of the first kind and order n
@@ -1671,21 +1621,19 @@ f_bessel_first_1( VALUE klass, VALUE number ) {
 VALUE
 f_bessel_first_n( VALUE klass, VALUE number, VALUE order ) {
 	// Creates pointer to the result's and number's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	long o;
 	mpfr_t *n;
 	
 	// Loads both the number and the order from Ruby
-	Data_Get_Struct(number, mpfr_t, n);
+	TypedData_Get_Struct(number, mpfr_t, &float_type, n);
 	o = FIX2LONG(order);
 	
-	// Inits the result;
-	mpfr_init(*r);
-	
 	// Does the calculation
 	mpfr_jn(*r, o, *n, GMP_RNDN);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Of the second kind and order 0
@@ -1693,19 +1641,17 @@ f_bessel_first_n( VALUE klass, VALUE number, VALUE order ) {
 VALUE
 f_bessel_second_0( VALUE klass, VALUE number ) {
 	// Creates pointer to the result's and number's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *n;
 	
 	// Loads the number from Ruby
-	Data_Get_Struct(number, mpfr_t, n);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(number, mpfr_t, &float_type, n);
 	
 	// Does the calculation
-	mpfr_y0(*r, *n, GMP_RNDN);
+	f_function_apply(mpfr_y0, *r, *n);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Of the second kind and order 1
@@ -1713,19 +1659,17 @@ f_bessel_second_0( VALUE klass, VALUE number ) {
 VALUE
 f_bessel_second_1( VALUE klass, VALUE number ) {
 	// Creates pointer to the result's and number's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *n;
 	
 	// Loads the number from Ruby
-	Data_Get_Struct(number, mpfr_t, n);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(number, mpfr_t, &float_type, n);
 	
 	// Does the calculation
-	mpfr_y1(*r, *n, GMP_RNDN);
+	f_function_apply(mpfr_y1, *r, *n);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Of the second kind and order n
@@ -1733,21 +1677,19 @@ f_bessel_second_1( VALUE klass, VALUE number ) {
 VALUE
 f_bessel_second_n( VALUE klass, VALUE number, VALUE order ) {
 	// Creates pointer to the result's and number's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	long o;
 	mpfr_t *n;
 	
 	// Loads both the number and the order from Ruby
-	Data_Get_Struct(number, mpfr_t, n);
+	TypedData_Get_Struct(number, mpfr_t, &float_type, n);
 	o = FIX2LONG(order);
 	
-	// Inits the result;
-	mpfr_init(*r);
-	
 	// Does the calculation
 	mpfr_yn(*r, o, *n, GMP_RNDN);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 //// end of bessel functions
 ////////////////////////////////////////////////////////////////////
@@ -1759,18 +1701,16 @@ f_bessel_second_n( VALUE klass, VALUE number, VALUE order ) {
 VALUE
 f_round( VALUE self ) {
 	// Creates pointers to self's and result's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *s;
 	
 	// Loads self
-	Data_Get_Struct(self, mpfr_t, s);
-	
-	// Inits the result
-	mpfr_init(*r);
+	TypedData_Get_Struct(self, mpfr_t, &float_type, s);
 	
 	mpfr_round(*r, *s);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 //// end of rounding methods
 ////////////////////////////////////////////////////////////////////
@@ -1782,16 +1722,14 @@ f_round( VALUE self ) {
 VALUE
 f_factorial( VALUE klass, VALUE base ) {
 	// Creates pointer to the result's mpfr_t structure
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	unsigned long b = FIX2LONG(base);
 	
-	// Inits the result;
-	mpfr_init(*r);
-	
 	// Does the calculation
 	mpfr_fac_ui(*r, b, GMP_RNDN);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Exponential integral of the input
@@ -1799,19 +1737,17 @@ f_factorial( VALUE klass, VALUE base ) {
 VALUE
 f_exp_integral( VALUE klass, VALUE number ) {
 	// Creates pointer to the result's and number's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *n;
 	
 	// Loads the number from Ruby
-	Data_Get_Struct(number, mpfr_t, n);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(number, mpfr_t, &float_type, n);
 	
 	// Does the calculation
-	mpfr_eint(*r, *n, GMP_RNDN);
+	f_function_apply(mpfr_eint, *r, *n);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Dilogarithm
@@ -1819,19 +1755,17 @@ f_exp_integral( VALUE klass, VALUE number ) {
 VALUE
 f_dilogarithm( VALUE klass, VALUE number ) {
 	// Creates pointer to the result's and number's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *n;
 	
 	// Loads the number from Ruby
-	Data_Get_Struct(number, mpfr_t, n);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(number, mpfr_t, &float_type, n);
 	
 	// Does the calculation
-	mpfr_li2(*r, *n, GMP_RNDN);
+	f_function_apply(mpfr_li2, *r, *n);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Euler gamma function
@@ -1839,19 +1773,17 @@ f_dilogarithm( VALUE klass, VALUE number ) {
 VALUE
 f_gamma( VALUE klass, VALUE number ) {
 	// Creates pointer to the result's and number's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *n;
 	
 	// Loads the number from Ruby
-	Data_Get_Struct(number, mpfr_t, n);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(number, mpfr_t, &float_type, n);
 	
 	// Does the calculation
-	mpfr_gamma(*r, *n, GMP_RNDN);
+	f_function_apply(mpfr_gamma, *r, *n);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Natural logarithm of the absolute value of Euler's gamma function
@@ -1859,19 +1791,17 @@ f_gamma( VALUE klass, VALUE number ) {
 VALUE
 f_lngamma( VALUE klass, VALUE number ) {
 	// Creates pointer to the result's and number's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *n;
 	
 	// Loads the number from Ruby
-	Data_Get_Struct(number, mpfr_t, n);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(number, mpfr_t, &float_type, n);
 	
 	// Does the calculation
-	mpfr_lngamma(*r, *n, GMP_RNDN);
+	f_function_apply(mpfr_lngamma, *r, *n);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Natural logarithm of the absolute value of Euler's gamma function, plus the
@@ -1882,19 +1812,16 @@ f_lgamma( VALUE klass, VALUE number ) {
 	// Creates pointer to the result's and number's mpfr_t structures, as well
 	// as a placeholder for the sign.
 	int intSign;
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE calcResult = float_create(&r);
 	mpfr_t *n;
 	
 	// Loads the number from Ruby
-	Data_Get_Struct(number, mpfr_t, n);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(number, mpfr_t, &float_type, n);
 	
 	// Does the calculation
 	mpfr_lgamma(*r, &intSign, *n, GMP_RNDN);
 	
-	VALUE calcResult = Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
 	VALUE sign = INT2FIX(intSign);
 	
 	return rb_ary_new3(2, calcResult, sign);
@@ -1905,19 +1832,17 @@ f_lgamma( VALUE klass, VALUE number ) {
 VALUE
 f_zeta( VALUE klass, VALUE number ) {
 	// Creates pointer to the result's and number's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *n;
 	
 	// Loads the number from Ruby
-	Data_Get_Struct(number, mpfr_t, n);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(number, mpfr_t, &float_type, n);
 	
 	// Does the calculation
-	mpfr_zeta(*r, *n, GMP_RNDN);
+	f_function_apply(mpfr_zeta, *r, *n);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Error function
@@ -1925,38 +1850,34 @@ f_zeta( VALUE klass, VALUE number ) {
 VALUE
 f_error_function( VALUE klass, VALUE number ) {
 	// Creates pointer to the result's and number's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *n;
 	
 	// Loads the number from Ruby
-	Data_Get_Struct(number, mpfr_t, n);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(number, mpfr_t, &float_type, n);
 	
 	// Does the calculation
-	mpfr_erf(*r, *n, GMP_RNDN);
+	f_function_apply(mpfr_erf, *r, *n);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 // Complimentary error function
 // {GMP::Float} -> {GMP::Float}
 VALUE
 f_error_function_comp( VALUE klass, VALUE number ) {
 	// Creates pointer to the result's and number's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *n;
 	
 	// Loads the number from Ruby
-	Data_Get_Struct(number, mpfr_t, n);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(number, mpfr_t, &float_type, n);
 	
 	// Does the calculation
-	mpfr_erfc(*r, *n, GMP_RNDN);
+	f_function_apply(mpfr_erfc, *r, *n);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Inverse square root (1/sqrt(x))
@@ -1964,23 +1885,21 @@ f_error_function_comp( VALUE klass, VALUE number ) {
 VALUE
 f_rec_sqrt( VALUE klass, VALUE radicand ) {
 	// Creates pointer to the result's and number's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *n;
 	
 	// Loads the number from Ruby
-	Data_Get_Struct(radicand, mpfr_t, n);
+	TypedData_Get_Struct(radicand, mpfr_t, &float_type, n);
 	
 	// Checks that the radicand is positive
 	if (mpfr_sgn(*n) <= 0)
 		rb_raise(rb_eTypeError, "radicand must be positive");
 	
-	// Inits the result;
-	mpfr_init(*r);
-	
 	// Does the calculation
-	mpfr_rec_sqrt(*r, *n, GMP_RNDN);
+	f_function_apply(mpfr_rec_sqrt, *r, *n);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Cube root
@@ -1988,19 +1907,17 @@ f_rec_sqrt( VALUE klass, VALUE radicand ) {
 VALUE
 f_cube_root( VALUE klass, VALUE radicand ) {
 	// Creates pointer to the result's and number's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *n;
 	
 	// Loads the number from Ruby
-	Data_Get_Struct(radicand, mpfr_t, n);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(radicand, mpfr_t, &float_type, n);
 	
 	// Does the calculation
-	mpfr_cbrt(*r, *n, GMP_RNDN);
+	f_function_apply(mpfr_cbrt, *r, *n);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Nth root
@@ -2008,11 +1925,12 @@ f_cube_root( VALUE klass, VALUE radicand ) {
 VALUE
 f_nth_root( VALUE klass, VALUE radicand, VALUE degree ) {
 	// Creates pointer to the result's and number's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *n;
 	
 	// Loads the number from Ruby
-	Data_Get_Struct(radicand, mpfr_t, n);
+	TypedData_Get_Struct(radicand, mpfr_t, &float_type, n);
 	
 	// Loads the degree from Ruby
 	int intDegree = FIX2INT(degree);
@@ -2021,13 +1939,10 @@ f_nth_root( VALUE klass, VALUE radicand, VALUE degree ) {
 	if (degree & 1 == 0 && mpfr_sgn(*n) < 0)
 		rb_raise(rb_eTypeError, "radicand must be positive if degree is even");
 	
-	// Inits the result;
-	mpfr_init(*r);
-	
 	// Does the calculation
 	mpfr_root(*r, *n, intDegree, GMP_RNDN);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Arithmetic-geometric mean
@@ -2035,20 +1950,18 @@ f_nth_root( VALUE klass, VALUE radicand, VALUE degree ) {
 VALUE
 f_ag_mean( VALUE klass, VALUE a, VALUE b ) {
 	// Creates a pointer to the result
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	
 	// Loads the numbers from Ruby
 	mpfr_t *ma, *mb;
-	Data_Get_Struct(a, mpfr_t, ma);
-	Data_Get_Struct(b, mpfr_t, mb);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(a, mpfr_t, &float_type, ma);
+	TypedData_Get_Struct(b, mpfr_t, &float_type, mb);
 	
 	// Does the calculation
 	mpfr_agm(*r, *ma, *mb, GMP_RNDN);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Euclidean norm (also the hypotenuse of the corresponding right triangle)
@@ -2056,20 +1969,18 @@ f_ag_mean( VALUE klass, VALUE a, VALUE b ) {
 VALUE
 f_euclidean_norm( VALUE klass, VALUE a, VALUE b ) {
 	// Creates a pointer to the result
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	
 	// Loads the numbers from Ruby
 	mpfr_t *ma, *mb;
-	Data_Get_Struct(a, mpfr_t, ma);
-	Data_Get_Struct(b, mpfr_t, mb);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(a, mpfr_t, &float_type, ma);
+	TypedData_Get_Struct(b, mpfr_t, &float_type, mb);
 	
 	// Does the calculation
 	mpfr_hypot(*r, *ma, *mb, GMP_RNDN);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // fma: (a * b) + c
@@ -2077,21 +1988,19 @@ f_euclidean_norm( VALUE klass, VALUE a, VALUE b ) {
 VALUE
 f_fma( VALUE klass, VALUE a, VALUE b, VALUE c ) {
 	// Creates a pointer to the result
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	
 	// Loads the numbers from Ruby
 	mpfr_t *ma, *mb, *mc;
-	Data_Get_Struct(a, mpfr_t, ma);
-	Data_Get_Struct(b, mpfr_t, mb);
-	Data_Get_Struct(c, mpfr_t, mc);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(a, mpfr_t, &float_type, ma);
+	TypedData_Get_Struct(b, mpfr_t, &float_type, mb);
+	TypedData_Get_Struct(c, mpfr_t, &float_type, mc);
 	
 	// Does the calculation
 	mpfr_fma(*r, *ma, *mb, *mc, GMP_RNDN);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // fms: (a * b) - c
@@ -2099,21 +2008,19 @@ f_fma( VALUE klass, VALUE a, VALUE b, VALUE c ) {
 VALUE
 f_fms( VALUE klass, VALUE a, VALUE b, VALUE c ) {
 	// Creates a pointer to the result
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	
 	// Loads the numbers from Ruby
 	mpfr_t *ma, *mb, *mc;
-	Data_Get_Struct(a, mpfr_t, ma);
-	Data_Get_Struct(b, mpfr_t, mb);
-	Data_Get_Struct(c, mpfr_t, mc);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(a, mpfr_t, &float_type, ma);
+	TypedData_Get_Struct(b, mpfr_t, &float_type, mb);
+	TypedData_Get_Struct(c, mpfr_t, &float_type, mc);
 	
 	// Does the calculation
 	mpfr_fms(*r, *ma, *mb, *mc, GMP_RNDN);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Logarithm plus 1 (result = ln(logarithmand) + 1)
@@ -2121,19 +2028,17 @@ f_fms( VALUE klass, VALUE a, VALUE b, VALUE c ) {
 VALUE
 f_log1p( VALUE klass, VALUE logarithmand ) {
 	// Creates pointers to the result's and logarithmand's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *l;
 	
 	// Loads the logarithmand from Ruby
-	Data_Get_Struct(logarithmand, mpfr_t, l);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(logarithmand, mpfr_t, &float_type, l);
 	
 	// Does the calculation
-	mpfr_log1p(*r, *l, GMP_RNDN);
+	f_function_apply(mpfr_log1p, *r, *l);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // E to the power (exponent - 1)
@@ -2141,19 +2046,17 @@ f_log1p( VALUE klass, VALUE logarithmand ) {
 VALUE
 f_expm1( VALUE klass, VALUE exponent ) {
 	// Creates pointers to the result's and exponent's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *e;
 	
 	// Loads the exponent from Ruby
-	Data_Get_Struct(exponent, mpfr_t, e);
-	
-	// Inits the result;
-	mpfr_init(*r);
+	TypedData_Get_Struct(exponent, mpfr_t, &float_type, e);
 	
 	// Does the calculation
-	mpfr_expm1(*r, *e, GMP_RNDN);
+	f_function_apply(mpfr_expm1, *r, *e);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Maximum value of two given numbers
@@ -2161,19 +2064,17 @@ f_expm1( VALUE klass, VALUE exponent ) {
 VALUE
 f_maximum_of_two( VALUE klass, VALUE a, VALUE b ) {
 	// Creates pointers to a's, b's and result's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *ma, *mb;
 	
 	// Loads a and b from Ruby
-	Data_Get_Struct(a, mpfr_t, ma);
-	Data_Get_Struct(b, mpfr_t, mb);
-	
-	// Inits the result
-	mpfr_init(*r);
+	TypedData_Get_Struct(a, mpfr_t, &float_type, ma);
+	TypedData_Get_Struct(b, mpfr_t, &float_type, mb);
 	
 	mpfr_max(*r, *ma, *mb, GMP_RNDN);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Mininum value of two given numbers
@@ -2181,19 +2082,17 @@ f_maximum_of_two( VALUE klass, VALUE a, VALUE b ) {
 VALUE
 f_minimum_of_two( VALUE klass, VALUE a, VALUE b ) {
 	// Creates pointers to a's, b's and result's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *ma, *mb;
 	
 	// Loads a and b from Ruby
-	Data_Get_Struct(a, mpfr_t, ma);
-	Data_Get_Struct(b, mpfr_t, mb);
-	
-	// Inits the result
-	mpfr_init(*r);
+	TypedData_Get_Struct(a, mpfr_t, &float_type, ma);
+	TypedData_Get_Struct(b, mpfr_t, &float_type, mb);
 	
 	mpfr_min(*r, *ma, *mb, GMP_RNDN);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 
 // Fractional part of a number
@@ -2201,22 +2100,123 @@ f_minimum_of_two( VALUE klass, VALUE a, VALUE b ) {
 VALUE
 f_fractional( VALUE self ) {
 	// Creates pointers to the self's and result's mpfr_t structures
-	mpfr_t *r = malloc(sizeof(*r));
+	mpfr_t *r;
+	VALUE result = float_create(&r);
 	mpfr_t *s;
 	
 	// Loads self
-	Data_Get_Struct(self, mpfr_t, s);
-	
-	// Inits the result
-	mpfr_init(*r);
+	TypedData_Get_Struct(self, mpfr_t, &float_type, s);
 	
 	
 	mpfr_frac(*r, *s, GMP_RNDN);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, r);
+	return result;
 }
 //// end of other methods
 ////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////
+//// Inplace functions (the caller inherits the result)
+// self = (a * b) +/- self through mpfr_fma or mpfr_fms, rounded once; the
+// factors are loaded like add!'s operand
+static VALUE
+f_fused_inplace( VALUE self, VALUE a, VALUE b, int (*fused)(mpfr_ptr, mpfr_srcptr, mpfr_srcptr, mpfr_srcptr, mpfr_rnd_t) ) {
+	mpfr_t *s;
+	TypedData_Get_Struct(self, mpfr_t, &float_type, s);
+	
+	VALUE holderA = Qnil, holderB = Qnil;
+	mpfr_srcptr ma = f_operand(a, mpfr_get_prec(*s), &holderA);
+	mpfr_srcptr mb = f_operand(b, mpfr_get_prec(*s), &holderB);
+	fused(*s, ma, mb, *s, GMP_RNDN);
+	
+	RB_GC_GUARD(holderA);
+	RB_GC_GUARD(holderB);
+	return Qnil;
+}
+
+// Fused multiply-add (in-place): self = (a * b) + self, rounded once
+// {GMP::Float, Float, Fixnum, Bignum, GMP::Integer, GMP::Rational}, {GMP::Float, Float, Fixnum, Bignum, GMP::Integer, GMP::Rational} -> {NilClass}
+VALUE
+f_fma_inplace( VALUE self, VALUE a, VALUE b ) {
+	return f_fused_inplace(self, a, b, mpfr_fma);
+}
+
+// Fused multiply-subtract (in-place): self = (a * b) - self, rounded once
+// {GMP::Float, Float, Fixnum, Bignum, GMP::Integer, GMP::Rational}, {GMP::Float, Float, Fixnum, Bignum, GMP::Integer, GMP::Rational} -> {NilClass}
+VALUE
+f_fms_inplace( VALUE self, VALUE a, VALUE b ) {
+	return f_fused_inplace(self, a, b, mpfr_fms);
+}
+
+// self = function(self), or self = function(argument) when one is given
+// (loaded like add!'s operand), rounded to self's precision
+static VALUE
+f_function_inplace( int argc, VALUE *argv, VALUE self, f_function function ) {
+	mpfr_t *s;
+	mpfr_srcptr a;
+	VALUE argument, holder = Qnil;
+	rb_scan_args(argc, argv, "01", &argument);
+	
+	TypedData_Get_Struct(self, mpfr_t, &float_type, s);
+	a = *s;
+	if (!NIL_P(argument))
+		a = f_operand(argument, mpfr_get_prec(*s), &holder);
+	
+	f_function_apply(function, *s, a);
+	
+	RB_GC_GUARD(holder);
+	return Qnil;
+}
+
+// Declares f_<name>_inplace, the in-place counterpart of the f_<name>
+// singleton, through f_function_inplace
+#define F_MPFR_INPLACE(name, function) \
+VALUE \
+f_##name##_inplace( int argc, VALUE *argv, VALUE self ) { \
+	return f_function_inplace(argc, argv, self, function); \
+}
+
+F_MPFR_INPLACE(sine, mpfr_sin)
+F_MPFR_INPLACE(cossine, mpfr_cos)
+F_MPFR_INPLACE(tangent, mpfr_tan)
+F_MPFR_INPLACE(cotangent, mpfr_cot)
+F_MPFR_INPLACE(secant, mpfr_sec)
+F_MPFR_INPLACE(cosecant, mpfr_csc)
+F_MPFR_INPLACE(hsine, mpfr_sinh)
+F_MPFR_INPLACE(hcossine, mpfr_cosh)
+F_MPFR_INPLACE(htangent, mpfr_tanh)
+F_MPFR_INPLACE(hcotangent, mpfr_coth)
+F_MPFR_INPLACE(hsecant, mpfr_sech)
+F_MPFR_INPLACE(hcosecant, mpfr_csch)
+F_MPFR_INPLACE(asine, mpfr_asin)
+F_MPFR_INPLACE(acossine, mpfr_acos)
+F_MPFR_INPLACE(atangent, mpfr_atan)
+F_MPFR_INPLACE(ahsine, mpfr_asinh)
+F_MPFR_INPLACE(ahcossine, mpfr_acosh)
+F_MPFR_INPLACE(ahtangent, mpfr_atanh)
+F_MPFR_INPLACE(logn, mpfr_log)
+F_MPFR_INPLACE(log2, mpfr_log2)
+F_MPFR_INPLACE(log10, mpfr_log10)
+F_MPFR_INPLACE(log1p, mpfr_log1p)
+F_MPFR_INPLACE(exp, mpfr_exp)
+F_MPFR_INPLACE(exp2, mpfr_exp2)
+F_MPFR_INPLACE(exp10, mpfr_exp10)
+F_MPFR_INPLACE(expm1, mpfr_expm1)
+F_MPFR_INPLACE(bessel_first_0, mpfr_j0)
+F_MPFR_INPLACE(bessel_first_1, mpfr_j1)
+F_MPFR_INPLACE(bessel_second_0, mpfr_y0)
+F_MPFR_INPLACE(bessel_second_1, mpfr_y1)
+F_MPFR_INPLACE(exp_integral, mpfr_eint)
+F_MPFR_INPLACE(dilogarithm, mpfr_li2)
+F_MPFR_INPLACE(gamma, mpfr_gamma)
+F_MPFR_INPLACE(lngamma, mpfr_lngamma)
+F_MPFR_INPLACE(zeta, mpfr_zeta)
+F_MPFR_INPLACE(error_function, mpfr_erf)
+F_MPFR_INPLACE(error_function_comp, mpfr_erfc)
+F_MPFR_INPLACE(rec_sqrt, mpfr_rec_sqrt)
+F_MPFR_INPLACE(cube_root, mpfr_cbrt)
+//// end of inplace functions
+////////////////////////////////////////////////////////////////////
 #endif // MPFR
 
 
@@ -2269,6 +2269,15 @@ Init_gmpf() {
 	rb_define_method(cGMPFloat, "relative_diff", f_relative_difference, 1);
 	rb_define_method(cGMPFloat, "coerce", f_coerce, 1);
 	
+	// In-place methods
+	rb_define_method(cGMPFloat, "add!", f_addition_inplace, 1);
+	rb_define_method(cGMPFloat, "sub!", f_subtraction_inplace, 1);
+	rb_define_method(cGMPFloat, "mul!", f_multiplication_inplace, 1);
+	rb_define_method(cGMPFloat, "div!", f_division_inplace, 1);
+	rb_define_method(cGMPFloat, "neg!", f_negation_inplace, 0);
+	rb_define_method(cGMPFloat, "abs!", f_absolute_inplace, 0);
+	rb_define_method(cGMPFloat, "sqrt!", f_sqrt_inplace, -1);
+	
 	// Singletons/Class methods
 	rb_define_singleton_method(cGMPFloat, "def_precision=", f_set_def_prec, 1);
 	rb_define_singleton_method(cGMPFloat, "def_precision", f_get_def_prec, 0);
@@ -2345,13 +2354,56 @@ Init_gmpf() {
 	rb_define_singleton_method(cGMPFloat, "root", f_nth_root, 2);
 	rb_define_singleton_method(cGMPFloat, "agm", f_ag_mean, 2);
 	rb_define_singleton_method(cGMPFloat, "hypot", f_euclidean_norm, 2);
-	rb_define_singleton_method(cGMPFloat, "fma", f_fma, 2);
-	rb_define_singleton_method(cGMPFloat, "fms", f_fms, 2);
+	rb_define_singleton_method(cGMPFloat, "fma", f_fma, 3);
+	rb_define_singleton_method(cGMPFloat, "fms", f_fms, 3);
 	rb_define_singleton_method(cGMPFloat, "log1p", f_log1p, 1);
 	rb_define_singleton_method(cGMPFloat, "expm1", f_expm1, 1);
 	rb_define_singleton_method(cGMPFloat, "max", f_maximum_of_two, 2);
 	rb_define_singleton_method(cGMPFloat, "min", f_minimum_of_two, 2);
 	rb_define_method(cGMPFloat, "frac", f_fractional, 0);
+	
+	// In-place functions
+	rb_define_method(cGMPFloat, "fma!", f_fma_inplace, 2);
+	rb_define_method(cGMPFloat, "fms!", f_fms_inplace, 2);
+	rb_define_method(cGMPFloat, "sin!", f_sine_inplace, -1);
+	rb_define_method(cGMPFloat, "cos!", f_cossine_inplace, -1);
+	rb_define_method(cGMPFloat, "tan!", f_tangent_inplace, -1);
+	rb_define_method(cGMPFloat, "cot!", f_cotangent_inplace, -1);
+	rb_define_method(cGMPFloat, "sec!", f_secant_inplace, -1);
+	rb_define_method(cGMPFloat, "csc!", f_cosecant_inplace, -1);
+	rb_define_method(cGMPFloat, "sinh!", f_hsine_inplace, -1);
+	rb_define_method(cGMPFloat, "cosh!", f_hcossine_inplace, -1);
+	rb_define_method(cGMPFloat, "tanh!", f_htangent_inplace, -1);
+	rb_define_method(cGMPFloat, "coth!", f_hcotangent_inplace, -1);
+	rb_define_method(cGMPFloat, "sech!", f_hsecant_inplace, -1);
+	rb_define_method(cGMPFloat, "csch!", f_hcosecant_inplace, -1);
+	rb_define_method(cGMPFloat, "asin!", f_asine_inplace, -1);
+	rb_define_method(cGMPFloat, "acos!", f_acossine_inplace, -1);
+	rb_define_method(cGMPFloat, "atan!", f_atangent_inplace, -1);
+	rb_define_method(cGMPFloat, "asinh!", f_ahsine_inplace, -1);
+	rb_define_method(cGMPFloat, "acosh!", f_ahcossine_inplace, -1);
+	rb_define_method(cGMPFloat, "atanh!", f_ahtangent_inplace, -1);
+	rb_define_method(cGMPFloat, "log!", f_logn_inplace, -1);
+	rb_define_method(cGMPFloat, "log2!", f_log2_inplace, -1);
+	rb_define_method(cGMPFloat, "log10!", f_log10_inplace, -1);
+	rb_define_method(cGMPFloat, "log1p!", f_log1p_inplace, -1);
+	rb_define_method(cGMPFloat, "exp!", f_exp_inplace, -1);
+	rb_define_method(cGMPFloat, "exp2!", f_exp2_inplace, -1);
+	rb_define_method(cGMPFloat, "exp10!", f_exp10_inplace, -1);
+	rb_define_method(cGMPFloat, "expm1!", f_expm1_inplace, -1);
+	rb_define_method(cGMPFloat, "j0!", f_bessel_first_0_inplace, -1);
+	rb_define_method(cGMPFloat, "j1!", f_bessel_first_1_inplace, -1);
+	rb_define_method(cGMPFloat, "y0!", f_bessel_second_0_inplace, -1);
+	rb_define_method(cGMPFloat, "y1!", f_bessel_second_1_inplace, -1);
+	rb_define_method(cGMPFloat, "eint!", f_exp_integral_inplace, -1);
+	rb_define_method(cGMPFloat, "li2!", f_dilogarithm_inplace, -1);
+	rb_define_method(cGMPFloat, "gamma!", f_gamma_inplace, -1);
+	rb_define_method(cGMPFloat, "lngamma!", f_lngamma_inplace, -1);
+	rb_define_method(cGMPFloat, "zeta!", f_zeta_inplace, -1);
+	rb_define_method(cGMPFloat, "erf!", f_error_function_inplace, -1);
+	rb_define_method(cGMPFloat, "erfc!", f_error_function_comp_inplace, -1);
+	rb_define_method(cGMPFloat, "rec_sqrt!", f_rec_sqrt_inplace, -1);
+	rb_define_method(cGMPFloat, "cbrt!", f_cube_root_inplace, -1);
 #endif // MPFR
 
 	// Aliases
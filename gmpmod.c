@@ -0,0 +1,969 @@
+/*
+    rGMP is yet another GMP wrapper for Ruby
+    Copyright (C) 2009  Ralf Gunter
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "gmp.h"
+#include "ruby.h"
+#include "rgmp.h"
+
+// A GMP::Modulus holds m and what is needed to reduce modulo m without a
+// full division, plus scratch space reused by every operation on its
+// residues, so that in-place operations on GMP::ModInt allocate nothing once
+// the scratch limbs have grown to size. The scratch is only touched with the
+// GVL held.
+typedef struct {
+	mpz_t m;
+	mpz_t mu;		// floor(B^2k / m), B = 2^GMP_NUMB_BITS (Barrett only)
+	mpz_t p;		// products awaiting reduction
+	mpz_t q;		// quotient estimates and inverses
+	mpz_t t;		// operands reduced on the fly
+	size_t k;		// limbs in m (0 while uninitialized)
+	int barrett;
+} rgmp_modulus;
+
+// A GMP::ModInt is a residue 0 <= v < m of the GMP::Modulus it points to
+typedef struct {
+	mpz_t v;
+	VALUE modulus;
+} rgmp_modint;
+
+// Barrett reduction only beats mpz_tdiv_r from about 16 limbs on; below that
+// the extra multiplications cost more than GMP's schoolbook division, and
+// well above it GMP's own division is subquadratic too
+#define MODULUS_BARRETT_LIMBS 16
+
+////////////////////////////////////////////////////////////////////
+//// Fundamental methods
+// Garbage collection
+static void
+modulus_free( void *p ) {
+	rgmp_modulus *M = p;
+	mpz_clear(M->m);
+	mpz_clear(M->mu);
+	mpz_clear(M->p);
+	mpz_clear(M->q);
+	mpz_clear(M->t);
+#ifndef TYPED_DATA_EMBEDDED
+	xfree(M);
+#endif
+}
+
+// Reports the limb memory held by the modulus and its scratch space
+static size_t
+modulus_memsize( const void *p ) {
+	const rgmp_modulus *M = p;
+	return ((size_t) M->m->_mp_alloc + (size_t) M->mu->_mp_alloc
+			+ (size_t) M->p->_mp_alloc + (size_t) M->q->_mp_alloc
+			+ (size_t) M->t->_mp_alloc) * sizeof(mp_limb_t);
+}
+
+static const rb_data_type_t modulus_type = {
+	"GMP::Modulus",
+	{ NULL, modulus_free, modulus_memsize, },
+	NULL, NULL, RGMP_TYPED_FLAGS
+};
+
+// Unlike the number classes, residues reference a Ruby object (their
+// modulus), which has to be marked, updated by GC.compact and written
+// through RB_OBJ_WRITE to keep the type write-barrier protected
+static void
+modint_mark( void *p ) {
+	rgmp_modint *r = p;
+	rb_gc_mark_movable(r->modulus);
+}
+
+static void
+modint_compact( void *p ) {
+	rgmp_modint *r = p;
+	r->modulus = rb_gc_location(r->modulus);
+}
+
+static void
+modint_free( void *p ) {
+	rgmp_modint *r = p;
+	mpz_clear(r->v);
+#ifndef TYPED_DATA_EMBEDDED
+	xfree(r);
+#endif
+}
+
+static size_t
+modint_memsize( const void *p ) {
+	const rgmp_modint *r = p;
+	return (size_t) r->v->_mp_alloc * sizeof(mp_limb_t);
+}
+
+static const rb_data_type_t modint_type = {
+	"GMP::ModInt",
+	{ modint_mark, modint_free, modint_memsize, modint_compact, },
+	NULL, NULL, RGMP_TYPED_FLAGS
+};
+
+// Object allocation
+VALUE
+modulus_allocate( VALUE klass ) {
+	rgmp_modulus *M;
+	VALUE obj = TypedData_Make_Struct(klass, rgmp_modulus, &modulus_type, M);
+	mpz_init(M->m);
+	mpz_init(M->mu);
+	mpz_init(M->p);
+	mpz_init(M->q);
+	mpz_init(M->t);
+	M->k = 0;
+	M->barrett = 0;
+	return obj;
+}
+
+VALUE
+modint_allocate( VALUE klass ) {
+	rgmp_modint *r;
+	VALUE obj = TypedData_Make_Struct(klass, rgmp_modint, &modint_type, r);
+	mpz_init(r->v);
+	r->modulus = Qnil;
+	RGMP_COUNT(STAT_OBJECTS, 1);
+	return obj;
+}
+
+// The modulus of an object, which must have been initialized (an all-zero
+// modulus would divide by zero)
+static rgmp_modulus *
+modulus_get( VALUE obj ) {
+	rgmp_modulus *M;
+	TypedData_Get_Struct(obj, rgmp_modulus, &modulus_type, M);
+	if (M->k == 0)
+		rb_raise(rb_eRuntimeError, "uninitialized modulus");
+	return M;
+}
+
+static rgmp_modint *
+modint_get( VALUE obj ) {
+	rgmp_modint *r;
+	TypedData_Get_Struct(obj, rgmp_modint, &modint_type, r);
+	return r;
+}
+
+// Creates a new GMP::ModInt over modulus, pointing *r at its struct. The
+// residue gets room for m up front, so that it never grows afterwards.
+static VALUE
+modint_create( VALUE modulus, rgmp_modint **r ) {
+	rgmp_modulus *M = modulus_get(modulus);
+	VALUE obj = TypedData_Make_Struct(cGMPModInt, rgmp_modint, &modint_type, *r);
+	mpz_init2((*r)->v, mpz_sizeinbase(M->m, 2) + 1);
+	RB_OBJ_WRITE(obj, &(*r)->modulus, modulus);
+	RGMP_COUNT(STAT_OBJECTS, 1);
+	return obj;
+}
+
+// Class constructors
+// {GMP::Integer, Fixnum, Bignum} -> {GMP::Modulus}
+VALUE
+mod_init( VALUE self, VALUE modulus ) {
+	rgmp_modulus *M;
+	TypedData_Get_Struct(self, rgmp_modulus, &modulus_type, M);
+	
+	integral2mpz(M->m, modulus);
+	if (mpz_sgn(M->m) <= 0)
+		rb_raise(rb_eRangeError, "modulus must be positive");
+	
+	M->k = mpz_size(M->m);
+	M->barrett = (M->k >= MODULUS_BARRETT_LIMBS);
+	
+	if (M->barrett) {
+		mpz_set_ui(M->mu, 0);
+		mpz_setbit(M->mu, 2 * M->k * GMP_NUMB_BITS);
+		mpz_tdiv_q(M->mu, M->mu, M->m);
+	} else {
+		mpz_set_ui(M->mu, 0);
+	}
+	
+	return Qnil;
+}
+//// end of fundamental methods
+////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////
+//// Reduction
+// r = x mod m, for 0 <= x < m^2 (e.g. the product of two residues), with q
+// as scratch space. With Barrett's method, the quotient estimate is at most 2
+// below the real one (HAC 14.42), hence the final subtractions. Only reads M,
+// so it may run on several threads at once, each with its own q.
+static void
+mod_reduce( const rgmp_modulus *M, mpz_ptr r, mpz_srcptr x, mpz_ptr q ) {
+	if (M->barrett) {
+		mpz_tdiv_q_2exp(q, x, (M->k - 1) * GMP_NUMB_BITS);
+		mpz_mul(q, q, M->mu);
+		mpz_tdiv_q_2exp(q, q, (M->k + 1) * GMP_NUMB_BITS);
+		mpz_mul(q, q, M->m);
+		mpz_sub(r, x, q);
+		while (mpz_cmp(r, M->m) >= 0)
+			mpz_sub(r, r, M->m);
+	} else {
+		mpz_tdiv_r(r, x, M->m);
+	}
+}
+
+// Loads other as a residue of modulus: another residue of the same modulus
+// (the same object or an equal m) is used as is, integral values are reduced
+// into the scratch space
+static mpz_srcptr
+mod_operand( rgmp_modulus *M, VALUE modulus, VALUE other ) {
+	if (rb_typeddata_is_kind_of(other, &modint_type)) {
+		rgmp_modint *o = modint_get(other);
+		if (o->modulus != modulus && mpz_cmp(modulus_get(o->modulus)->m, M->m) != 0)
+			rb_raise(rb_eArgError, "residues of different moduli");
+		return o->v;
+	}
+	
+	if (operand_kind(other) == OPERAND_INTEGER) {
+		mpz_mod(M->t, MPZ_OF(other), M->m);
+	} else {
+		integral2mpz(M->t, other);
+		mpz_mod(M->t, M->t, M->m);
+	}
+	return M->t;
+}
+
+// Residue operators; r may alias a or b, and b may be the scratch operand
+typedef void (*mod_operator)(rgmp_modulus *, mpz_ptr, mpz_srcptr, mpz_srcptr);
+
+static void
+mod_add( rgmp_modulus *M, mpz_ptr r, mpz_srcptr a, mpz_srcptr b ) {
+	mpz_add(r, a, b);
+	if (mpz_cmp(r, M->m) >= 0)
+		mpz_sub(r, r, M->m);
+}
+
+static void
+mod_sub( rgmp_modulus *M, mpz_ptr r, mpz_srcptr a, mpz_srcptr b ) {
+	mpz_sub(r, a, b);
+	if (mpz_sgn(r) < 0)
+		mpz_add(r, r, M->m);
+}
+
+static void
+mod_mul( rgmp_modulus *M, mpz_ptr r, mpz_srcptr a, mpz_srcptr b ) {
+	mpz_mul(M->p, a, b);
+	mod_reduce(M, r, M->p, M->q);
+}
+
+static void
+mod_div( rgmp_modulus *M, mpz_ptr r, mpz_srcptr a, mpz_srcptr b ) {
+	if (!mpz_invert(M->q, b, M->m))
+		rb_raise(rb_eZeroDivError, "residue is not invertible");
+	mod_mul(M, r, a, M->q);
+}
+
+// r = a^exp; negative exponents raise the inverse of a instead. The powering
+// itself is GMP's (Montgomery-based) mpz_powm, without the GVL when big
+// enough (see z_powm_mpz in gmpz.c).
+static void
+mod_pow( rgmp_modulus *M, mpz_ptr r, mpz_srcptr a, VALUE exp ) {
+	switch (operand_kind(exp)) {
+		case OPERAND_FIXNUM: {
+			long el = FIX2LONG(exp);
+			if (el >= 0) {
+				z_powm_ui(r, a, el, M->m);
+				return;
+			}
+			mpz_set_si(M->t, el);
+			break;
+		}
+		case OPERAND_INTEGER: {
+			if (mpz_sgn(MPZ_OF(exp)) >= 0) {
+				z_powm_mpz(r, a, MPZ_OF(exp), M->m);
+				return;
+			}
+			mpz_set(M->t, MPZ_OF(exp));
+			break;
+		}
+		case OPERAND_BIGNUM: {
+			num2mpz(M->t, exp);
+			if (mpz_sgn(M->t) >= 0) {
+				z_powm_mpz(r, a, M->t, M->m);
+				return;
+			}
+			break;
+		}
+		default: {
+			rb_raise(rb_eTypeError, "exponent's type not supported");
+		}
+	}
+	
+	if (!mpz_invert(M->q, a, M->m))
+		rb_raise(rb_eZeroDivError, "residue is not invertible");
+	mpz_neg(M->t, M->t);
+	z_powm_mpz(r, M->q, M->t, M->m);
+}
+
+// New residue holding self op other
+static VALUE
+mod_binary_operation( VALUE self, VALUE other, mod_operator op ) {
+	rgmp_modint *a = modint_get(self), *r;
+	rgmp_modulus *M = modulus_get(a->modulus);
+	VALUE result = modint_create(a->modulus, &r);
+	
+	op(M, r->v, a->v, mod_operand(M, a->modulus, other));
+	return result;
+}
+
+// self = self op other
+static VALUE
+mod_inplace( VALUE self, VALUE other, mod_operator op ) {
+	rgmp_modint *a = modint_get(self);
+	rgmp_modulus *M = modulus_get(a->modulus);
+	
+	op(M, a->v, a->v, mod_operand(M, a->modulus, other));
+	return Qnil;
+}
+//// end of reduction
+////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////
+//// GMP::Modulus methods
+// Residue of value
+// {GMP::Integer, Fixnum, Bignum} -> {GMP::ModInt}
+VALUE
+mod_residue( VALUE self, VALUE value ) {
+	rgmp_modulus *M = modulus_get(self);
+	rgmp_modint *r;
+	VALUE result = modint_create(self, &r);
+	
+	mpz_set(r->v, mod_operand(M, self, value));
+	return result;
+}
+
+// The modulus itself
+// {} -> {GMP::Integer}
+VALUE
+mod_modulus( VALUE self ) {
+	rgmp_modulus *M = modulus_get(self);
+	mpz_t *r;
+	VALUE result = integer_create(&r);
+	mpz_set(*r, M->m);
+	return result;
+}
+
+// To String
+// {} -> {String}
+VALUE
+mod_to_string( VALUE self ) {
+	rgmp_modulus *M = modulus_get(self);
+	char *str = mpz_get_str(NULL, 10, M->m);
+	RGMP_COUNT(STAT_STRING_CONVERSIONS, 1);
+	VALUE rStr = rb_str_new2(str);
+	free(str);
+	return rStr;
+}
+//// end of GMP::Modulus methods
+////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////
+//// GMP::ModInt methods
+// Class constructor
+// {GMP::Integer, Fixnum, Bignum}, {GMP::Modulus, GMP::Integer, Fixnum, Bignum} -> {GMP::ModInt}
+VALUE
+mi_init( VALUE self, VALUE value, VALUE modulus ) {
+	rgmp_modint *r;
+	TypedData_Get_Struct(self, rgmp_modint, &modint_type, r);
+	
+	if (!rb_typeddata_is_kind_of(modulus, &modulus_type))
+		modulus = rb_class_new_instance(1, &modulus, cGMPModulus);
+	
+	rgmp_modulus *M = modulus_get(modulus);
+	mpz_set(r->v, mod_operand(M, modulus, value));
+	RB_OBJ_WRITE(self, &r->modulus, modulus);
+	return Qnil;
+}
+
+// Conversion methods
+// {} -> {Fixnum, Bignum}
+VALUE
+mi_to_integer( VALUE self ) {
+	return mpz2num(modint_get(self)->v);
+}
+
+// {} -> {GMP::Integer}
+VALUE
+mi_to_gmpz( VALUE self ) {
+	mpz_t *r;
+	VALUE result = integer_create(&r);
+	mpz_set(*r, modint_get(self)->v);
+	return result;
+}
+
+// {} -> {String}
+VALUE
+mi_to_string( VALUE self ) {
+	char *str = mpz_get_str(NULL, 10, modint_get(self)->v);
+	RGMP_COUNT(STAT_STRING_CONVERSIONS, 1);
+	VALUE rStr = rb_str_new2(str);
+	free(str);
+	return rStr;
+}
+
+// "v (mod m)"
+// {} -> {String}
+VALUE
+mi_inspect( VALUE self ) {
+	rgmp_modint *r = modint_get(self);
+	return rb_sprintf("%"PRIsVALUE" (mod %"PRIsVALUE")", mi_to_string(self),
+			mod_to_string(r->modulus));
+}
+
+// {} -> {GMP::Modulus}
+VALUE
+mi_modulus( VALUE self ) {
+	return modint_get(self)->modulus;
+}
+
+// Binary arithmetical operators
+// {GMP::ModInt, GMP::Integer, Fixnum, Bignum} -> {GMP::ModInt}
+VALUE
+mi_addition( VALUE self, VALUE other ) {
+	return mod_binary_operation(self, other, mod_add);
+}
+
+VALUE
+mi_subtraction( VALUE self, VALUE other ) {
+	return mod_binary_operation(self, other, mod_sub);
+}
+
+VALUE
+mi_multiplication( VALUE self, VALUE other ) {
+	return mod_binary_operation(self, other, mod_mul);
+}
+
+VALUE
+mi_division( VALUE self, VALUE other ) {
+	return mod_binary_operation(self, other, mod_div);
+}
+
+// Exponentiation
+// {GMP::Integer, Fixnum, Bignum} -> {GMP::ModInt}
+VALUE
+mi_power( VALUE self, VALUE exp ) {
+	rgmp_modint *a = modint_get(self), *r;
+	rgmp_modulus *M = modulus_get(a->modulus);
+	VALUE result = modint_create(a->modulus, &r);
+	
+	mod_pow(M, r->v, a->v, exp);
+	return result;
+}
+
+// Unary operators
+// {} -> {GMP::ModInt}
+VALUE
+mi_negation( VALUE self ) {
+	rgmp_modint *a = modint_get(self), *r;
+	rgmp_modulus *M = modulus_get(a->modulus);
+	VALUE result = modint_create(a->modulus, &r);
+	
+	if (mpz_sgn(a->v) != 0)
+		mpz_sub(r->v, M->m, a->v);
+	return result;
+}
+
+// Multiplicative inverse
+// {} -> {GMP::ModInt}
+VALUE
+mi_inverse( VALUE self ) {
+	rgmp_modint *a = modint_get(self), *r;
+	rgmp_modulus *M = modulus_get(a->modulus);
+	VALUE result = modint_create(a->modulus, &r);
+	
+	if (!mpz_invert(r->v, a->v, M->m))
+		rb_raise(rb_eZeroDivError, "residue is not invertible");
+	return result;
+}
+
+// Comparisons
+// Residues of equal moduli compare their values, integral values compare
+// their residues (i.e. congruence)
+// {GMP::ModInt, GMP::Integer, Fixnum, Bignum} -> {TrueClass, FalseClass}
+VALUE
+mi_equality_test( VALUE self, VALUE other ) {
+	rgmp_modint *a = modint_get(self);
+	rgmp_modulus *M = modulus_get(a->modulus);
+	
+	if (rb_typeddata_is_kind_of(other, &modint_type)) {
+		rgmp_modint *o = modint_get(other);
+		if (o->modulus != a->modulus && mpz_cmp(modulus_get(o->modulus)->m, M->m) != 0)
+			return Qfalse;
+		return (mpz_cmp(a->v, o->v) == 0) ? Qtrue : Qfalse;
+	}
+	
+	switch (operand_kind(other)) {
+		case OPERAND_FIXNUM:
+		case OPERAND_BIGNUM:
+		case OPERAND_INTEGER:
+			return (mpz_cmp(a->v, mod_operand(M, a->modulus, other)) == 0) ? Qtrue : Qfalse;
+		default:
+			return Qfalse;
+	}
+}
+
+// {} -> {TrueClass, FalseClass}
+VALUE
+mi_zero( VALUE self ) {
+	return (mpz_sgn(modint_get(self)->v) == 0) ? Qtrue : Qfalse;
+}
+
+// Lets integral values on the left-hand side of the operators (3 * x)
+// {GMP::Integer, Fixnum, Bignum} -> {Array}
+VALUE
+mi_coerce( VALUE self, VALUE other ) {
+	rgmp_modint *a = modint_get(self);
+	return rb_assoc_new(mod_residue(a->modulus, other), self);
+}
+
+// In-place methods
+// {GMP::ModInt, GMP::Integer, Fixnum, Bignum} -> {NilClass}
+VALUE
+mi_addition_inplace( VALUE self, VALUE other ) {
+	return mod_inplace(self, other, mod_add);
+}
+
+VALUE
+mi_subtraction_inplace( VALUE self, VALUE other ) {
+	return mod_inplace(self, other, mod_sub);
+}
+
+VALUE
+mi_multiplication_inplace( VALUE self, VALUE other ) {
+	return mod_inplace(self, other, mod_mul);
+}
+
+VALUE
+mi_division_inplace( VALUE self, VALUE other ) {
+	return mod_inplace(self, other, mod_div);
+}
+
+// {GMP::Integer, Fixnum, Bignum} -> {NilClass}
+VALUE
+mi_power_inplace( VALUE self, VALUE exp ) {
+	rgmp_modint *a = modint_get(self);
+	mod_pow(modulus_get(a->modulus), a->v, a->v, exp);
+	return Qnil;
+}
+
+// {} -> {NilClass}
+VALUE
+mi_negation_inplace( VALUE self ) {
+	rgmp_modint *a = modint_get(self);
+	rgmp_modulus *M = modulus_get(a->modulus);
+	
+	if (mpz_sgn(a->v) != 0)
+		mpz_sub(a->v, M->m, a->v);
+	return Qnil;
+}
+
+VALUE
+mi_inverse_inplace( VALUE self ) {
+	rgmp_modint *a = modint_get(self);
+	rgmp_modulus *M = modulus_get(a->modulus);
+	
+	// Checked on the scratch space, so that self is left alone on failure
+	if (!mpz_invert(M->q, a->v, M->m))
+		rb_raise(rb_eZeroDivError, "residue is not invertible");
+	mpz_set(a->v, M->q);
+	return Qnil;
+}
+//// end of GMP::ModInt methods
+////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////
+//// GMP::PowmTable (fixed-base exponentiation)
+// Fixed-base windowing (HAC 14.109 with a full table): for digits of w bits,
+// table[i * (2^w - 1) + d - 1] = g^(d * 2^(w * i)) mod m, so that g^e is the
+// product of one entry per nonzero digit of e, with no squarings at all.
+typedef struct {
+	VALUE modulus;
+	mpz_t g;			// the base, reduced
+	mpz_t *table;
+	size_t digits;		// ceil(max_bits / w)
+	size_t max_bits;
+	unsigned w;			// 1, 2, 4 or 8, so that digits never straddle limbs
+} rgmp_powm_table;
+
+// Largest table the window size may grow to
+#define POWM_TABLE_BYTES (16 << 20)
+
+static void
+powm_table_mark( void *p ) {
+	rgmp_powm_table *T = p;
+	rb_gc_mark_movable(T->modulus);
+}
+
+static void
+powm_table_compact( void *p ) {
+	rgmp_powm_table *T = p;
+	T->modulus = rb_gc_location(T->modulus);
+}
+
+static void
+powm_table_clear( rgmp_powm_table *T ) {
+	size_t entries = T->digits * (((size_t) 1 << T->w) - 1);
+	for (size_t i = 0; i < entries; i++)
+		mpz_clear(T->table[i]);
+	xfree(T->table);
+	T->table = NULL;
+	T->digits = 0;
+}
+
+static void
+powm_table_free( void *p ) {
+	rgmp_powm_table *T = p;
+	powm_table_clear(T);
+	mpz_clear(T->g);
+#ifndef TYPED_DATA_EMBEDDED
+	xfree(T);
+#endif
+}
+
+static size_t
+powm_table_memsize( const void *p ) {
+	const rgmp_powm_table *T = p;
+	size_t entries = T->digits * (((size_t) 1 << T->w) - 1);
+	size_t size = entries * sizeof(mpz_t) + (size_t) T->g->_mp_alloc * sizeof(mp_limb_t);
+	for (size_t i = 0; i < entries; i++)
+		size += (size_t) T->table[i]->_mp_alloc * sizeof(mp_limb_t);
+	return size;
+}
+
+static const rb_data_type_t powm_table_type = {
+	"GMP::PowmTable",
+	{ powm_table_mark, powm_table_free, powm_table_memsize, powm_table_compact, },
+	NULL, NULL, RGMP_TYPED_FLAGS
+};
+
+VALUE
+powm_table_allocate( VALUE klass ) {
+	rgmp_powm_table *T;
+	VALUE obj = TypedData_Make_Struct(klass, rgmp_powm_table, &powm_table_type, T);
+	mpz_init(T->g);
+	T->modulus = Qnil;
+	T->table = NULL;
+	T->digits = T->max_bits = 0;
+	T->w = 1;
+	return obj;
+}
+
+static rgmp_powm_table *
+powm_table_get( VALUE obj ) {
+	rgmp_powm_table *T;
+	TypedData_Get_Struct(obj, rgmp_powm_table, &powm_table_type, T);
+	if (T->table == NULL)
+		rb_raise(rb_eRuntimeError, "uninitialized table");
+	return T;
+}
+
+// r = g^e mod m, with p and q as scratch space. Exponents beyond the table
+// fall back to mpz_powm; negative ones invert the result, which the caller
+// must have checked is possible. Only reads T and M (see mod_reduce).
+static void
+powm_table_eval( const rgmp_powm_table *T, const rgmp_modulus *M, mpz_ptr r, mpz_srcptr e, mpz_ptr p, mpz_ptr q ) {
+	mpz_t view;
+	mpz_srcptr x = mpz_roinit_n(view, mpz_limbs_read(e), mpz_size(e));
+	
+	if (mpz_sizeinbase(x, 2) > T->max_bits) {
+		mpz_powm(r, T->g, x, M->m);
+	} else {
+		size_t row = ((size_t) 1 << T->w) - 1;
+		int empty = 1;
+		
+		for (size_t i = 0; i < T->digits; i++) {
+			size_t bit = i * T->w;
+			size_t d = (mpz_getlimbn(x, bit / GMP_NUMB_BITS) >> (bit % GMP_NUMB_BITS)) & row;
+			if (d == 0)
+				continue;
+			
+			if (empty) {
+				mpz_set(r, T->table[i * row + d - 1]);
+				empty = 0;
+			} else {
+				mpz_mul(p, r, T->table[i * row + d - 1]);
+				mod_reduce(M, r, p, q);
+			}
+		}
+		if (empty)
+			mpz_set_ui(r, mpz_cmp_ui(M->m, 1) != 0);
+	}
+	
+	if (mpz_sgn(e) < 0)
+		mpz_invert(r, r, M->m);
+}
+
+// A batch of exponents and their private copies, freed by powm_batch_free
+// even when loading or evaluating them raises. self and modulus are kept on
+// this stack, which pins them (and the structs embedded in them) while the
+// GVL is released.
+typedef struct {
+	VALUE self, modulus, exponents;
+	rgmp_powm_table *T;
+	rgmp_modulus *M;
+	mpz_t *e, *r;
+	size_t count;
+	unsigned threads;
+	rgmp_checkpoint cp;
+} powm_batch;
+
+static void
+powm_batch_task( void *data, size_t i ) {
+	powm_batch *b = data;
+	mpz_t p, q;
+	
+	mpz_init(p);
+	mpz_init(q);
+	powm_table_eval(b->T, b->M, b->r[i], b->e[i], p, q);
+	mpz_clear(p);
+	mpz_clear(q);
+}
+
+static void *
+powm_batch_nogvl( void *p ) {
+	powm_batch *b = p;
+	rgmp_parallel_for(b->count, b->threads, powm_batch_task, b, &b->cp);
+	return NULL;
+}
+
+// Loads the exponents, evaluates them and returns their powers as an Array
+static VALUE
+powm_batch_run( VALUE p ) {
+	powm_batch *b = (powm_batch *) p;
+	long length = RARRAY_LEN(b->exponents);
+	int checked = 0;
+	
+	b->e = ALLOC_N(mpz_t, length);
+	b->r = ALLOC_N(mpz_t, length);
+	for (long i = 0; i < length; i++) {
+		mpz_init(b->e[i]);
+		mpz_init(b->r[i]);
+		b->count++;
+		integral2mpz(b->e[i], rb_ary_entry(b->exponents, i));
+		
+		// Negative exponents need the inverse of g, checked once
+		if (mpz_sgn(b->e[i]) < 0 && !checked) {
+			if (!mpz_invert(b->M->q, b->T->g, b->M->m))
+				rb_raise(rb_eRuntimeError, "input is not invertible on this base");
+			checked = 1;
+		}
+	}
+	RGMP_COUNT(STAT_TEMPORARIES, 2 * length);
+	
+	size_t work = work_product(b->count, work_product(b->T->digits, b->M->k));
+	if (b->threads == 0)
+		b->threads = (work >= parallel_threshold) ? rgmp_threads : 1;
+	
+	if (b->threads > 1 || RGMP_NOGVL(work)) {
+		int state = rgmp_without_gvl(powm_batch_nogvl, b, &b->cp);
+		if (state)
+			rb_jump_tag(state);
+	} else {
+		for (size_t i = 0; i < b->count; i++)
+			powm_table_eval(b->T, b->M, b->r[i], b->e[i], b->M->p, b->M->q);
+	}
+	
+	VALUE results = rb_ary_new_capa(length);
+	for (size_t i = 0; i < b->count; i++) {
+		mpz_t *z;
+		rb_ary_push(results, integer_create(&z));
+		mpz_swap(*z, b->r[i]);
+	}
+	return results;
+}
+
+static VALUE
+powm_batch_free( VALUE p ) {
+	powm_batch *b = (powm_batch *) p;
+	for (size_t i = 0; i < b->count; i++) {
+		mpz_clear(b->e[i]);
+		mpz_clear(b->r[i]);
+	}
+	xfree(b->e);
+	xfree(b->r);
+	return Qnil;
+}
+
+static VALUE
+powm_batch_call( VALUE self, VALUE exponents, unsigned threads ) {
+	rgmp_powm_table *T = powm_table_get(self);
+	powm_batch b = { self, T->modulus, exponents, T, modulus_get(T->modulus),
+			NULL, NULL, 0, threads };
+	VALUE results = rb_ensure(powm_batch_run, (VALUE) &b, powm_batch_free, (VALUE) &b);
+	RB_GC_GUARD(b.self);
+	RB_GC_GUARD(b.modulus);
+	return results;
+}
+
+// Class constructor
+// Precomputes the powers of g modulo p needed for exponents of up to
+// max_bits bits, with the widest window that fits in POWM_TABLE_BYTES.
+// Raises ArgumentError when even 1-bit windows do not fit, and refuses to
+// rebuild a table, which pow_many may be reading without the GVL.
+// {GMP::Integer, Fixnum, Bignum}, {GMP::Modulus, GMP::Integer, Fixnum, Bignum}, {Fixnum} -> {GMP::PowmTable}
+VALUE
+pt_init( VALUE self, VALUE g, VALUE modulus, VALUE max_bits ) {
+	rgmp_powm_table *T;
+	TypedData_Get_Struct(self, rgmp_powm_table, &powm_table_type, T);
+	if (T->table != NULL)
+		rb_raise(rb_eRuntimeError, "table already initialized");
+	
+	long bits = NUM2LONG(max_bits);
+	if (bits < 1)
+		rb_raise(rb_eRangeError, "max_bits must be positive");
+	
+	if (!rb_typeddata_is_kind_of(modulus, &modulus_type))
+		modulus = rb_class_new_instance(1, &modulus, cGMPModulus);
+	rgmp_modulus *M = modulus_get(modulus);
+	
+	unsigned w;
+	size_t entry = (M->k + 1) * sizeof(mp_limb_t) + sizeof(mpz_t);
+	for (w = 8; w >= 1; w /= 2) {
+		size_t digits = ((size_t) bits + w - 1) / w;
+		if (work_product(work_product(digits, ((size_t) 1 << w) - 1), entry) <= POWM_TABLE_BYTES)
+			break;
+	}
+	if (w == 0)
+		rb_raise(rb_eArgError, "a table for %ld-bit exponents would exceed %d MiB", bits, POWM_TABLE_BYTES >> 20);
+	
+	mpz_set(T->g, mod_operand(M, modulus, g));
+	RB_OBJ_WRITE(self, &T->modulus, modulus);
+	T->max_bits = (size_t) bits;
+	T->w = w;
+	
+	// Row i holds g_i^1 .. g_i^(2^w - 1), with g_i = g^(2^(w * i)), and
+	// g_(i+1) = g_i^(2^w - 1) * g_i
+	size_t digits = (T->max_bits + T->w - 1) / T->w;
+	size_t row = ((size_t) 1 << T->w) - 1;
+	T->table = ALLOC_N(mpz_t, digits * row);
+	for (size_t i = 0; i < digits; i++) {
+		mpz_t *entries = &T->table[i * row];
+		for (size_t d = 0; d < row; d++)
+			mpz_init2(entries[d], mpz_sizeinbase(M->m, 2) + 1);
+		T->digits++;
+		
+		if (i == 0)
+			mpz_set(entries[0], T->g);
+		else
+			mod_mul(M, entries[0], entries[-1], entries[-(long) row]);
+		for (size_t d = 1; d < row; d++)
+			mod_mul(M, entries[d], entries[d - 1], entries[0]);
+	}
+	
+	return Qnil;
+}
+
+// g^e mod p
+// {GMP::Integer, Fixnum, Bignum} -> {GMP::Integer}
+VALUE
+pt_pow( VALUE self, VALUE exp ) {
+	rgmp_powm_table *T = powm_table_get(self);
+	rgmp_modulus *M = modulus_get(T->modulus);
+	
+	// Large enough to release the GVL: goes through the batch machinery
+	if (RGMP_NOGVL(work_product(T->digits, M->k)))
+		return rb_ary_entry(powm_batch_call(self, rb_ary_new_from_args(1, exp), 1), 0);
+	
+	mpz_t *r;
+	VALUE result = integer_create(&r);
+	
+	integral2mpz(M->t, exp);
+	if (mpz_sgn(M->t) < 0 && !mpz_invert(M->q, T->g, M->m))
+		rb_raise(rb_eRuntimeError, "input is not invertible on this base");
+	powm_table_eval(T, M, *r, M->t, M->p, M->q);
+	
+	return result;
+}
+
+// g^e mod p for every e of an Array, on several threads for large batches
+// {Array <GMP::Integer, Fixnum, Bignum>}, threads: {Fixnum} -> {Array <GMP::Integer>}
+VALUE
+pt_pow_many( int argc, VALUE *argv, VALUE self ) {
+	VALUE exponents, options;
+	rb_scan_args(argc, argv, "1:", &exponents, &options);
+	Check_Type(exponents, T_ARRAY);
+	
+	return powm_batch_call(self, exponents, rgmp_threads_option(options, 0));
+}
+
+// {} -> {GMP::Modulus}
+VALUE
+pt_modulus( VALUE self ) {
+	return powm_table_get(self)->modulus;
+}
+
+// {} -> {Fixnum}
+VALUE
+pt_max_bits( VALUE self ) {
+	return SIZET2NUM(powm_table_get(self)->max_bits);
+}
+//// end of GMP::PowmTable
+////////////////////////////////////////////////////////////////////
+
+void
+Init_gmpmod() {
+	// GMP::Modulus
+	rb_define_alloc_func(cGMPModulus, modulus_allocate);
+	rb_define_method(cGMPModulus, "initialize", mod_init, 1);
+	rb_define_method(cGMPModulus, "[]", mod_residue, 1);
+	rb_define_method(cGMPModulus, "modulus", mod_modulus, 0);
+	rb_define_method(cGMPModulus, "to_s", mod_to_string, 0);
+	
+	// GMP::ModInt
+	rb_define_alloc_func(cGMPModInt, modint_allocate);
+	rb_define_method(cGMPModInt, "initialize", mi_init, 2);
+	
+	// Conversion methods
+	rb_define_method(cGMPModInt, "to_i", mi_to_integer, 0);
+	rb_define_method(cGMPModInt, "to_gmpz", mi_to_gmpz, 0);
+	rb_define_method(cGMPModInt, "to_s", mi_to_string, 0);
+	rb_define_method(cGMPModInt, "inspect", mi_inspect, 0);
+	rb_define_method(cGMPModInt, "modulus", mi_modulus, 0);
+	
+	// Binary operators
+	rb_define_method(cGMPModInt, "+", mi_addition, 1);
+	rb_define_method(cGMPModInt, "-", mi_subtraction, 1);
+	rb_define_method(cGMPModInt, "*", mi_multiplication, 1);
+	rb_define_method(cGMPModInt, "/", mi_division, 1);
+	rb_define_method(cGMPModInt, "**", mi_power, 1);
+	
+	// Unary operators
+	rb_define_method(cGMPModInt, "-@", mi_negation, 0);
+	rb_define_method(cGMPModInt, "inverse", mi_inverse, 0);
+	
+	// Comparisons
+	rb_define_method(cGMPModInt, "==", mi_equality_test, 1);
+	rb_define_method(cGMPModInt, "zero?", mi_zero, 0);
+	rb_define_method(cGMPModInt, "coerce", mi_coerce, 1);
+	
+	// Inplace methods
+	rb_define_method(cGMPModInt, "add!", mi_addition_inplace, 1);
+	rb_define_method(cGMPModInt, "sub!", mi_subtraction_inplace, 1);
+	rb_define_method(cGMPModInt, "mul!", mi_multiplication_inplace, 1);
+	rb_define_method(cGMPModInt, "div!", mi_division_inplace, 1);
+	rb_define_method(cGMPModInt, "pow!", mi_power_inplace, 1);
+	rb_define_method(cGMPModInt, "neg!", mi_negation_inplace, 0);
+	rb_define_method(cGMPModInt, "inverse!", mi_inverse_inplace, 0);
+	
+	// GMP::PowmTable
+	rb_define_alloc_func(cGMPPowmTable, powm_table_allocate);
+	rb_define_method(cGMPPowmTable, "initialize", pt_init, 3);
+	rb_define_method(cGMPPowmTable, "pow", pt_pow, 1);
+	rb_define_method(cGMPPowmTable, "pow_many", pt_pow_many, -1);
+	rb_define_method(cGMPPowmTable, "modulus", pt_modulus, 0);
+	rb_define_method(cGMPPowmTable, "max_bits", pt_max_bits, 0);
+}
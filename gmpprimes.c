@@ -0,0 +1,454 @@
+/*
+    rGMP is yet another GMP wrapper for Ruby
+    Copyright (C) 2009  Ralf Gunter
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "gmp.h"
+#include "ruby.h"
+#include "rgmp.h"
+
+////////////////////////////////////////////////////////////////////
+//// GMP::Primes
+// A segmented sieve of Eratosthenes over the odd numbers, a bit each: bit i
+// of the segment at base (a multiple of 16) stands for base + 2i + 1.
+// Segments start as a copy of the wheel, a pattern with the multiples of 3,
+// 5, 7, 11 and 13 already crossed off, and are then crossed off by the
+// primes from 17 up to the square root of the range (Z_PRIMES_BASE_LIMIT at
+// most: beyond its square, whatever the sieve leaves goes through z_bpsw).
+// Each task sieves Z_PRIMES_RUN segments in a row, carrying the offsets of
+// the base primes over from one segment to the next.
+#define Z_PRIMES_SEGMENT_BYTES 32768		// fits in L1, or at worst L2
+#define Z_PRIMES_SEGMENT_BITS (8 * (size_t) Z_PRIMES_SEGMENT_BYTES)
+#define Z_PRIMES_SPAN (2 * (unsigned long) Z_PRIMES_SEGMENT_BITS)
+#define Z_PRIMES_WHEEL 15015				// 3 * 5 * 7 * 11 * 13
+#define Z_PRIMES_BASE_LIMIT (1UL << 22)
+#define Z_PRIMES_RUN 16
+
+// Byte b covers 16b + 1 .. 16b + 15, and the pattern repeats every
+// Z_PRIMES_WHEEL bytes (8 periods of the wheel)
+static unsigned char z_primes_wheel[Z_PRIMES_WHEEL];
+
+static void
+z_primes_wheel_init( void ) {
+	for (unsigned long b = 0; b < Z_PRIMES_WHEEL; b++) {
+		for (int k = 0; k < 8; k++) {
+			unsigned long n = 16 * b + 2 * k + 1;
+			if (n % 3 && n % 5 && n % 7 && n % 11 && n % 13)
+				z_primes_wheel[b] |= 1 << k;
+		}
+	}
+}
+
+static const unsigned long z_primes_small[] = { 2, 3, 5, 7, 11, 13 };
+
+typedef struct {
+	VALUE first, last;		// as given
+	mpz_t from, to;
+	mpz_t start;			// from, rounded down to a multiple of 16
+	mpz_t exact;			// (limit + 1)^2, below which the sieve is exact
+	size_t segments;		// from start up to to
+	size_t first_bit;		// of the first segment, for from
+	size_t last_bits;		// of the last segment, for to
+	const uint32_t *primes;	// the base primes, from 17 up to limit
+	size_t count;
+	int inexact;			// limit is below the square root of to
+	unsigned threads;
+	unsigned char *bits;	// a batch of runs, for each
+	size_t batch;			// first segment of the batch
+	size_t batch_runs;
+	size_t *counts;			// primes found by every run, for count
+	int error;
+	VALUE integer;			// yielded above FIXNUM_MAX
+	rgmp_checkpoint cp;
+} z_primes;
+
+// The bits of segment k within [from, to]
+static void
+z_primes_bounds( const z_primes *P, size_t k, size_t *lo, size_t *hi ) {
+	*lo = (k == 0) ? P->first_bit : 0;
+	*hi = (k == P->segments - 1) ? P->last_bits : Z_PRIMES_SEGMENT_BITS;
+}
+
+static size_t
+z_primes_popcount( const unsigned char *bits, size_t lo, size_t hi ) {
+	size_t count = 0;
+	for (; lo < hi && (lo & 63); lo++)
+		count += (bits[lo >> 3] >> (lo & 7)) & 1;
+	for (; lo + 64 <= hi; lo += 64) {
+		uint64_t w;
+		memcpy(&w, bits + lo / 8, sizeof(w));
+		count += __builtin_popcountll(w);
+	}
+	for (; lo < hi; lo++)
+		count += (bits[lo >> 3] >> (lo & 7)) & 1;
+	return count;
+}
+
+// Sieves the n segments from k into bits (n segments long), or into a
+// single segment of its own when bits is NULL, adding the primes found to
+// *count when count is not NULL. Returns 0, or ENOMEM.
+static int
+z_primes_sieve( const z_primes *P, size_t k, size_t n, unsigned char *bits, size_t *count ) {
+	uint64_t *next = malloc(P->count * sizeof(uint64_t) + 1);
+	unsigned char *own = (bits == NULL) ? malloc(Z_PRIMES_SEGMENT_BYTES) : NULL;
+	if (next == NULL || (bits == NULL && own == NULL)) {
+		free(next);
+		free(own);
+		return ENOMEM;
+	}
+	
+	mpz_t base, end, x;
+	mpz_init(base);
+	mpz_init(end);
+	mpz_init(x);
+	
+	for (size_t s = 0; s < n && !rgmp_stopped(&P->cp); s++) {
+		unsigned char *seg = (bits != NULL) ? bits + s * Z_PRIMES_SEGMENT_BYTES : own;
+		mpz_set_ui(base, k + s);
+		mpz_mul_ui(base, base, Z_PRIMES_SPAN);
+		mpz_add(base, base, P->start);
+		mpz_add_ui(end, base, Z_PRIMES_SPAN);
+		
+		// The wheel, from byte base / 16 of the pattern on
+		size_t w = mpz_fdiv_ui(base, 16 * Z_PRIMES_WHEEL) / 16;
+		for (size_t done = 0; done < Z_PRIMES_SEGMENT_BYTES;) {
+			size_t length = Z_PRIMES_WHEEL - w;
+			if (length > Z_PRIMES_SEGMENT_BYTES - done)
+				length = Z_PRIMES_SEGMENT_BYTES - done;
+			memcpy(seg + done, z_primes_wheel + w, length);
+			done += length;
+			w = 0;
+		}
+		if (mpz_sgn(base) == 0)
+			seg[0] = 0;			// 1 .. 15: the wheel primes come separately
+		
+		// Offsets of the first odd multiples of every prime p, from p^2 on
+		for (size_t j = 0; s == 0 && j < P->count; j++) {
+			unsigned long p = P->primes[j];
+			if (mpz_cmp_ui(base, p * p) < 0) {
+				next[j] = (p * p - mpz_get_ui(base) - 1) / 2;
+			} else {
+				unsigned long t = (p - (mpz_fdiv_ui(base, p) + 1) % p) % p;
+				next[j] = ((t & 1) ? t + p : t) / 2;
+			}
+		}
+		for (size_t j = 0; j < P->count; j++) {
+			uint64_t i = next[j], p = P->primes[j];
+			for (; i < Z_PRIMES_SEGMENT_BITS; i += p)
+				seg[i >> 3] &= ~(1 << (i & 7));
+			next[j] = i - Z_PRIMES_SEGMENT_BITS;
+		}
+		
+		size_t lo, hi;
+		z_primes_bounds(P, k + s, &lo, &hi);
+		// What is left beyond the square of the base primes has no factor
+		// below Z_TRIAL_LIMIT either, and skips z_bpsw's trial division
+		if (P->inexact && mpz_cmp(end, P->exact) > 0) {
+			for (size_t i = lo; i < hi; i++) {
+				if (!(seg[i >> 3] & (1 << (i & 7))))
+					continue;
+				mpz_add_ui(x, base, 2 * i + 1);
+#ifdef Z_WORD_PRIMES
+				int prime = (mpz_size(x) <= 1) ? z_word_prime(mpz_get_ui(x)) : z_bpsw_test(x);
+#else
+				int prime = z_bpsw_test(x);
+#endif
+				if (!prime)
+					seg[i >> 3] &= ~(1 << (i & 7));
+			}
+		}
+		if (count != NULL)
+			*count += z_primes_popcount(seg, lo, hi);
+	}
+	
+	mpz_clear(base);
+	mpz_clear(end);
+	mpz_clear(x);
+	free(next);
+	free(own);
+	return 0;
+}
+
+// Run i of the batch, into its share of the bits
+static void
+z_primes_batch_task( void *data, size_t i ) {
+	z_primes *P = data;
+	size_t k = P->batch + i * Z_PRIMES_RUN, n = P->segments - k;
+	if (n > Z_PRIMES_RUN)
+		n = Z_PRIMES_RUN;
+	
+	int error = z_primes_sieve(P, k, n, P->bits + i * Z_PRIMES_RUN * Z_PRIMES_SEGMENT_BYTES, NULL);
+	if (error)
+		P->error = error;
+}
+
+static void *
+z_primes_batch_nogvl( void *p ) {
+	z_primes *P = p;
+	rgmp_parallel_for(P->batch_runs, P->threads, z_primes_batch_task, P, &P->cp);
+	return NULL;
+}
+
+// Run i of the whole range, counted
+static void
+z_primes_count_task( void *data, size_t i ) {
+	z_primes *P = data;
+	size_t k = i * Z_PRIMES_RUN, n = P->segments - k;
+	if (n > Z_PRIMES_RUN)
+		n = Z_PRIMES_RUN;
+	
+	P->counts[i] = 0;
+	int error = z_primes_sieve(P, k, n, NULL, &P->counts[i]);
+	if (error)
+		P->error = error;
+}
+
+static void *
+z_primes_count_nogvl( void *p ) {
+	z_primes *P = p;
+	rgmp_parallel_for((P->segments + Z_PRIMES_RUN - 1) / Z_PRIMES_RUN, P->threads, z_primes_count_task, P, &P->cp);
+	return NULL;
+}
+
+// The odd primes from 17 to Z_PRIMES_BASE_LIMIT, by a plain sieve over the
+// odd numbers, on first use
+static const uint32_t *z_primes_base;
+static size_t z_primes_base_count;
+
+static void
+z_primes_base_init( void ) {
+	char *composite = ZALLOC_N(char, Z_PRIMES_BASE_LIMIT / 2 + 1);
+	for (unsigned long p = 3; p * p <= Z_PRIMES_BASE_LIMIT; p += 2) {
+		if (!composite[p / 2]) {
+			for (unsigned long q = p * p; q <= Z_PRIMES_BASE_LIMIT; q += 2 * p)
+				composite[q / 2] = 1;
+		}
+	}
+	
+	size_t count = 0;
+	for (unsigned long p = 17; p <= Z_PRIMES_BASE_LIMIT; p += 2)
+		count += !composite[p / 2];
+	uint32_t *primes = ALLOC_N(uint32_t, count);
+	count = 0;
+	for (unsigned long p = 17; p <= Z_PRIMES_BASE_LIMIT; p += 2) {
+		if (!composite[p / 2])
+			primes[count++] = (uint32_t) p;
+	}
+	xfree(composite);
+	
+	z_primes_base_count = count;
+	z_primes_base = primes;
+}
+
+// Reads the range and picks the base primes: returns 0 for an empty range
+static int
+z_primes_setup( z_primes *P ) {
+	integral2mpz(P->from, P->first);
+	integral2mpz(P->to, P->last);
+	if (mpz_sgn(P->from) < 0)
+		mpz_set_ui(P->from, 0);
+	if (mpz_cmp(P->from, P->to) > 0)
+		return 0;
+	
+	mpz_tdiv_q_2exp(P->start, P->from, 4);
+	mpz_mul_2exp(P->start, P->start, 4);
+	P->first_bit = (mpz_get_ui(P->from) - mpz_get_ui(P->start)) / 2;
+	
+	mpz_t t;
+	mpz_init(t);
+	mpz_sub(t, P->to, P->start);
+	unsigned long e = mpz_tdiv_q_ui(t, t, Z_PRIMES_SPAN);
+	int fits = mpz_cmp_ui(t, SIZE_MAX / 2) < 0;
+	P->segments = mpz_get_ui(t) + 1;
+	P->last_bits = (e + 1) / 2;
+	
+	// Sieving further than 16 times the length of a short range costs more
+	// than it saves on the tests of what it leaves
+	unsigned long limit = Z_PRIMES_BASE_LIMIT;
+	if (P->segments == 1 && e < limit / 16)
+		limit = (e < Z_TRIAL_LIMIT / 16) ? Z_TRIAL_LIMIT : 16 * e;
+	mpz_sqrt(t, P->to);
+	if (mpz_cmp_ui(t, limit) <= 0)
+		limit = mpz_get_ui(t);
+	else
+		P->inexact = 1;
+	mpz_clear(t);
+	if (!fits)
+		rb_raise(rb_eRangeError, "range too large");
+	mpz_set_ui(P->exact, limit + 1);
+	mpz_mul(P->exact, P->exact, P->exact);
+	
+	if (z_primes_base == NULL)
+		z_primes_base_init();
+	P->primes = z_primes_base;
+	size_t low = 0, high = z_primes_base_count;
+	while (low < high) {
+		size_t middle = (low + high) / 2;
+		if (z_primes_base[middle] <= limit)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	P->count = low;
+	return 1;
+}
+
+static void
+z_primes_call( z_primes *P, void *(*job)(void *) ) {
+	P->error = 0;
+	int state = rgmp_without_gvl(job, P, &P->cp);
+	if (state)
+		rb_jump_tag(state);
+	if (P->error)
+		rb_memerror();
+}
+
+static void
+z_primes_yield( z_primes *P, mpz_srcptr base, unsigned long offset ) {
+	if (mpz_cmp_ui(base, (unsigned long) FIXNUM_MAX - offset) <= 0) {
+		rb_yield(LONG2FIX((long) (mpz_get_ui(base) + offset)));
+	} else {
+		if (NIL_P(P->integer)) {
+			mpz_t *z;
+			P->integer = integer_create(&z);
+		}
+		mpz_add_ui(MPZ_OF(P->integer), base, offset);
+		rb_yield(P->integer);
+	}
+}
+
+static VALUE
+z_primes_each_run( VALUE p ) {
+	z_primes *P = (z_primes *) p;
+	if (!z_primes_setup(P))
+		return Qnil;
+	
+	for (size_t i = 0; i < sizeof(z_primes_small) / sizeof(*z_primes_small); i++) {
+		if (mpz_cmp_ui(P->from, z_primes_small[i]) <= 0 && mpz_cmp_ui(P->to, z_primes_small[i]) >= 0)
+			rb_yield(LONG2FIX(z_primes_small[i]));
+	}
+	
+	size_t runs = (P->segments + Z_PRIMES_RUN - 1) / Z_PRIMES_RUN;
+	size_t per_batch = (P->threads < runs) ? P->threads : runs;
+	P->bits = ALLOC_N(unsigned char, per_batch * Z_PRIMES_RUN * Z_PRIMES_SEGMENT_BYTES);
+	
+	mpz_t base;
+	mpz_init(base);
+	for (size_t run = 0; run < runs; run += per_batch) {
+		P->batch = run * Z_PRIMES_RUN;
+		P->batch_runs = (runs - run < per_batch) ? runs - run : per_batch;
+		z_primes_call(P, z_primes_batch_nogvl);
+		
+		size_t end = P->batch + P->batch_runs * Z_PRIMES_RUN;
+		for (size_t k = P->batch; k < end && k < P->segments; k++) {
+			const unsigned char *seg = P->bits + (k - P->batch) * Z_PRIMES_SEGMENT_BYTES;
+			size_t lo, hi;
+			z_primes_bounds(P, k, &lo, &hi);
+			mpz_set_ui(base, k);
+			mpz_mul_ui(base, base, Z_PRIMES_SPAN);
+			mpz_add(base, base, P->start);
+			
+			for (size_t i = lo; i < hi; i++) {
+				if (seg[i >> 3] & (1 << (i & 7)))
+					z_primes_yield(P, base, 2 * i + 1);
+			}
+		}
+	}
+	mpz_clear(base);
+	return Qnil;
+}
+
+static VALUE
+z_primes_count_run( VALUE p ) {
+	z_primes *P = (z_primes *) p;
+	size_t total = 0;
+	if (!z_primes_setup(P))
+		return INT2FIX(0);
+	
+	for (size_t i = 0; i < sizeof(z_primes_small) / sizeof(*z_primes_small); i++)
+		total += mpz_cmp_ui(P->from, z_primes_small[i]) <= 0 && mpz_cmp_ui(P->to, z_primes_small[i]) >= 0;
+	
+	size_t runs = (P->segments + Z_PRIMES_RUN - 1) / Z_PRIMES_RUN;
+	P->counts = ALLOC_N(size_t, runs);
+	z_primes_call(P, z_primes_count_nogvl);
+	for (size_t i = 0; i < runs; i++)
+		total += P->counts[i];
+	return SIZET2NUM(total);
+}
+
+static VALUE
+z_primes_free( VALUE p ) {
+	z_primes *P = (z_primes *) p;
+	mpz_clear(P->from);
+	mpz_clear(P->to);
+	mpz_clear(P->start);
+	mpz_clear(P->exact);
+	xfree(P->bits);
+	xfree(P->counts);
+	return Qnil;
+}
+
+static void
+z_primes_init( z_primes *P, int argc, VALUE *argv ) {
+	VALUE options;
+	memset(P, 0, sizeof(*P));
+	rb_scan_args(argc, argv, "2:", &P->first, &P->last, &options);
+	P->threads = rgmp_threads_option(options, 1);
+	P->integer = Qnil;
+	mpz_init(P->from);
+	mpz_init(P->to);
+	mpz_init(P->start);
+	mpz_init(P->exact);
+}
+
+// Yields every prime of [from, to] in order: Fixnums up to FIXNUM_MAX, then
+// one and the same GMP::Integer, updated for every prime. threads: n sieves
+// n runs of segments at a time.
+// {GMP::Integer, Fixnum, Bignum}, {GMP::Integer, Fixnum, Bignum}, threads: {Fixnum} -> {GMP::Primes}
+VALUE
+primes_each( int argc, VALUE *argv, VALUE self ) {
+	RETURN_ENUMERATOR_KW(self, argc, argv, rb_keyword_given_p());
+	
+	z_primes P;
+	z_primes_init(&P, argc, argv);
+	rb_ensure(z_primes_each_run, (VALUE) &P, z_primes_free, (VALUE) &P);
+	return self;
+}
+
+// The number of primes in [from, to], sieved on threads: n threads
+// {GMP::Integer, Fixnum, Bignum}, {GMP::Integer, Fixnum, Bignum}, threads: {Fixnum} -> {Fixnum, Bignum}
+VALUE
+primes_count( int argc, VALUE *argv, VALUE self ) {
+	z_primes P;
+	z_primes_init(&P, argc, argv);
+	return rb_ensure(z_primes_count_run, (VALUE) &P, z_primes_free, (VALUE) &P);
+}
+//// end of GMP::Primes
+////////////////////////////////////////////////////////////////////
+
+void
+Init_gmpprimes() {
+	// GMP::Primes
+	rb_define_singleton_method(mGMPPrimes, "each", primes_each, -1);
+	rb_define_singleton_method(mGMPPrimes, "count", primes_count, -1);
+	
+	// The wheel of the prime sieve
+	z_primes_wheel_init();
+}
@@ -24,19 +24,46 @@
 //// Fundamental methods
 // Garbage collection
 void
-rational_mark( mpq_t *q ) {}
-
-void
-rational_free( mpq_t *q ) {
+rational_free( void *p ) {
+	mpq_t *q = p;
 	mpq_clear(*q);
+#ifndef TYPED_DATA_EMBEDDED
+	xfree(q);
+#endif
+}
+
+// Reports the limb memory held by the numerator and denominator
+size_t
+rational_memsize( const void *p ) {
+	const mpq_t *q = p;
+	return ((size_t) (*q)->_mp_num._mp_alloc + (size_t) (*q)->_mp_den._mp_alloc)
+			* sizeof(mp_limb_t);
 }
 
+const rb_data_type_t rational_type = {
+	"GMP::Rational",
+	{ NULL, rational_free, rational_memsize, },
+	NULL, NULL, RGMP_TYPED_FLAGS
+};
+
 // Object allocation
+// The mpq_t lives inside the Ruby object itself (no separate malloc)
 VALUE
 rational_allocate( VALUE klass ) {
-	mpq_t *q = malloc(sizeof(mpq_t));
+	mpq_t *q;
+	VALUE obj = TypedData_Make_Struct(klass, mpq_t, &rational_type, q);
 	mpq_init(*q);
-	return Data_Wrap_Struct(klass, rational_mark, rational_free, q);
+	RGMP_COUNT(STAT_OBJECTS, 1);
+	return obj;
+}
+
+// Creates a new GMP::Rational, pointing *q at its (initialized) mpq_t
+VALUE
+rational_create( mpq_t **q ) {
+	VALUE obj = TypedData_Make_Struct(cGMPRational, mpq_t, &rational_type, *q);
+	mpq_init(**q);
+	RGMP_COUNT(STAT_OBJECTS, 1);
+	return obj;
 }
 
 // Class constructor
@@ -44,18 +71,18 @@ VALUE
 q_init( VALUE self, VALUE ratData ) {
 	// Creates a mpq_t pointer and loads self into it.
 	mpq_t *q;
-	Data_Get_Struct(self, mpq_t, q);
+	TypedData_Get_Struct(self, mpq_t, &rational_type, q);
 	
 	switch (TYPE(ratData)) {
 		case T_DATA: {
 			VALUE class = rb_obj_class(ratData);
 			if (class == cGMPRational) {
 				mpq_t *dr;
-				Data_Get_Struct(ratData, mpq_t, dr);
+				TypedData_Get_Struct(ratData, mpq_t, &rational_type, dr);
 				mpq_set(*q, *dr);
 			} else if (class == cGMPInteger) {
 				mpz_t *dz;
-				Data_Get_Struct(ratData, mpz_t, dz);
+				TypedData_Get_Struct(ratData, mpz_t, &integer_type, dz);
 				mpq_set_z(*q, *dz);
 			} else if (class == cGMPFloat) {
 #ifdef MPFR
@@ -65,9 +92,10 @@ q_init( VALUE self, VALUE ratData ) {
 typedef __mpf_struct mpf_t[1];
 
 				mpfr_t *dfr;
-				Data_Get_Struct(ratData, mpfr_t, dfr);
+				TypedData_Get_Struct(ratData, mpfr_t, &float_type, dfr);
 				mpf_t df;
 				__gmpf_init(df);
+				RGMP_COUNT(STAT_TEMPORARIES, 1);
 				mpfr_get_f(df, *dfr, GMP_RNDN);
 				mpq_set_f(*q, df);
 				__gmpf_clear(df);
@@ -76,7 +104,7 @@ typedef __mpf_struct mpf_t[1];
 
 #else
 				mpf_t *df;
-				Data_Get_Struct(ratData, mpf_t, df);
+				TypedData_Get_Struct(ratData, mpf_t, &float_type, df);
 				mpq_set_f(*q, *df);
 #endif
 			} else {
@@ -84,8 +112,15 @@ typedef __mpf_struct mpf_t[1];
 			}
 			break;
 		}
+		case T_FIXNUM:
+		case T_BIGNUM: {
+			num2mpz(mpq_numref(*q), ratData);
+			mpz_set_ui(mpq_denref(*q), 1);
+			break;
+		}
 		case T_STRING: {
 			mpq_set_str(*q, StringValuePtr(ratData), 10);
+			RGMP_COUNT(STAT_STRING_CONVERSIONS, 1);
 			
 			if (mpz_cmp_ui(mpq_denref(*q), 0) == 0)
 				rb_raise(rb_eRuntimeError, "denominator cannot be zero");
@@ -111,7 +146,7 @@ VALUE
 q_to_string( VALUE argc, VALUE *argv, VALUE self ) {
 	// Loads self into a mpq_t
 	mpq_t *s;
-	Data_Get_Struct(self, mpq_t, s);
+	TypedData_Get_Struct(self, mpq_t, &rational_type, s);
 	
 	// Creates a placeholder for the optional argument
 	VALUE base;
@@ -135,6 +170,7 @@ q_to_string( VALUE argc, VALUE *argv, VALUE self ) {
 		rb_raise(rb_eRangeError, "base out of range");
 	
 	char *intStr = mpq_get_str(NULL, intBase, *s);
+	RGMP_COUNT(STAT_STRING_CONVERSIONS, 1);
 	VALUE rStr = rb_str_new2(intStr);
 	free(intStr);
 	
@@ -147,7 +183,7 @@ VALUE
 q_to_float( VALUE self ) {
 	// Loads self into a mpq_t
 	mpq_t *s;
-	Data_Get_Struct(self, mpq_t, s);
+	TypedData_Get_Struct(self, mpq_t, &rational_type, s);
 	
 	return rb_float_new(mpq_get_d(*s));
 }
@@ -158,13 +194,13 @@ VALUE
 q_to_gmpz( VALUE self ) {
 	// Loads self into a mpq_t
 	mpq_t *s;
-	Data_Get_Struct(self, mpq_t, s);
+	TypedData_Get_Struct(self, mpq_t, &rational_type, s);
 	
-	mpz_t *i = malloc(sizeof(*i));
-	mpz_init(*i);
+	mpz_t *i;
+	VALUE result = integer_create(&i);
 	mpz_set_q(*i, *s);
 	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, i);
+	return result;
 }
 
 // To GMP::Rational
@@ -184,157 +220,216 @@ VALUE
 q_to_gmpf( VALUE self ) {
 	// Loads self into a mpq_t
 	mpq_t *s;
-	Data_Get_Struct(self, mpq_t, s);
+	TypedData_Get_Struct(self, mpq_t, &rational_type, s);
 	
-	mpf_t *f = malloc(sizeof(*f));
-	mpf_init(*f);
+	mpf_t *f;
+	VALUE result = float_create(&f);
 	mpf_set_q(*f, *s);
 	
-	return Data_Wrap_Struct(cGMPFloat, float_mark, float_free, f);
+	return result;
 }
 //// end of conversion methods
 ////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////
 //// Binary arithmetical operators
-// Addition (+)
-// {GMP::Rational} -> {GMP::Rational}
-VALUE
-q_addition( VALUE self, VALUE summand ) {
-	// Creates pointers to self's and the result's mpq_t structures
-	mpq_t *r = malloc(sizeof(*r));
-	mpq_t *q;
-	
-	// Loads self into *q
-	Data_Get_Struct(self, mpq_t, q);
-	
-	// Inits the result
-	mpq_init(*r);
-	
-	// Decides what to do based on the summand's type/class
-	switch (TYPE(summand)) {
-		case T_DATA: {
-			if (rb_obj_class(summand) == cGMPRational) {
-				mpq_t *sr;
-				Data_Get_Struct(summand, mpq_t, sr);
-				mpq_add(*r, *q, *sr);
-			} else {
-				rb_raise(rb_eTypeError, "summand's type is not supported");
-			}
+// Operand dispatch (see q_operator in rgmp.h)
+// q_apply classifies the operand once and calls the matching entry of the
+// operator. GMP::Integer and Bignum operands are combined with the numerator
+// and denominator directly (no mpq_t is built for them), and Fixnums go
+// through unsigned long functions without any temporaries.
+// r = q OP other (r may be q itself)
+void
+q_apply( mpq_ptr r, mpq_srcptr q, VALUE other, const q_operator *op ) {
+	switch (operand_kind(other)) {
+		case OPERAND_RATIONAL: {
+			op->qq(r, q, MPQ_OF(other));
+			break;
+		}
+		case OPERAND_INTEGER: {
+			op->qz(r, q, MPZ_OF(other));
+			break;
+		}
+		case OPERAND_FIXNUM: {
+			op->ql(r, q, FIX2LONG(other));
+			break;
+		}
+		case OPERAND_BIGNUM: {
+			mpz_t tempBig;
+			mpz_init(tempBig);
+			RGMP_COUNT(STAT_TEMPORARIES, 1);
+			num2mpz(tempBig, other);
+			op->qz(r, q, tempBig);
+			mpz_clear(tempBig);
 			break;
 		}
 		default: {
-			rb_raise(rb_eTypeError, "summand's type is not supported");
+			rb_raise(rb_eTypeError, "input data type not supported");
 		}
 	}
-	
-	return Data_Wrap_Struct(cGMPRational, rational_mark, rational_free, r);
 }
 
-// Subtraction (-)
-// {GMP::Rational} -> {GMP::Rational}
-VALUE
-q_subtraction( VALUE self, VALUE subtrahend ) {
-	// Creates pointers to self's and the result's mpq_t structures
-	mpq_t *r = malloc(sizeof(*r));
-	mpq_t *q;
+// n/d + z == (n + d*z)/d, which is still in canonical form
+static void
+q_add_mpz( mpq_ptr r, mpq_srcptr q, mpz_srcptr z ) {
+	if (r != q)
+		mpq_set(r, q);
+	mpz_addmul(mpq_numref(r), mpq_denref(r), z);
+}
+
+static void
+q_sub_mpz( mpq_ptr r, mpq_srcptr q, mpz_srcptr z ) {
+	if (r != q)
+		mpq_set(r, q);
+	mpz_submul(mpq_numref(r), mpq_denref(r), z);
+}
+
+static void
+q_add_long( mpq_ptr r, mpq_srcptr q, long l ) {
+	if (r != q)
+		mpq_set(r, q);
+	if (l >= 0)
+		mpz_addmul_ui(mpq_numref(r), mpq_denref(r), l);
+	else
+		mpz_submul_ui(mpq_numref(r), mpq_denref(r), -(unsigned long) l);
+}
+
+static void
+q_sub_long( mpq_ptr r, mpq_srcptr q, long l ) {
+	if (r != q)
+		mpq_set(r, q);
+	if (l >= 0)
+		mpz_submul_ui(mpq_numref(r), mpq_denref(r), l);
+	else
+		mpz_addmul_ui(mpq_numref(r), mpq_denref(r), -(unsigned long) l);
+}
+
+// n/d * z == (n * (z/g)) / (d/g), with g = gcd(z, d)
+static void
+q_mul_mpz( mpq_ptr r, mpq_srcptr q, mpz_srcptr z ) {
+	mpz_t g;
+	mpz_init(g);
+	RGMP_COUNT(STAT_TEMPORARIES, 1);
+	mpz_gcd(g, z, mpq_denref(q));
+	
+	if (mpz_sgn(z) == 0) {
+		mpq_set_ui(r, 0, 1);
+	} else {
+		mpz_divexact(mpq_denref(r), mpq_denref(q), g);
+		mpz_divexact(g, z, g);
+		mpz_mul(mpq_numref(r), mpq_numref(q), g);
+	}
 	
-	// Loads self into *q
-	Data_Get_Struct(self, mpq_t, q);
+	mpz_clear(g);
+}
+
+static void
+q_mul_long( mpq_ptr r, mpq_srcptr q, long l ) {
+	if (l == 0) {
+		mpq_set_ui(r, 0, 1);
+		return;
+	}
 	
-	// Inits the result
-	mpq_init(*r);
+	unsigned long ul = (l > 0) ? (unsigned long) l : -(unsigned long) l;
+	unsigned long g = mpz_gcd_ui(NULL, mpq_denref(q), ul);
 	
-	// Decides what to do based on the subtrahend's type/class
-	switch (TYPE(subtrahend)) {
-		case T_DATA: {
-			if (rb_obj_class(subtrahend) == cGMPRational) {
-				mpq_t *sr;
-				Data_Get_Struct(subtrahend, mpq_t, sr);
-				mpq_sub(*r, *q, *sr);
-			} else {
-				rb_raise(rb_eTypeError, "subtrahend's type is not supported");
-			}
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "subtrahend's type is not supported");
-		}
+	mpz_divexact_ui(mpq_denref(r), mpq_denref(q), g);
+	mpz_mul_ui(mpq_numref(r), mpq_numref(q), ul / g);
+	if (l < 0)
+		mpz_neg(mpq_numref(r), mpq_numref(r));
+}
+
+// n/d / z == (n/g) / (d * (z/g)), with g = gcd(n, z)
+static void
+q_div_mpq( mpq_ptr r, mpq_srcptr q, mpq_srcptr d ) {
+	if (mpq_sgn(d) == 0)
+		rb_raise(rb_eRuntimeError, "divided by zero");
+	mpq_div(r, q, d);
+}
+
+static void
+q_div_mpz( mpq_ptr r, mpq_srcptr q, mpz_srcptr z ) {
+	if (mpz_sgn(z) == 0)
+		rb_raise(rb_eRuntimeError, "divided by zero");
+	
+	mpz_t g;
+	mpz_init(g);
+	RGMP_COUNT(STAT_TEMPORARIES, 1);
+	mpz_gcd(g, mpq_numref(q), z);
+	mpz_divexact(mpq_numref(r), mpq_numref(q), g);
+	mpz_divexact(g, z, g);
+	mpz_mul(mpq_denref(r), mpq_denref(q), g);
+	mpz_clear(g);
+	
+	// The denominator must stay positive
+	if (mpz_sgn(mpq_denref(r)) < 0) {
+		mpz_neg(mpq_numref(r), mpq_numref(r));
+		mpz_neg(mpq_denref(r), mpq_denref(r));
 	}
-	
-	return Data_Wrap_Struct(cGMPRational, rational_mark, rational_free, r);
 }
 
-// Multiplication (*)
-// {GMP::Rational} -> {GMP::Rational}
+static void
+q_div_long( mpq_ptr r, mpq_srcptr q, long l ) {
+	if (l == 0)
+		rb_raise(rb_eRuntimeError, "divided by zero");
+	
+	unsigned long ul = (l > 0) ? (unsigned long) l : -(unsigned long) l;
+	unsigned long g = mpz_gcd_ui(NULL, mpq_numref(q), ul);
+	
+	// gcd(0, ul) == ul, which leaves 0/1 as expected
+	mpz_divexact_ui(mpq_numref(r), mpq_numref(q), g);
+	mpz_mul_ui(mpq_denref(r), mpq_denref(q), ul / g);
+	if (l < 0)
+		mpz_neg(mpq_numref(r), mpq_numref(r));
+}
+
+const q_operator q_add_op = { mpq_add, q_add_mpz, q_add_long };
+const q_operator q_sub_op = { mpq_sub, q_sub_mpz, q_sub_long };
+const q_operator q_mul_op = { mpq_mul, q_mul_mpz, q_mul_long };
+const q_operator q_div_op = { q_div_mpq, q_div_mpz, q_div_long };
+
+// Creates a new GMP::Rational holding self OP other
 VALUE
-q_multiplication( VALUE self, VALUE multiplicand ) {
+q_binary_operation( VALUE self, VALUE other, const q_operator *op ) {
 	// Creates pointers to self's and the result's mpq_t structures
-	mpq_t *r = malloc(sizeof(*r));
+	mpq_t *r;
+	VALUE result = rational_create(&r);
 	mpq_t *q;
 	
 	// Loads self into *q
-	Data_Get_Struct(self, mpq_t, q);
+	TypedData_Get_Struct(self, mpq_t, &rational_type, q);
 	
-	// Inits the result
-	mpq_init(*r);
+	q_apply(*r, *q, other, op);
 	
-	// Decides what to do based on the multiplicand's type/class
-	switch (TYPE(multiplicand)) {
-		case T_DATA: {
-			if (rb_obj_class(multiplicand) == cGMPRational) {
-				mpq_t *sr;
-				Data_Get_Struct(multiplicand, mpq_t, sr);
-				mpq_mul(*r, *q, *sr);
-			} else {
-				rb_raise(rb_eTypeError, "multiplicand's type is not supported");
-			}
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "multiplicand's type is not supported");
-		}
-	}
-	
-	return Data_Wrap_Struct(cGMPRational, rational_mark, rational_free, r);
+	return result;
+}
+
+// Addition (+)
+// {GMP::Rational, GMP::Integer, Fixnum, Bignum} -> {GMP::Rational}
+VALUE
+q_addition( VALUE self, VALUE summand ) {
+	return q_binary_operation(self, summand, &q_add_op);
+}
+
+// Subtraction (-)
+// {GMP::Rational, GMP::Integer, Fixnum, Bignum} -> {GMP::Rational}
+VALUE
+q_subtraction( VALUE self, VALUE subtrahend ) {
+	return q_binary_operation(self, subtrahend, &q_sub_op);
+}
+
+// Multiplication (*)
+// {GMP::Rational, GMP::Integer, Fixnum, Bignum} -> {GMP::Rational}
+VALUE
+q_multiplication( VALUE self, VALUE multiplicand ) {
+	return q_binary_operation(self, multiplicand, &q_mul_op);
 }
 
 // Division (/)
-// {GMP::Rational} -> {GMP::Rational}
+// {GMP::Rational, GMP::Integer, Fixnum, Bignum} -> {GMP::Rational}
 VALUE
 q_division( VALUE self, VALUE divisor ) {
-	// Creates pointers to self's and the result's mpq_t structures
-	mpq_t *r = malloc(sizeof(*r));
-	mpq_t *q;
-	
-	// Loads self into *q
-	Data_Get_Struct(self, mpq_t, q);
-	
-	// Inits the result
-	mpq_init(*r);
-	
-	// Decides what to do based on the divisor's type/class
-	switch (TYPE(divisor)) {
-		case T_DATA: {
-			if (rb_obj_class(divisor) == cGMPRational) {
-				mpq_t *sr;
-				Data_Get_Struct(divisor, mpq_t, sr);
-				
-				if (mpq_sgn(*sr) == 0)
-					rb_raise(rb_eRuntimeError, "divided by zero");
-				
-				mpq_div(*r, *q, *sr);
-			} else {
-				rb_raise(rb_eTypeError, "divisor's type is not supported");
-			}
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "divisor's type is not supported");
-		}
-	}
-	
-	return Data_Wrap_Struct(cGMPRational, rational_mark, rational_free, r);
+	return q_binary_operation(self, divisor, &q_div_op);
 }
 //// end of binary arithmetical operators
 ////////////////////////////////////////////////////////////////////
@@ -353,48 +448,49 @@ q_positive( VALUE self ) {
 VALUE
 q_negation( VALUE self ) {
 	// Creates pointers to self's and the result's mpq_t structures
-	mpq_t *r = malloc(sizeof(*r));
+	mpq_t *r;
+	VALUE result = rational_create(&r);
 	mpq_t *q;
 	
 	// Loads self into *q
-	Data_Get_Struct(self, mpq_t, q);
-	
-	// Inits the result
-	mpq_init(*r);
+	TypedData_Get_Struct(self, mpq_t, &rational_type, q);
 	
 	// Negates i, and copies the result to r
 	mpq_neg(*r, *q);
 	
-	return Data_Wrap_Struct(cGMPRational, rational_mark, rational_free, r);
+	return result;
 }
 //// end of unary arithmetical operators
 ////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////
 //// Comparison methods
-// Equality (==)
-// {GMP::Rational} -> {TrueClass, FalseClass}
-VALUE
-q_equality_test( VALUE self, VALUE other ) {
+// Compares self with other, returning a negative number, zero or a positive
+// number, like mpq_cmp
+int
+q_compare( VALUE self, VALUE other ) {
 	// Creates a mpq_t pointer and loads self in it
 	mpq_t *q;
-	Data_Get_Struct(self, mpq_t, q);
+	TypedData_Get_Struct(self, mpq_t, &rational_type, q);
 	
-	// Immediate responses to avoid one object creation
-	switch (TYPE(other)) {
-		case T_DATA: {
-			if (rb_obj_class(other) == cGMPRational) {
-				mpq_t *od;
-				Data_Get_Struct(other, mpq_t, od);
-				
-				if (mpq_cmp(*q, *od) == 0)
-					return Qtrue;
-				else
-					return Qfalse;
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
-			break;
+	switch (operand_kind(other)) {
+		case OPERAND_RATIONAL: {
+			return mpq_cmp(*q, MPQ_OF(other));
+		}
+		case OPERAND_INTEGER: {
+			return mpq_cmp_z(*q, MPZ_OF(other));
+		}
+		case OPERAND_FIXNUM: {
+			return mpq_cmp_si(*q, FIX2LONG(other), 1);
+		}
+		case OPERAND_BIGNUM: {
+			mpz_t tempBig;
+			mpz_init(tempBig);
+			RGMP_COUNT(STAT_TEMPORARIES, 1);
+			num2mpz(tempBig, other);
+			int result = mpq_cmp_z(*q, tempBig);
+			mpz_clear(tempBig);
+			return result;
 		}
 		default: {
 			rb_raise(rb_eTypeError, "input data type not supported");
@@ -402,118 +498,182 @@ q_equality_test( VALUE self, VALUE other ) {
 	}
 }
 
+// Equality (==)
+// {GMP::Rational, GMP::Integer, Fixnum, Bignum} -> {TrueClass, FalseClass}
+VALUE
+q_equality_test( VALUE self, VALUE other ) {
+	return (q_compare(self, other) == 0) ? Qtrue : Qfalse;
+}
+
 // Greater than (>)
-// {GMP::Rational} -> {TrueClass, FalseClass}
+// {GMP::Rational, GMP::Integer, Fixnum, Bignum} -> {TrueClass, FalseClass}
 VALUE
 q_greater_than_test( VALUE self, VALUE other ) {
+	return (q_compare(self, other) > 0) ? Qtrue : Qfalse;
+}
+
+// Less than (<)
+// {GMP::Rational, GMP::Integer, Fixnum, Bignum} -> {TrueClass, FalseClass}
+VALUE
+q_less_than_test( VALUE self, VALUE other ) {
+	return (q_compare(self, other) < 0) ? Qtrue : Qfalse;
+}
+
+// Greater than or equal to (>=)
+// {GMP::Rational, GMP::Integer, Fixnum, Bignum} -> {TrueClass, FalseClass}
+VALUE
+q_greater_than_or_equal_to_test( VALUE self, VALUE other ) {
+	return (q_compare(self, other) >= 0) ? Qtrue : Qfalse;
+}
+
+// Less than or equal to (<=)
+// {GMP::Rational, GMP::Integer, Fixnum, Bignum} -> {TrueClass, FalseClass}
+VALUE
+q_less_than_or_equal_to_test( VALUE self, VALUE other ) {
+	return (q_compare(self, other) <= 0) ? Qtrue : Qfalse;
+}
+
+// Generic comparison (<=>)
+// {GMP::Rational, GMP::Integer, Fixnum, Bignum} -> {Fixnum}
+VALUE
+q_generic_comparison( VALUE self, VALUE other ) {
+	int result = q_compare(self, other);
+	
+	// mpq_cmp only promises the sign of its result
+	return INT2FIX((result > 0) - (result < 0));
+}
+//// end of comparison operators
+////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////
+//// Inplace methods (the caller inherits the result)
+// Sets self to self OP other
+static VALUE
+q_inplace_operation( VALUE self, VALUE other, const q_operator *op ) {
 	// Creates a mpq_t pointer and loads self in it
 	mpq_t *q;
-	Data_Get_Struct(self, mpq_t, q);
+	TypedData_Get_Struct(self, mpq_t, &rational_type, q);
 	
-	// Immediate responses to avoid one object creation
-	switch (TYPE(other)) {
-		case T_DATA: {
-			if (rb_obj_class(other) == cGMPRational) {
-				mpq_t *od;
-				Data_Get_Struct(other, mpq_t, od);
-				
-				if (mpq_cmp(*q, *od) > 0)
-					return Qtrue;
-				else
-					return Qfalse;
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "input data type not supported");
-		}
-	}
+	q_apply(*q, *q, other, op);
+	
+	return Qnil;
 }
 
-// Less than (>)
-// {GMP::Rational} -> {TrueClass, FalseClass}
+// Addition (in-place)
+// {GMP::Rational, GMP::Integer, Fixnum, Bignum} -> {NilClass}
 VALUE
-q_less_than_test( VALUE self, VALUE other ) {
+q_addition_inplace( VALUE self, VALUE summand ) {
+	return q_inplace_operation(self, summand, &q_add_op);
+}
+
+// Subtraction (in-place)
+// {GMP::Rational, GMP::Integer, Fixnum, Bignum} -> {NilClass}
+VALUE
+q_subtraction_inplace( VALUE self, VALUE subtrahend ) {
+	return q_inplace_operation(self, subtrahend, &q_sub_op);
+}
+
+// Multiplication (in-place)
+// {GMP::Rational, GMP::Integer, Fixnum, Bignum} -> {NilClass}
+VALUE
+q_multiplication_inplace( VALUE self, VALUE multiplicand ) {
+	return q_inplace_operation(self, multiplicand, &q_mul_op);
+}
+
+// Division (in-place)
+// {GMP::Rational, GMP::Integer, Fixnum, Bignum} -> {NilClass}
+VALUE
+q_division_inplace( VALUE self, VALUE divisor ) {
+	return q_inplace_operation(self, divisor, &q_div_op);
+}
+
+// Negation (in-place)
+// {} -> {NilClass}
+VALUE
+q_negation_inplace( VALUE self ) {
 	// Creates a mpq_t pointer and loads self in it
 	mpq_t *q;
-	Data_Get_Struct(self, mpq_t, q);
+	TypedData_Get_Struct(self, mpq_t, &rational_type, q);
 	
-	// Immediate responses to avoid one object creation
-	switch (TYPE(other)) {
-		case T_DATA: {
-			if (rb_obj_class(other) == cGMPRational) {
-				mpq_t *od;
-				Data_Get_Struct(other, mpq_t, od);
-				
-				if (mpq_cmp(*q, *od) < 0)
-					return Qtrue;
-				else
-					return Qfalse;
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "input data type not supported");
-		}
-	}
+	mpq_neg(*q, *q);
+	
+	return Qnil;
 }
 
-// Greater than or equal to (>=)
-// {GMP::Rational} -> {TrueClass, FalseClass}
+// Absolute value (in-place)
+// {} -> {NilClass}
 VALUE
-q_greater_than_or_equal_to_test( VALUE self, VALUE other ) {
+q_absolute_inplace( VALUE self ) {
 	// Creates a mpq_t pointer and loads self in it
 	mpq_t *q;
-	Data_Get_Struct(self, mpq_t, q);
+	TypedData_Get_Struct(self, mpq_t, &rational_type, q);
 	
-	// Immediate responses to avoid one object creation
-	switch (TYPE(other)) {
-		case T_DATA: {
-			if (rb_obj_class(other) == cGMPRational) {
-				mpq_t *od;
-				Data_Get_Struct(other, mpq_t, od);
-				
-				if (mpq_cmp(*q, *od) >= 0)
-					return Qtrue;
-				else
-					return Qfalse;
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "input data type not supported");
-		}
-	}
+	mpq_abs(*q, *q);
+	
+	return Qnil;
 }
 
-// Less than or equal to (<=)
-// {GMP::Rational} -> {TrueClass, FalseClass}
+// Inversion (in-place)
+// {} -> {NilClass}
 VALUE
-q_less_than_or_equal_to_test( VALUE self, VALUE other ) {
+q_invert_inplace( VALUE self ) {
 	// Creates a mpq_t pointer and loads self in it
 	mpq_t *q;
-	Data_Get_Struct(self, mpq_t, q);
+	TypedData_Get_Struct(self, mpq_t, &rational_type, q);
 	
-	// Immediate responses to avoid one object creation
-	switch (TYPE(other)) {
-		case T_DATA: {
-			if (rb_obj_class(other) == cGMPRational) {
-				mpq_t *od;
-				Data_Get_Struct(other, mpq_t, od);
-				
-				if (mpq_cmp(*q, *od) <= 0)
-					return Qtrue;
-				else
-					return Qfalse;
+	// Same check as in inv, since GMP would divide by zero
+	if (mpq_sgn(*q) == 0)
+		rb_raise(rb_eRuntimeError, "numerator cannot be zero");
+	
+	mpq_inv(*q, *q);
+	
+	return Qnil;
+}
+
+// q += first * second (or q -= first * second)
+// A GMP::Rational factor goes through a temporary mpq_t. When both factors
+// are integral (GMP::Integer or Ruby Integer), their product is added to the numerator scaled by the
+// denominator, which needs no canonicalization at all.
+static void
+q_addmul_apply( mpq_ptr q, VALUE first, VALUE second, int subtract ) {
+	// Puts the GMP::Rational factor (if any) first
+	if (operand_kind(first) != OPERAND_RATIONAL &&
+			operand_kind(second) == OPERAND_RATIONAL) {
+		VALUE tmp = first;
+		first = second;
+		second = tmp;
+	}
+	
+	switch (operand_kind(first)) {
+		case OPERAND_RATIONAL: {
+			mpq_t product;
+			mpq_init(product);
+			RGMP_COUNT(STAT_TEMPORARIES, 1);
+			q_apply(product, MPQ_OF(first), second, &q_mul_op);
+			if (subtract)
+				mpq_sub(q, q, product);
+			else
+				mpq_add(q, q, product);
+			mpq_clear(product);
+			break;
+		}
+		case OPERAND_INTEGER:
+		case OPERAND_FIXNUM:
+		case OPERAND_BIGNUM: {
+			mpz_t product;
+			mpz_init(product);
+			RGMP_COUNT(STAT_TEMPORARIES, 1);
+			if (operand_kind(first) == OPERAND_INTEGER) {
+				z_apply(product, MPZ_OF(first), second, &z_mul_op);
 			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
+				integral2mpz(product, first);
+				z_apply(product, product, second, &z_mul_op);
 			}
+			if (subtract)
+				mpz_submul(mpq_numref(q), mpq_denref(q), product);
+			else
+				mpz_addmul(mpq_numref(q), mpq_denref(q), product);
+			mpz_clear(product);
 			break;
 		}
 		default: {
@@ -522,34 +682,32 @@ q_less_than_or_equal_to_test( VALUE self, VALUE other ) {
 	}
 }
 
-// Generic comparison (<=>)
-// {GMP::Rational} -> {Fixnum}
+// Multiply two values and then add to self
+// {GMP::Rational, GMP::Integer, Fixnum, Bignum}, {GMP::Rational, GMP::Integer, Fixnum, Bignum}
 VALUE
-q_generic_comparison( VALUE self, VALUE other ) {
+q_addmul_inplace( VALUE self, VALUE first, VALUE second ) {
 	// Creates a mpq_t pointer and loads self in it
 	mpq_t *q;
-	Data_Get_Struct(self, mpq_t, q);
+	TypedData_Get_Struct(self, mpq_t, &rational_type, q);
 	
-	// Immediate responses to avoid one object creation
-	switch (TYPE(other)) {
-		case T_DATA: {
-			if (rb_obj_class(other) == cGMPRational) {
-				mpq_t *od;
-				Data_Get_Struct(other, mpq_t, od);
-				
-				return INT2FIX(mpq_cmp(*q, *od));
-			} else {
-				// I seriously need to start working on these error messages
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "input data type not supported");
-		}
-	}
+	q_addmul_apply(*q, first, second, 0);
+	
+	return Qnil;
 }
-//// end of comparison operators
+
+// Multiply two values and then subtract from self
+// {GMP::Rational, GMP::Integer, Fixnum, Bignum}, {GMP::Rational, GMP::Integer, Fixnum, Bignum}
+VALUE
+q_submul_inplace( VALUE self, VALUE first, VALUE second ) {
+	// Creates a mpq_t pointer and loads self in it
+	mpq_t *q;
+	TypedData_Get_Struct(self, mpq_t, &rational_type, q);
+	
+	q_addmul_apply(*q, first, second, 1);
+	
+	return Qnil;
+}
+//// end of inplace methods
 ////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////
@@ -560,14 +718,13 @@ VALUE
 q_get_numerator( VALUE self, VALUE other ) {
 	// Creates a mpq_t pointer and loads self into it.
 	mpq_t *q;
-	Data_Get_Struct(self, mpq_t, q);
+	TypedData_Get_Struct(self, mpq_t, &rational_type, q);
 	
 	// Creates and initializes the result.
-	mpz_t *z = malloc(sizeof(*z));
-	mpz_init(*z);
-	
+	mpz_t *z;
+	VALUE result = integer_create(&z);
 	mpq_get_num(*z, *q);
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, z);
+	return result;
 }
 
 // Creates a new GMP::Integer object with the initial value
@@ -577,14 +734,13 @@ VALUE
 q_get_denominator( VALUE self, VALUE other ) {
 	// Creates a mpq_t pointer and loads self into it.
 	mpq_t *q;
-	Data_Get_Struct(self, mpq_t, q);
+	TypedData_Get_Struct(self, mpq_t, &rational_type, q);
 	
 	// Creates and initializes the result.
-	mpz_t *z = malloc(sizeof(*z));
-	mpz_init(*z);
-	
+	mpz_t *z;
+	VALUE result = integer_create(&z);
 	mpq_get_den(*z, *q);
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, z);
+	return result;
 }
 //// end of comparison operators
 ////////////////////////////////////////////////////////////////////
@@ -599,8 +755,8 @@ q_swap( VALUE self, VALUE other ) {
 	mpq_t *q, *o;
 	
 	// Copies back the mpq_t pointers wrapped in ruby data objects
-	Data_Get_Struct(self, mpq_t, q);
-	Data_Get_Struct(other, mpq_t, o);
+	TypedData_Get_Struct(self, mpq_t, &rational_type, q);
+	TypedData_Get_Struct(other, mpq_t, &rational_type, o);
 	
 	// Swaps the contents of self and other
 	mpq_swap(*q, *o);
@@ -614,7 +770,7 @@ VALUE
 q_sign( VALUE self ) {
 	// Loads self into a mpq_t
 	mpq_t *s;
-	Data_Get_Struct(self, mpq_t, s);
+	TypedData_Get_Struct(self, mpq_t, &rational_type, s);
 	
 	// Gets the sign of self
 	int intSign = mpq_sgn(*s);
@@ -627,19 +783,17 @@ q_sign( VALUE self ) {
 VALUE
 q_absolute( VALUE self ) {
 	// Creates pointers to self's and the result's mpq_t structures
-	mpq_t *r = malloc(sizeof(*r));
+	mpq_t *r;
+	VALUE result = rational_create(&r);
 	mpq_t *q;
 	
 	// Loads self into *q
-	Data_Get_Struct(self, mpq_t, q);
-	
-	// Inits the result
-	mpq_init(*r);
+	TypedData_Get_Struct(self, mpq_t, &rational_type, q);
 	
 	// Sets the result as the absolute value of self
 	mpq_abs(*r, *q);
 	
-	return Data_Wrap_Struct(cGMPRational, rational_mark, rational_free, r);
+	return result;
 }
 
 // Inversion (1/self)
@@ -647,24 +801,22 @@ q_absolute( VALUE self ) {
 VALUE
 q_invert( VALUE self ) {
 	// Creates pointers to self's and the result's mpq_t structures
-	mpq_t *r = malloc(sizeof(*r));
+	mpq_t *r;
+	VALUE result = rational_create(&r);
 	mpq_t *q;
 	
 	// Loads self into *q
-	Data_Get_Struct(self, mpq_t, q);
+	TypedData_Get_Struct(self, mpq_t, &rational_type, q);
 	
 	// Raises an exception if the numerator is zero (which will make GMP
 	// divide by zero).
 	if (mpz_cmp_ui(mpq_numref(*q), 0) == 0)
 		rb_raise(rb_eRuntimeError, "numerator cannot be zero");
 	
-	// Inits the result
-	mpq_init(*r);
-	
 	// Sets the result as the absolute value of self
 	mpq_inv(*r, *q);
 	
-	return Data_Wrap_Struct(cGMPRational, rational_mark, rational_free, r);
+	return result;
 }
 
 // Coercion (makes operations commutative)
@@ -675,6 +827,150 @@ q_coerce( VALUE self, VALUE other ) {
 //// end of other operations
 ////////////////////////////////////////////////////////////////////
 
+////////////////////////////////////////////////////////////////////
+//// Reductions over Arrays (class methods)
+// Private copies of the numerators and denominators of an Array's
+// elements, freed by q_items_free even when loading or multiplying raises
+typedef struct {
+	VALUE array;
+	mpz_t *nums, *dens;
+	size_t num_count, den_count;
+	mpq_ptr r;
+	unsigned threads;
+} q_items;
+
+static VALUE
+q_items_product( VALUE p ) {
+	q_items *q = (q_items *) p;
+	long length = RARRAY_LEN(q->array);
+	
+	q->nums = ALLOC_N(mpz_t, length);
+	q->dens = ALLOC_N(mpz_t, length);
+	for (long i = 0; i < length; i++) {
+		VALUE element = rb_ary_entry(q->array, i);
+		
+		mpz_init(q->nums[q->num_count++]);
+		if (operand_kind(element) == OPERAND_RATIONAL) {
+			mpz_set(q->nums[i], mpq_numref(MPQ_OF(element)));
+			mpz_init_set(q->dens[q->den_count++], mpq_denref(MPQ_OF(element)));
+		} else {
+			integral2mpz(q->nums[i], element);
+		}
+	}
+	RGMP_COUNT(STAT_TEMPORARIES, q->num_count + q->den_count);
+	
+	// One canonicalization at the end, instead of one gcd per step
+	z_product_tree(mpq_numref(q->r), q->nums, q->num_count, q->threads);
+	z_product_tree(mpq_denref(q->r), q->dens, q->den_count, q->threads);
+	mpq_canonicalize(q->r);
+	return Qnil;
+}
+
+static VALUE
+q_items_free( VALUE p ) {
+	q_items *q = (q_items *) p;
+	for (size_t i = 0; i < q->num_count; i++)
+		mpz_clear(q->nums[i]);
+	for (size_t i = 0; i < q->den_count; i++)
+		mpz_clear(q->dens[i]);
+	xfree(q->nums);
+	xfree(q->dens);
+	return Qnil;
+}
+
+// Product of an Array, as balanced product trees of the numerators and of
+// the denominators
+// {Array <GMP::Rational, GMP::Integer, Fixnum, Bignum>}, threads: {Fixnum} -> {GMP::Rational}
+VALUE
+q_product_singleton( int argc, VALUE *argv, VALUE klass ) {
+	VALUE array, options;
+	rb_scan_args(argc, argv, "1:", &array, &options);
+	Check_Type(array, T_ARRAY);
+	
+	mpq_t *r;
+	VALUE result = rational_create(&r);
+	
+	q_items q = { array, NULL, NULL, 0, 0, *r, rgmp_threads_option(options, 0) };
+	rb_ensure(q_items_product, (VALUE) &q, q_items_free, (VALUE) &q);
+	
+	return result;
+}
+
+// Sum of an Array over a common denominator: the lcm of all denominators
+// is built first, then every numerator is scaled up to it and added to a
+// single accumulator, with one canonicalization at the end
+// {Array <GMP::Rational, GMP::Integer, Fixnum, Bignum>} -> {GMP::Rational}
+VALUE
+q_sum_singleton( VALUE klass, VALUE array ) {
+	Check_Type(array, T_ARRAY);
+	
+	// Checks the types first, so that nothing leaks when raising
+	for (long i = 0; i < RARRAY_LEN(array); i++) {
+		VALUE element = rb_ary_entry(array, i);
+		switch (operand_kind(element)) {
+			case OPERAND_RATIONAL:
+			case OPERAND_INTEGER:
+			case OPERAND_FIXNUM:
+			case OPERAND_BIGNUM:
+				break;
+			default:
+				rb_raise(rb_eTypeError, "expected GMP::Rational, GMP::Integer or Integer, got %s", rb_obj_classname(element));
+		}
+	}
+	
+	mpq_t *r;
+	VALUE result = rational_create(&r);
+	mpz_ptr num = mpq_numref(*r), den = mpq_denref(*r);
+	
+	for (long i = 0; i < RARRAY_LEN(array); i++) {
+		VALUE element = rb_ary_entry(array, i);
+		if (operand_kind(element) == OPERAND_RATIONAL)
+			mpz_lcm(den, den, mpq_denref(MPQ_OF(element)));
+	}
+	
+	mpz_t scale, tempBig;
+	mpz_init(scale);
+	mpz_init(tempBig);
+	RGMP_COUNT(STAT_TEMPORARIES, 2);
+	
+	for (long i = 0; i < RARRAY_LEN(array); i++) {
+		VALUE element = rb_ary_entry(array, i);
+		
+		switch (operand_kind(element)) {
+			case OPERAND_RATIONAL: {
+				mpz_divexact(scale, den, mpq_denref(MPQ_OF(element)));
+				mpz_addmul(num, mpq_numref(MPQ_OF(element)), scale);
+				break;
+			}
+			case OPERAND_INTEGER: {
+				mpz_addmul(num, MPZ_OF(element), den);
+				break;
+			}
+			case OPERAND_FIXNUM: {
+				long l = FIX2LONG(element);
+				if (l >= 0)
+					mpz_addmul_ui(num, den, l);
+				else
+					mpz_submul_ui(num, den, -(unsigned long) l);
+				break;
+			}
+			default: {
+				num2mpz(tempBig, element);
+				mpz_addmul(num, tempBig, den);
+				break;
+			}
+		}
+	}
+	
+	mpz_clear(scale);
+	mpz_clear(tempBig);
+	mpq_canonicalize(*r);
+	
+	return result;
+}
+//// end of reductions over Arrays
+////////////////////////////////////////////////////////////////////
+
 
 
 void
@@ -714,6 +1010,17 @@ Init_gmpq() {
 	rb_define_method(cGMPRational, "<=", q_less_than_or_equal_to_test, 1);
 	rb_define_method(cGMPRational, "<=>", q_generic_comparison, 1);
 	
+	// In-place methods
+	rb_define_method(cGMPRational, "add!", q_addition_inplace, 1);
+	rb_define_method(cGMPRational, "sub!", q_subtraction_inplace, 1);
+	rb_define_method(cGMPRational, "mul!", q_multiplication_inplace, 1);
+	rb_define_method(cGMPRational, "div!", q_division_inplace, 1);
+	rb_define_method(cGMPRational, "neg!", q_negation_inplace, 0);
+	rb_define_method(cGMPRational, "abs!", q_absolute_inplace, 0);
+	rb_define_method(cGMPRational, "inv!", q_invert_inplace, 0);
+	rb_define_method(cGMPRational, "addmul", q_addmul_inplace, 2);
+	rb_define_method(cGMPRational, "submul", q_submul_inplace, 2);
+	
 	// Numerator and denominator accessors
 	rb_define_method(cGMPRational, "num", q_get_numerator, 0);
 	rb_define_method(cGMPRational, "den", q_get_denominator, 0);
@@ -726,4 +1033,8 @@ Init_gmpq() {
 	rb_define_method(cGMPRational, "abs", q_absolute, 0);
 	rb_define_method(cGMPRational, "inv", q_invert, 0);
 	rb_define_method(cGMPRational, "coerce", q_coerce, 1);
+	
+	// Reductions over Arrays
+	rb_define_singleton_method(cGMPRational, "product", q_product_singleton, -1);
+	rb_define_singleton_method(cGMPRational, "sum", q_sum_singleton, 1);
 }
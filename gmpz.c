@@ -16,27 +16,75 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
 #include "gmp.h"
 #include "ruby.h"
+#include "ruby/util.h"
 #include "rgmp.h"
 
 ////////////////////////////////////////////////////////////////////
 //// Fundamental methods
 // Garbage collection
 void
-integer_mark( mpz_t *i ) {}
-
-void
-integer_free( mpz_t *i ) {
+integer_free( void *p ) {
+	mpz_t *i = p;
 	mpz_clear(*i);
+#ifndef TYPED_DATA_EMBEDDED
+	xfree(i);
+#endif
+}
+
+// Reports the limb memory held by the number, which the GC cannot see
+size_t
+integer_memsize( const void *p ) {
+	const mpz_t *i = p;
+	return (size_t) (*i)->_mp_alloc * sizeof(mp_limb_t);
 }
 
+const rb_data_type_t integer_type = {
+	"GMP::Integer",
+	{ NULL, integer_free, integer_memsize, },
+	NULL, NULL, RGMP_TYPED_FLAGS
+};
+
 // Object allocation
+// The mpz_t lives inside the Ruby object itself (no separate malloc)
 VALUE
 integer_allocate( VALUE klass ) {
-	mpz_t *i = malloc(sizeof(mpz_t));
+	mpz_t *i;
+	VALUE obj = TypedData_Make_Struct(klass, mpz_t, &integer_type, i);
 	mpz_init(*i);
-	return Data_Wrap_Struct(klass, integer_mark, integer_free, i);
+	RGMP_COUNT(STAT_OBJECTS, 1);
+	return obj;
+}
+
+// Creates a new GMP::Integer, pointing *i at its (initialized) mpz_t
+VALUE
+integer_create( mpz_t **i ) {
+	VALUE obj = TypedData_Make_Struct(cGMPInteger, mpz_t, &integer_type, *i);
+	mpz_init(**i);
+	RGMP_COUNT(STAT_OBJECTS, 1);
+	return obj;
+}
+
+// The mpz_t of an integral operand: a GMP::Integer's own, or that of a
+// temporary GMP::Integer for Ruby Integers, which *holder keeps alive (the
+// caller must RB_GC_GUARD it)
+static mpz_srcptr
+z_integral_operand( VALUE value, VALUE *holder ) {
+	if (operand_kind(value) == OPERAND_INTEGER)
+		return MPZ_OF(value);
+	
+	mpz_t *z;
+	*holder = integer_create(&z);
+	integral2mpz(*z, value);
+	return *z;
 }
 
 // Class constructor
@@ -44,11 +92,12 @@ VALUE
 z_init( VALUE self, VALUE intData ) {
 	// Creates a mpz_t pointer and loads self in it
 	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
 	switch (TYPE(intData)) {
 		case T_STRING: {
 			mpz_set_str(*i, StringValuePtr(intData), 10);
+			RGMP_COUNT(STAT_STRING_CONVERSIONS, 1);
 			break;
 		}
 		case T_FIXNUM: {
@@ -58,7 +107,7 @@ z_init( VALUE self, VALUE intData ) {
 		case T_DATA: {
 			if (rb_obj_class(intData) == cGMPInteger) {
 				mpz_t *gi;
-				Data_Get_Struct(intData, mpz_t, gi);
+				TypedData_Get_Struct(intData, mpz_t, &integer_type, gi);
 				mpz_set(*i, *gi);
 			} else {
 				rb_raise(rb_eTypeError, "input data type not supported");
@@ -66,13 +115,8 @@ z_init( VALUE self, VALUE intData ) {
 			break;
 		}
 		case T_BIGNUM: {
-			// I have a sort of bittersweet feeling about this one.
-			// On the one hand, this more or less guarantees compatibility with
-			// future Ruby versions by avoiding some internal ties with the way
-			// Bignum is implemented, but on the other hand, it is not without
-			// a (not yet measured) performance drop.
-			VALUE str = rb_big2str(intData, 10);
-			mpz_set_str(*i, StringValuePtr(str), 10);
+			// Copies the limbs over directly (see num2mpz in gmp.c)
+			num2mpz(*i, intData);
 			break;
 		}
 		default: {
@@ -93,7 +137,7 @@ VALUE
 z_to_string( VALUE argc, VALUE *argv, VALUE self ) {
 	// Creates pointers for self and the final string
 	mpz_t *s;
-	Data_Get_Struct(self, mpz_t, s);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, s);
 	
 	// Creates a placeholder for the optional argument
 	VALUE base;
@@ -117,6 +161,7 @@ z_to_string( VALUE argc, VALUE *argv, VALUE self ) {
 		rb_raise(rb_eRangeError, "base out of range");
 	
 	char *intStr = mpz_get_str(NULL, intBase, *s);
+	RGMP_COUNT(STAT_STRING_CONVERSIONS, 1);
 	VALUE rStr = rb_str_new2(intStr);
 	free(intStr);
 	
@@ -128,15 +173,10 @@ VALUE
 z_to_integer( VALUE self ) {
 	// Creates a mpz_t pointer and loads self in it
 	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
-	// See comments on 'case T_BIGNUM:' on the init function above
-	if (mpz_cmp_ui(*i, FIXNUM_MAX) > 0 || mpz_cmp_ui(*i, FIXNUM_MIN) < 0) {
-		return rb_cstr2inum(mpz_get_str(NULL, 10, *i), 10);
-	} else {
-		signed long tempLong = mpz_get_si(*i);
-		return LONG2FIX(tempLong);
-	}
+	// Small values become Fixnums, bigger ones are unpacked limb by limb
+	return mpz2num(*i);
 }
 
 // To Float (double-precision floating point number)
@@ -144,7 +184,7 @@ VALUE
 z_to_float( VALUE self ) {
 	// Creates a mpz_t pointer and loads self in it
 	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
 	double tempDouble = mpz_get_d(*i);
 	
@@ -154,843 +194,1712 @@ z_to_float( VALUE self ) {
 ////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////
-//// Binary arithmetical operators (operations taking two values)
-// Addition (+)
-// {GMP::Integer, Fixnum, Bignum} -> {GMP::Integer}
-VALUE
-z_addition( VALUE self, VALUE summand ) {
-	// Creates pointers to self's and the result's mpz_t structures
-	mpz_t *r = malloc(sizeof(*r));
-	mpz_t *i;
-	
-	// Loads self into *i
-	Data_Get_Struct(self, mpz_t, i);
-	
-	// Inits the result
-	mpz_init(*r);
-	
-	// Decides what to do based on the summand's type/class
-	switch (TYPE(summand)) {
-		case T_DATA: {
-			if (rb_obj_class(summand) == cGMPInteger) {
-				mpz_t *sd;
-				Data_Get_Struct(summand, mpz_t, sd);
-				mpz_add(*r, *i, *sd);
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
-			break;
-		}
-		case T_FIXNUM: {
-			// Yep, also smells like a bad hack
-			// Unfortunately, GMP does not have an addition function that deals
-			// with signed ints
-			mpz_t tempSuf;
-			mpz_init_set_si(tempSuf, FIX2LONG(summand));
-			mpz_add(*r, *i, tempSuf);
-			mpz_clear(tempSuf);
-			break;
-		}
-		case T_BIGNUM: {
-			mpz_t tempSub;
-			VALUE str = rb_big2str(summand, 10);
-			mpz_init_set_str(tempSub, StringValuePtr(str), 10);
-			mpz_add(*r, *i, tempSub);
-			mpz_clear(tempSub);
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "input data type not supported");
-		}
-	}
-	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
+//// Kernels run without the GVL (see rgmp_without_gvl in gmp.c)
+// A GMP call working on private copies of its operands, with a private
+// result that is only swapped into the destination once the GVL is back
+typedef struct z_kernel z_kernel;
+struct z_kernel {
+	void (*run)(z_kernel *);
+	const z_operator *op;
+	rgmp_checkpoint cp;
+	mpz_t r;		// result
+	mpz_t a, b, m;	// operands, left untouched so that the kernel can rerun
+	mpz_t t, u;		// scratch
+	long l;
+	unsigned long n, k;
+	unsigned threads;	// for parallel kernels
+	int nomem;			// set when a kernel's own allocation failed
+	mpz_t *items;		// for product trees
+	size_t count;
+};
+
+static void
+z_kernel_init( z_kernel *k, void (*run)(z_kernel *) ) {
+	k->run = run;
+	k->nomem = 0;
+	mpz_init(k->r);
+	mpz_init(k->a);
+	mpz_init(k->b);
+	mpz_init(k->m);
+	mpz_init(k->t);
+	mpz_init(k->u);
 }
 
-// Subtraction (-)
-// {GMP::Integer, Fixnum, Bignum} -> {GMP::Integer}
-VALUE
-z_subtraction( VALUE self, VALUE subtraend ) {
-	// Creates pointers to self's and the result's mpz_t structures
-	mpz_t *r = malloc(sizeof(*r));
-	mpz_t *i;
-	
-	// Loads self into *i
-	Data_Get_Struct(self, mpz_t, i);
-	
-	// Inits the result
-	mpz_init(*r);
-	
-	// Decides what to do based on the subtraend's type/class
-	switch (TYPE(subtraend)) {
-		case T_DATA: {
-			if (rb_obj_class(subtraend) == cGMPInteger) {
-				mpz_t *sd;
-				Data_Get_Struct(subtraend, mpz_t, sd);
-				mpz_sub(*r, *i, *sd);
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
-			break;
-		}
-		case T_FIXNUM: {
-			// Yep, also smells like a bad hack
-			// Unfortunately, GMP does not have a subtraction function that
-			// deals with signed ints
-			mpz_t tempSuf;
-			mpz_init_set_si(tempSuf, FIX2LONG(subtraend));
-			mpz_sub(*r, *i, tempSuf);
-			break;
-		}
-		case T_BIGNUM: {
-			mpz_t tempSub;
-			VALUE str = rb_big2str(subtraend, 10);
-			mpz_init_set_str(tempSub, StringValuePtr(str), 10);
-			mpz_sub(*r, *i, tempSub);
-			mpz_clear(tempSub);
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "input data type not supported");
-		}
-	}
-	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
+static void *
+z_kernel_nogvl( void *p ) {
+	z_kernel *k = p;
+	k->run(k);
+	return NULL;
 }
 
-// Multiplication (*)
-// {GMP::Integer, Fixnum, Bignum} -> {GMP::Integer}
-VALUE
-z_multiplication( VALUE self, VALUE multiplicand ) {
-	// Creates pointers to self's and the result's mpz_t structures
-	mpz_t *r = malloc(sizeof(*r));
-	mpz_t *i;
-	
-	// Loads self into *i
-	Data_Get_Struct(self, mpz_t, i);
-	
-	// Inits the result
-	mpz_init(*r);
-	
-	// Decides what to do based on the multiplicand's type/class
-	switch (TYPE(multiplicand)) {
-		case T_DATA: {
-			if (rb_obj_class(multiplicand) == cGMPInteger) {
-				mpz_t *sd;
-				Data_Get_Struct(multiplicand, mpz_t, sd);
-				mpz_mul(*r, *i, *sd);
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
-			break;
-		}
-		case T_FIXNUM: {
-			signed long sl = FIX2LONG(multiplicand);
-			mpz_mul_si(*r, *i, sl);
-			break;
-		}
-		case T_BIGNUM: {
-			mpz_t tempMub;
-			VALUE str = rb_big2str(multiplicand, 10);
-			mpz_init_set_str(tempMub, StringValuePtr(str), 10);
-			mpz_mul(*r, *i, tempMub);
-			mpz_clear(tempMub);
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "input data type not supported");
-		}
+// Runs the kernel without the GVL, then moves its result into r, or raises
+// whatever interrupted it
+static void
+z_kernel_call( z_kernel *k, mpz_ptr r ) {
+	int state = rgmp_without_gvl(z_kernel_nogvl, k, &k->cp);
+	
+	if (!state && !k->nomem)
+		mpz_swap(r, k->r);
+	mpz_clear(k->r);
+	mpz_clear(k->a);
+	mpz_clear(k->b);
+	mpz_clear(k->m);
+	mpz_clear(k->t);
+	mpz_clear(k->u);
+	
+	if (state)
+		rb_jump_tag(state);
+	if (k->nomem)
+		rb_memerror();
+}
+
+static void
+z_run_zz( z_kernel *k ) {
+	if (k->op->chunked)
+		k->op->chunked(k->r, k->a, k->b, &k->cp);
+	else
+		k->op->zz(k->r, k->a, k->b);
+}
+
+static void
+z_run_zl( z_kernel *k ) {
+	if (k->op->chunked) {
+		mpz_set_si(k->b, k->l);
+		k->op->chunked(k->r, k->a, k->b, &k->cp);
+	} else {
+		k->op->zl(k->r, k->a, k->l);
 	}
-	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
 }
 
-// Division (/)
-// {GMP::Integer, Fixnum, Bignum} -> {GMP::Integer}
-VALUE
-z_division( VALUE self, VALUE dividend ) {
-	// Creates pointers to self's and the result's mpz_t structures
-	mpz_t *r = malloc(sizeof(*r));
-	mpz_t *i;
-	
-	// Loads self into *i
-	Data_Get_Struct(self, mpz_t, i);
-	
-	// Inits the result
-	mpz_init(*r);
-	
-	// Decides what to do based on the dividend's type/class
-	switch (TYPE(dividend)) {
-		case T_DATA: {
-			if (rb_obj_class(dividend) == cGMPInteger) {
-				mpz_t *sd;
-				Data_Get_Struct(dividend, mpz_t, sd);
-				if (mpz_sgn(*sd) == 0)
-					rb_raise(rb_eZeroDivError, "divided by 0");
-				mpz_fdiv_q(*r, *i, *sd);
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
-			break;
-		}
-		case T_FIXNUM: {
-			signed long sl = FIX2LONG(dividend);
-			if (sl == 0)
-				rb_raise(rb_eZeroDivError, "divided by 0");
-			mpz_fdiv_q_ui(*r, *i, ((sl > 0) ? sl : -sl));
-			if (sl < 0)
-				mpz_neg(*r, *r);
-			break;
-		}
-		case T_BIGNUM: {
-			mpz_t tempDb;
-			VALUE str = rb_big2str(dividend, 10);
-			mpz_init_set_str(tempDb, StringValuePtr(str), 10);
-			mpz_fdiv_q(*r, *i, tempDb);
-			mpz_clear(tempDb);
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "input data type not supported");
-		}
+// The w bits of e starting at bit pos
+static unsigned long
+z_window( mpz_srcptr e, size_t pos, unsigned w ) {
+	size_t limb = pos / GMP_NUMB_BITS, shift = pos % GMP_NUMB_BITS;
+	mp_limb_t d = mpz_getlimbn(e, limb) >> shift;
+	if (shift + w > GMP_NUMB_BITS)
+		d |= mpz_getlimbn(e, limb + 1) << (GMP_NUMB_BITS - shift);
+	return d & ((1UL << w) - 1);
+}
+
+// Multiplication modulo m on k-limb numbers, for the exponentiation loops.
+// Odd moduli of up to Z_REDC_LIMBS limbs use Montgomery's REDC (the way
+// mpz_powm does for small sizes): numbers are kept as x * B^k mod m, in
+// [0, B^k), and the reduction costs about one schoolbook multiplication.
+// Others fall back to a division, which GMP makes subquadratic.
+#define Z_REDC_LIMBS 64
+
+typedef struct {
+	mpz_srcptr modulus;
+	const mp_limb_t *m;
+	mp_size_t k;
+	mp_limb_t minv;		// -1/m mod B (REDC only)
+	int redc;
+	mp_limb_t *t, *q;	// 2k and k + 1 limbs of scratch
+} z_modmul;
+
+// r = t / B^k mod m (REDC) or t mod m, for the 2k limbs of t
+static void
+z_modmul_reduce( z_modmul *M, mp_limb_t *r ) {
+	mp_size_t k = M->k;
+	
+	if (!M->redc) {
+		mpn_tdiv_qr(M->q, r, 0, M->t, 2 * k, M->m, k);
+		return;
 	}
 	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
+	mp_limb_t *u = M->t;
+	for (mp_size_t i = 0; i < k; i++, u++)
+		u[0] = mpn_addmul_1(u, M->m, k, u[0] * M->minv);
+	if (mpn_add_n(r, u, u - k, k))
+		mpn_sub_n(r, r, M->m, k);
 }
 
-// Modulo (from modular arithmetic) (%)
-// {GMP::Integer, Fixnum} -> {GMP::Integer}
-VALUE
-z_modulo( VALUE self, VALUE base ) {
-	// Creates pointers to self's and the result's mpz_t structures
-	mpz_t *r = malloc(sizeof(*r));
-	mpz_t *i;
-	
-	// Loads self into *i
-	Data_Get_Struct(self, mpz_t, i);
-	
-	// Inits the result
-	mpz_init(*r);
-	
-	// Decides what to do based on the base's type/class
-	switch (TYPE(base)) {
-		case T_DATA: {
-			if (rb_obj_class(base) == cGMPInteger) {
-				mpz_t *sd;
-				Data_Get_Struct(base, mpz_t, sd);
-				// Ensures the base is not zero before doing the math
-				if (mpz_cmp_ui(*sd, (unsigned long) 0) == 0)
-					rb_raise(rb_eRuntimeError, "base cannot be zero");
-				mpz_mod(*r, *i, *sd);
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
-			break;
-		}
-		case T_FIXNUM: {
-			unsigned long sl = FIX2LONG(base);
-			// Ensures the base is not zero before doing the math
-			if (sl == (unsigned long) 0)
-				rb_raise(rb_eRuntimeError, "base cannot be zero");
-			mpz_mod_ui(*r, *i, sl);
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "input data type not supported");
-		}
+// r = a * b (mod m); r may alias a or b
+static void
+z_modmul_mul( z_modmul *M, mp_limb_t *r, const mp_limb_t *a, const mp_limb_t *b ) {
+	if (a == b)
+		mpn_sqr(M->t, a, M->k);
+	else
+		mpn_mul_n(M->t, a, b, M->k);
+	z_modmul_reduce(M, r);
+}
+
+// Loads x (0 <= x < m) into the k limbs of r, in Montgomery form for REDC
+static void
+z_modmul_load( z_modmul *M, mp_limb_t *r, mpz_srcptr x, mpz_ptr t ) {
+	if (M->redc) {
+		mpz_mul_2exp(t, x, M->k * GMP_NUMB_BITS);
+		mpz_tdiv_r(t, t, M->modulus);
+		x = t;
 	}
-	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
+	mp_size_t n = mpz_size(x);
+	if (n > 0)
+		mpn_copyi(r, mpz_limbs_read(x), n);
+	if (n < M->k)
+		mpn_zero(r + n, M->k - n);
 }
 
-// Exponetiation (**)
-// {GMP::Integer, Fixnum} -> {GMP::Integer}
-VALUE
-z_power( VALUE self, VALUE exp ) {
-	// Creates pointers to self's and the result's mpz_t structures
-	mpz_t *r = malloc(sizeof(*r));
-	mpz_t *i;
+// Straus' simultaneous exponentiation: r = prod(bases[i]^exps[i]) mod m,
+// for bases already reduced, non-negative exponents and m > 0. Every base
+// gets a table of its powers up to 2^w - 1 and all exponents are read w bits
+// at a time from the top, so that the pairs share a single chain of
+// squarings. Checkpointed every window; returns 0 when the tables cannot be
+// allocated.
+static int
+z_multi_powm( mpz_ptr r, mpz_t *bases, mpz_t *exps, size_t n, mpz_srcptr m, mpz_ptr t, rgmp_checkpoint *cp ) {
+	size_t bits = 0;
+	for (size_t i = 0; i < n; i++) {
+		size_t b = (mpz_sgn(exps[i]) == 0) ? 0 : mpz_sizeinbase(exps[i], 2);
+		if (b > bits)
+			bits = b;
+	}
 	
-	// Loads self into *i
-	Data_Get_Struct(self, mpz_t, i);
+	// The window widths mpz_powm itself switches at
+	unsigned w = (bits <= 24) ? 1 : (bits <= 80) ? 2 : (bits <= 240) ? 3
+			: (bits <= 672) ? 4 : (bits <= 1792) ? 5 : 6;
+	size_t row = ((size_t) 1 << w) - 1;
+	
+	z_modmul M;
+	M.modulus = m;
+	M.m = mpz_limbs_read(m);
+	M.k = mpz_size(m);
+	M.redc = mpz_odd_p(m) && M.k <= Z_REDC_LIMBS;
+	if (M.redc) {
+		// Newton's iteration doubles the correct low bits of 1/m each time,
+		// starting from the 3 that m0 * m0 = 1 (mod 8) gives for free
+		mp_limb_t inv = M.m[0];
+		for (int i = 0; i < 6; i++)
+			inv *= 2 - M.m[0] * inv;
+		M.minv = -inv;
+	}
 	
-	// Inits the result
-	mpz_init(*r);
+	size_t k = M.k;
+	mp_limb_t *limbs = malloc((n * row * k + 4 * k + 1) * sizeof(mp_limb_t));
+	if (limbs == NULL)
+		return 0;
+	mp_limb_t *table = limbs, *x = limbs + n * row * k;
+	M.t = x + k;
+	M.q = M.t + 2 * k;
+	
+	for (size_t i = 0; i < n; i++) {
+		mp_limb_t *powers = &table[i * row * k];
+		z_modmul_load(&M, powers, bases[i], t);
+		for (size_t d = 1; d < row; d++)
+			z_modmul_mul(&M, powers + d * k, powers + (d - 1) * k, powers);
+	}
 	
-	// Decides what to do based on the exponent's type/class
-	switch (TYPE(exp)) {
-		case T_DATA: {
-			if (rb_obj_class(exp) == cGMPInteger) {
-				// Unfortunately GMP does not provide a pure exponetiation
-				// method that takes mpz_t exponents, so we have to convert it
-				// to an unsigned long first, and then use call mpz_pow_ui to
-				// get the result.
-				mpz_t *sd;
-				Data_Get_Struct(exp, mpz_t, sd);
-				
-				if (mpz_cmp_ui(*sd, ULONG_MAX) > 0)
-					rb_raise(rb_eRangeError, "exponent must fit in a ulong");
-				
-				if (mpz_cmp_ui(*sd, 0) < 0)
-					rb_raise(rb_eRangeError, "exponent must be non-negative");
-				
-				mpz_pow_ui(*r, *i, mpz_get_ui(*sd));
+	int empty = 1;
+	for (size_t j = (bits + w - 1) / w; j-- > 0; ) {
+		if (rgmp_poll(cp))
+			break;
+		
+		for (unsigned s = 0; s < w && !empty; s++)
+			z_modmul_mul(&M, x, x, x);
+		for (size_t i = 0; i < n; i++) {
+			unsigned long d = z_window(exps[i], j * w, w);
+			if (d == 0)
+				continue;
+			
+			const mp_limb_t *power = &table[(i * row + d - 1) * k];
+			if (empty) {
+				mpn_copyi(x, power, k);
+				empty = 0;
 			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
+				z_modmul_mul(&M, x, x, power);
 			}
-			break;
-		}
-		case T_FIXNUM: {
-			unsigned long sl = FIX2LONG(exp);
-			if ((signed long) sl < 0)
-				rb_raise(rb_eRangeError, "exponent must be non-negative");
-			mpz_pow_ui(*r, *i, sl);
-			break;
 		}
-		default: {
-			rb_raise(rb_eTypeError, "exponent's type not supported");
+	}
+	
+	if (empty) {
+		mpz_set_ui(r, mpz_cmp_ui(m, 1) != 0);
+	} else {
+		// Out of Montgomery form, and down from [0, B^k) to [0, m)
+		if (M.redc) {
+			mpn_copyi(M.t, x, k);
+			mpn_zero(M.t + k, k);
+			z_modmul_reduce(&M, x);
+			if (mpn_cmp(x, M.m, k) >= 0)
+				mpn_sub_n(x, x, M.m, k);
 		}
+		mpn_copyi(mpz_limbs_write(r, k), x, k);
+		mpz_limbs_finish(r, k);
 	}
 	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
+	free(limbs);
+	return 1;
 }
 
-// Left shift (also multiplication by a power of 2)
-// {Fixnum, Bignum} -> {GMP::Integer}
-VALUE
-z_left_shift( VALUE self, VALUE shift ) {
-	// Creates pointers to self's and the result's mpz_t structures
-	// Also creates a placeholder for the shift amount
-	unsigned long longShift;	// No pun intended
-	mpz_t *r = malloc(sizeof(*r));
-	mpz_t *i;
-	
-	// Loads self into *i
-	Data_Get_Struct(self, mpz_t, i);
-	
-	// Inits the result
-	mpz_init(*r);
-	
-	// If shift is of the correct type, then do the job!
-	// TODO: it is debatable whether or not we should check for
-	// the sign of the shift argument. If the overhead is effectively
-	// negligible, then we should do it.
-	if (!(FIXNUM_P(shift) || TYPE(shift) == T_BIGNUM))
-		rb_raise(rb_eTypeError, "shift is not of a supported type");
-	longShift = NUM2LONG(shift);
-	mpz_mul_2exp(*r, *i, longShift);
-	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
+// items holds the count bases, then their exponents
+static void
+z_run_multi_powm( z_kernel *k ) {
+	if (!z_multi_powm(k->r, k->items, k->items + k->count, k->count, k->m, k->t, &k->cp))
+		k->nomem = 1;
 }
 
-// Right shift (also division by a power of 2)
-// {Fixnum, Bignum} -> {GMP::Integer}
-VALUE
-z_right_shift( VALUE self, VALUE shift ) {
-	// Creates pointers to self's and the result's mpz_t structures
-	// Also creates a placeholder for the shift amount
-	unsigned long longShift;	// No pun intended
-	mpz_t *r = malloc(sizeof(*r));
-	mpz_t *i;
-	
-	// Loads self into *i
-	Data_Get_Struct(self, mpz_t, i);
-	
-	// Inits the result
-	mpz_init(*r);
-	
-	// If shift is of the correct type, then do the job!
-	// TODO: it is debatable whether or not we should check for
-	// the sign of the shift argument. If the overhead is effectively
-	// negligible, then we should do it.
-	if (!(FIXNUM_P(shift) || TYPE(shift) == T_BIGNUM))
-		rb_raise(rb_eTypeError, "shift is not of a supported type");
-	longShift = NUM2LONG(shift);
-	mpz_fdiv_q_2exp(*r, *i, longShift);
-	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
+// A powermod without the GVL is a one-pair z_multi_powm, checkpointed every
+// window: it costs at most about a quarter more than mpz_powm,
+// which cannot be interrupted. The caller loads a = i mod m (or the inverse
+// of i for negative exponents), b = |e| and m = |m|.
+static void
+z_run_powm( z_kernel *k ) {
+	if (!z_multi_powm(k->r, &k->a, &k->b, 1, k->m, k->t, &k->cp))
+		k->nomem = 1;
 }
-//// end of binary operator methods
-////////////////////////////////////////////////////////////////////
 
-////////////////////////////////////////////////////////////////////
-//// Unary arithmetical operators (operations over a single value)
-// Plus (+a)
-// {GMP::Integer} -> {GMP::Integer}
-VALUE
-z_positive( VALUE self ) {
-	return self;
-}
+// Below these, a single GMP call is short enough not to be checkpointed
+#define FAC_CHUNK_BASE 16384
 
-// Negation (-a)
-// {GMP::Integer} -> {GMP::Integer}
-VALUE
-z_negation( VALUE self ) {
-	// Creates pointers to self's and the result's mpz_t structures
-	mpz_t *r = malloc(sizeof(*r));
-	mpz_t *i;
-	
-	// Loads self into *i
-	Data_Get_Struct(self, mpz_t, i);
-	
-	// Inits the result
-	mpz_init(*r);
-	
-	// Negates i, and copies the result to r
-	mpz_neg(*r, *i);
-	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
-}
-//// end of unary operators methods
-////////////////////////////////////////////////////////////////////
+// n! has about n log2(n) bits: beyond this, it would overflow the size of
+// an mpz_t, and the top levels of z_run_fac would run for hours unchecked
+#define FAC_MAX (1UL << 31)
+#define FIB_CHUNK_BASE 65536
 
-////////////////////////////////////////////////////////////////////
-//// Logic operators
-// Logic AND (&)
-// {GMP::Integer, Fixnum} -> {GMP::Integer}
-VALUE
-z_logic_and( VALUE self, VALUE other ) {
-	// Creates pointers to self's and result's mpz_t structures
-	mpz_t *r = malloc(sizeof(*r));
-	mpz_t *i;
-	
-	// Loads self from Ruby
-	Data_Get_Struct(self, mpz_t, i);
-	
-	// This might be a little faster than the previous method, since only
-	// two classes are present.
-	if (rb_obj_class(other) == cGMPInteger) {
-		mpz_t *oz;
-		Data_Get_Struct(other, mpz_t, oz);
+// n! = m!^2 * bin(n, m) * (n - m == m ? 1 : m + 1), with m = n / 2, from
+// the bottom up; each level is a checkpoint, and the whole is no slower
+// than mpz_fac_ui
+static void
+z_run_fac( z_kernel *k ) {
+	unsigned long n = k->n;
+	int levels = 0;
+	while ((n >> levels) >= FAC_CHUNK_BASE)
+		levels++;
+	
+	mpz_fac_ui(k->r, n >> levels);
+	while (levels-- > 0) {
+		unsigned long level = n >> levels, m = level / 2;
 		
-		mpz_init(*r);
-		mpz_and(*r, *i, *oz);
-	} else if (FIXNUM_P(other)) {
-		// GMP's logic operators only accept mpz_t as arguments, therefore
-		// we have to create a temporary mpz_t to hold 'other'.
-		signed long ol = FIX2LONG(other);
-		mpz_t olz;
-		mpz_init_set_si(olz, ol);
+		if (rgmp_poll(&k->cp))
+			return;
+		mpz_bin_uiui(k->t, level, m);
 		
-		mpz_init(*r);
-		mpz_and(*r, *i, olz);
-		mpz_clear(olz);
+		if (rgmp_poll(&k->cp))
+			return;
+		mpz_mul(k->r, k->r, k->r);
+		if (level - m != m)
+			mpz_mul_ui(k->r, k->r, m + 1);
+		mpz_mul(k->r, k->r, k->t);
 	}
-	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
 }
 
-// Logic OR (inclusive OR) (|)
-// {GMP::Integer, Fixnum} -> {GMP::Integer}
-VALUE
-z_logic_ior( VALUE self, VALUE other ) {
-	// Creates pointers to self's and result's mpz_t structures
-	mpz_t *r = malloc(sizeof(*r));
-	mpz_t *i;
-	
-	// Loads self from Ruby
-	Data_Get_Struct(self, mpz_t, i);
-	
-	// This might be a little faster than the previous method, since only
-	// two classes are present.
-	if (rb_obj_class(other) == cGMPInteger) {
-		mpz_t *oz;
-		Data_Get_Struct(other, mpz_t, oz);
+// Leaves F(n) in k->r and F(n-1) in k->a, doubling the index one bit at a
+// time (the way mpz_fib2_ui does it) and checkpointing in between:
+//   F(2j+1) = 4F(j)^2 - F(j-1)^2 + 2(-1)^j
+//   F(2j-1) = F(j)^2 + F(j-1)^2
+//   F(2j)   = F(2j+1) - F(2j-1)
+static void
+z_fib2_chunked( z_kernel *k ) {
+	unsigned long n = k->n;
+	int bits = 0;
+	while ((n >> bits) >= FIB_CHUNK_BASE)
+		bits++;
+	
+	mpz_fib2_ui(k->r, k->a, n >> bits);
+	while (bits-- > 0) {
+		unsigned long j = n >> (bits + 1);
 		
-		mpz_init(*r);
-		mpz_ior(*r, *i, *oz);
-	} else if (FIXNUM_P(other)) {
-		// GMP's logic operators only accept mpz_t as arguments, therefore
-		// we have to create a temporary mpz_t to hold 'other'.
-		signed long ol = FIX2LONG(other);
-		mpz_t olz;
-		mpz_init_set_si(olz, ol);
+		if (rgmp_poll(&k->cp))
+			return;
 		
-		mpz_init(*r);
-		mpz_ior(*r, *i, olz);
-		mpz_clear(olz);
+		mpz_mul(k->t, k->r, k->r);
+		mpz_mul(k->u, k->a, k->a);
+		
+		// k->r = F(2j+1), k->a = F(2j-1)
+		mpz_mul_2exp(k->r, k->t, 2);
+		mpz_sub(k->r, k->r, k->u);
+		if (j & 1)
+			mpz_sub_ui(k->r, k->r, 2);
+		else
+			mpz_add_ui(k->r, k->r, 2);
+		mpz_add(k->a, k->t, k->u);
+		
+		// Index 2j+1 keeps F(2j+1) and F(2j), index 2j F(2j) and F(2j-1)
+		if ((n >> bits) & 1)
+			mpz_sub(k->a, k->r, k->a);
+		else
+			mpz_sub(k->r, k->r, k->a);
 	}
-	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
 }
 
-// Logic XOR (exclusive OR) (^)
-// {GMP::Integer, Fixnum} -> {GMP::Integer}
-VALUE 
-z_logic_xor( VALUE self, VALUE other ) {
-	// Creates pointers to self's and result's mpz_t structures
-	mpz_t *r = malloc(sizeof(*r));
-	mpz_t *i;
-	
-	// Loads self from Ruby
-	Data_Get_Struct(self, mpz_t, i);
+static void
+z_run_fib( z_kernel *k ) {
+	z_fib2_chunked(k);
+}
+
+// L(n) = F(n) + 2F(n-1)
+static void
+z_run_lucnum( z_kernel *k ) {
+	z_fib2_chunked(k);
+	if (!rgmp_stopped(&k->cp))
+		mpz_addmul_ui(k->r, k->a, 2);
+}
+
+static void
+z_run_bin( z_kernel *k ) {
+	mpz_bin_ui(k->r, k->a, k->k);
+}
+
+static void
+z_run_bin_uiui( z_kernel *k ) {
+	mpz_bin_uiui(k->r, k->n, k->k);
+}
+
+// r = i OP o through the operator's mpz_t entry, without the GVL if big
+static void
+z_apply_zz( mpz_ptr r, mpz_srcptr i, mpz_srcptr o, const z_operator *op ) {
+	if (op->zz_work == NULL || !RGMP_NOGVL(op->zz_work(i, o))) {
+		op->zz(r, i, o);
+		return;
+	}
 	
-	// This might be a little faster than the previous method, since only
-	// two classes are present.
-	if (rb_obj_class(other) == cGMPInteger) {
-		mpz_t *oz;
-		Data_Get_Struct(other, mpz_t, oz);
-		
-		mpz_init(*r);
-		mpz_xor(*r, *i, *oz);
-	} else if (FIXNUM_P(other)) {
-		// GMP's logic operators only accept mpz_t as arguments, therefore
-		// we have to create a temporary mpz_t to hold 'other'.
-		signed long ol = FIX2LONG(other);
-		mpz_t olz;
-		mpz_init_set_si(olz, ol);
-		
-		mpz_init(*r);
-		mpz_xor(*r, *i, olz);
-		mpz_clear(olz);
+	z_kernel k;
+	z_kernel_init(&k, z_run_zz);
+	k.op = op;
+	mpz_set(k.a, i);
+	mpz_set(k.b, o);
+	RGMP_COUNT(STAT_TEMPORARIES, 2);
+	z_kernel_call(&k, r);
+}
+
+// r = i OP l through the operator's Fixnum entry, without the GVL if big
+static void
+z_apply_zl( mpz_ptr r, mpz_srcptr i, long l, const z_operator *op ) {
+	if (op->zl_work == NULL || !RGMP_NOGVL(op->zl_work(i, l))) {
+		op->zl(r, i, l);
+		return;
 	}
 	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
+	z_kernel k;
+	z_kernel_init(&k, z_run_zl);
+	k.op = op;
+	k.l = l;
+	mpz_set(k.a, i);
+	RGMP_COUNT(STAT_TEMPORARIES, 1);
+	z_kernel_call(&k, r);
 }
 
-// Logic NOT (~)
-// {GMP::Integer} -> {GMP::Integer}
-VALUE
-z_logic_not( VALUE self ) {
-	// Creates pointers to self's and the result's mpz_t structures
-	mpz_t *r = malloc(sizeof(*r));
-	mpz_t *i;
+// Size estimates (in limbs) of the kernels, for RGMP_NOGVL; zero whenever
+// the kernel would raise
+static size_t
+z_operands_work( mpz_srcptr a, mpz_srcptr b ) {
+	return mpz_size(a) + mpz_size(b);
+}
+
+static size_t
+z_division_work( mpz_srcptr a, mpz_srcptr d ) {
+	return (mpz_sgn(d) == 0) ? 0 : mpz_size(a);
+}
+
+static size_t
+z_pow_work( mpz_srcptr a, mpz_srcptr e ) {
+	if (mpz_sgn(e) < 0 || !mpz_fits_ulong_p(e))
+		return 0;
+	return work_product(mpz_size(a), mpz_get_ui(e));
+}
+
+static size_t
+z_pow_long_work( mpz_srcptr a, long l ) {
+	return (l < 0) ? 0 : work_product(mpz_size(a), l);
+}
+
+// n! has about n*log2(n) bits
+static size_t
+z_factorial_work( unsigned long n ) {
+	unsigned long bits = 0;
+	while ((n >> bits) != 0)
+		bits++;
+	return work_product(n, bits) / GMP_NUMB_BITS;
+}
+//// end of kernels run without the GVL
+////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////
+//// Parallel multiplication
+// Toom-3 on top of mpz_mul: each operand is split into three pieces of s
+// limbs, x = x2*X^2 + x1*X + x0 with X = 2^(s*GMP_NUMB_BITS), and the
+// product polynomial is recovered from its values at 0, 1, -1, -2 and
+// infinity. Those five pointwise products are independent, so they run on
+// separate threads; applying the split again to each of them gives 25 (or
+// 125) products for more threads. Evaluation and interpolation are linear,
+// and stay on the calling thread.
+#define TOOM3_POINTS 5
+#define TOOM3_MAX_DEPTH 3
+// Smallest pieces worth another level of splitting, in limbs
+#define TOOM3_MIN_PIECE 4096
+
+typedef struct z_mul_node z_mul_node;
+struct z_mul_node {
+	mpz_t a, b, r;
+	size_t s;				// limbs per piece
+	z_mul_node *child;		// TOOM3_POINTS children, or NULL for a leaf
+};
+
+typedef struct {
+	z_mul_node *nodes;		// every node, breadth-first; nodes[0] is the root
+	z_mul_node **leaves;
+	size_t node_count, leaf_count;
+} z_mul_tree;
+
+// Evaluates x = x2*X^2 + x1*X + x0 at 0, 1, -1, -2 and infinity, into the
+// children's a (or b) field (Bodrato's sequence)
+static void
+toom3_evaluate( z_mul_node *child, size_t offset, mpz_srcptr x, size_t s ) {
+	mpz_t x0, x1, x2;
+	mpz_ptr p0 = (mpz_ptr) ((char *) &child[0] + offset);
+	mpz_ptr p1 = (mpz_ptr) ((char *) &child[1] + offset);
+	mpz_ptr pm1 = (mpz_ptr) ((char *) &child[2] + offset);
+	mpz_ptr pm2 = (mpz_ptr) ((char *) &child[3] + offset);
+	mpz_ptr pinf = (mpz_ptr) ((char *) &child[4] + offset);
+	
+	mpz_inits(x0, x1, x2, NULL);
+	mpz_tdiv_r_2exp(x0, x, s * GMP_NUMB_BITS);
+	mpz_tdiv_q_2exp(x1, x, s * GMP_NUMB_BITS);
+	mpz_tdiv_q_2exp(x2, x1, s * GMP_NUMB_BITS);
+	mpz_tdiv_r_2exp(x1, x1, s * GMP_NUMB_BITS);
+	
+	mpz_add(p1, x0, x2);
+	mpz_sub(pm1, p1, x1);
+	mpz_add(p1, p1, x1);
+	mpz_add(pm2, pm1, x2);
+	mpz_mul_2exp(pm2, pm2, 1);
+	mpz_sub(pm2, pm2, x0);
+	mpz_swap(p0, x0);
+	mpz_swap(pinf, x2);
+	
+	mpz_clears(x0, x1, x2, NULL);
+}
+
+// Recombines the children's products into node->r, reusing their storage
+static void
+toom3_interpolate( z_mul_node *node ) {
+	z_mul_node *c = node->child;
+	mp_bitcnt_t bits = node->s * GMP_NUMB_BITS;
+	mpz_ptr r0 = c[0].r, r1 = c[1].r, r2 = c[2].r, r3 = c[3].r, r4 = c[4].r;
+	
+	// r(-2), r(1), r(-1) become the middle coefficients
+	mpz_sub(r3, r3, r1);
+	mpz_divexact_ui(r3, r3, 3);
+	mpz_sub(r1, r1, r2);
+	mpz_divexact_ui(r1, r1, 2);
+	mpz_sub(r2, r2, r0);
+	mpz_sub(r3, r2, r3);
+	mpz_divexact_ui(r3, r3, 2);
+	mpz_addmul_ui(r3, r4, 2);
+	mpz_add(r2, r2, r1);
+	mpz_sub(r2, r2, r4);
+	mpz_sub(r1, r1, r3);
+	
+	// node->r = r4*X^4 + r3*X^3 + r2*X^2 + r1*X + r0, by Horner's rule
+	mpz_swap(node->r, r4);
+	mpz_mul_2exp(node->r, node->r, bits);
+	mpz_add(node->r, node->r, r3);
+	mpz_mul_2exp(node->r, node->r, bits);
+	mpz_add(node->r, node->r, r2);
+	mpz_mul_2exp(node->r, node->r, bits);
+	mpz_add(node->r, node->r, r1);
+	mpz_mul_2exp(node->r, node->r, bits);
+	mpz_add(node->r, node->r, r0);
+}
+
+static void
+z_mul_leaf( void *data, size_t i ) {
+	z_mul_tree *tree = data;
+	z_mul_node *leaf = tree->leaves[i];
+	mpz_mul(leaf->r, leaf->a, leaf->b);
+	mpz_clear(leaf->a);
+	mpz_clear(leaf->b);
+	mpz_init(leaf->a);
+	mpz_init(leaf->b);
+}
+
+// Splitting depth giving at least one product per thread, without pieces
+// smaller than TOOM3_MIN_PIECE limbs
+static int
+z_mul_depth( size_t limbs, unsigned threads ) {
+	int depth = 0;
+	size_t products = 1;
+	while (depth < TOOM3_MAX_DEPTH && products < threads && limbs / 3 >= TOOM3_MIN_PIECE) {
+		depth++;
+		products *= TOOM3_POINTS;
+		limbs /= 3;
+	}
+	return depth;
+}
+
+// r = a * b on up to threads threads; called without the GVL, r must not
+// alias a or b
+void
+z_mul_parallel( mpz_ptr r, mpz_srcptr a, mpz_srcptr b, unsigned threads, rgmp_checkpoint *cp ) {
+	size_t limbs = (mpz_size(a) > mpz_size(b)) ? mpz_size(a) : mpz_size(b);
+	int depth = z_mul_depth(limbs, threads);
+	if (depth == 0 || threads < 2) {
+		mpz_mul(r, a, b);
+		return;
+	}
 	
-	// Loads self into *i
-	Data_Get_Struct(self, mpz_t, i);
+	// (5^(depth+1) - 1) / 4 nodes, of which 5^depth leaves
+	z_mul_tree tree = { NULL, NULL, 1, 1 };
+	for (int d = 0; d < depth; d++) {
+		tree.leaf_count *= TOOM3_POINTS;
+		tree.node_count += tree.leaf_count;
+	}
+	tree.nodes = malloc(tree.node_count * sizeof(z_mul_node));
+	tree.leaves = malloc(tree.leaf_count * sizeof(z_mul_node *));
+	if (tree.nodes == NULL || tree.leaves == NULL) {
+		free(tree.nodes);
+		free(tree.leaves);
+		mpz_mul(r, a, b);
+		return;
+	}
+	for (size_t i = 0; i < tree.node_count; i++) {
+		mpz_inits(tree.nodes[i].a, tree.nodes[i].b, tree.nodes[i].r, NULL);
+		tree.nodes[i].child = NULL;
+	}
 	
-	// Inits the result
-	mpz_init(*r);
+	// Splits level by level; node i's children are nodes 5i+1 to 5i+5
+	mpz_abs(tree.nodes[0].a, a);
+	mpz_abs(tree.nodes[0].b, b);
+	size_t inner = tree.node_count - tree.leaf_count;
+	for (size_t i = 0; i < inner; i++) {
+		z_mul_node *node = &tree.nodes[i];
+		size_t size = (mpz_size(node->a) > mpz_size(node->b)) ? mpz_size(node->a) : mpz_size(node->b);
+		node->s = (size + 2) / 3;
+		node->child = &tree.nodes[TOOM3_POINTS * i + 1];
+		toom3_evaluate(node->child, offsetof(z_mul_node, a), node->a, node->s);
+		toom3_evaluate(node->child, offsetof(z_mul_node, b), node->b, node->s);
+		mpz_clears(node->a, node->b, NULL);
+		mpz_inits(node->a, node->b, NULL);
+	}
+	for (size_t i = 0; i < tree.leaf_count; i++)
+		tree.leaves[i] = &tree.nodes[inner + i];
 	
-	// Sets result as the one's complement of self
-	mpz_com(*r, *i);
+	rgmp_parallel_for(tree.leaf_count, threads, z_mul_leaf, &tree, cp);
 	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
+	if (!rgmp_stopped(cp)) {
+		for (size_t i = inner; i-- > 0; )
+			toom3_interpolate(&tree.nodes[i]);
+		mpz_swap(r, tree.nodes[0].r);
+		if (mpz_sgn(a) * mpz_sgn(b) < 0)
+			mpz_neg(r, r);
+	}
+	
+	for (size_t i = 0; i < tree.node_count; i++)
+		mpz_clears(tree.nodes[i].a, tree.nodes[i].b, tree.nodes[i].r, NULL);
+	free(tree.nodes);
+	free(tree.leaves);
 }
-//// end of logic manipulation methods
+
+// Checkpointed form of mpz_mul, for the * operator (see z_mul_op)
+static void
+z_mul_chunked( mpz_ptr r, mpz_srcptr a, mpz_srcptr b, rgmp_checkpoint *cp ) {
+	size_t smaller = (mpz_size(a) < mpz_size(b)) ? mpz_size(a) : mpz_size(b);
+	if (smaller >= parallel_threshold)
+		z_mul_parallel(r, a, b, rgmp_threads, cp);
+	else
+		mpz_mul(r, a, b);
+}
+
+static void
+z_run_parallel_mul( z_kernel *k ) {
+	z_mul_parallel(k->r, k->a, k->b, k->threads, &k->cp);
+}
+//// end of parallel multiplication
 ////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////
-//// Comparison methods
-// Equality (==)
-// {GMP::Integer} -> {TrueClass, FalseClass}
-VALUE
-z_equality_test( VALUE self, VALUE other ) {
-	// Creates a mpz_t pointer and loads self in it
-	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
+//// Parallel combinatorics
+// n!, bin(n, k) and primorials as products of prime powers, prod p^e(p),
+// for every prime p <= n. Writing each exponent in binary,
+//   prod p^e(p) = P_0 * (P_1 * (P_2 * ...)^2)^2
+// where P_i is the product of the primes whose exponent has bit i set
+// (for n!, P_0 alone holds about half the bits). The P_i are balanced
+// product trees, built on worker threads (chunks of primes, then pairs of
+// partial products level by level), and the final squarings and products
+// go through z_mul_parallel. The powers of 2 are a final shift.
+//
+// Primes come from a plain bit sieve over the odd numbers, so n is capped
+// at Z_SIEVE_LIMIT (a 256MB sieve and a 800MB prime table at the cap).
+#define Z_SIEVE_LIMIT 0xFFFFFFFFUL
+// Primes per leaf product, at least
+#define Z_PRODUCT_CHUNK 64
+
+// Every prime up to n (malloc'ed, NULL when out of memory)
+static uint32_t *
+z_sieve( unsigned long n, size_t *count ) {
+	*count = 0;
+	if (n < 2)
+		return malloc(sizeof(uint32_t));
+	
+	// Bit i stands for 2i+1, set when composite
+	size_t m = (n - 1) / 2;
+	unsigned char *composite = calloc(m / 8 + 1, 1);
+	if (composite == NULL)
+		return NULL;
+	
+	for (size_t i = 1; (2 * i + 1) * (2 * i + 1) <= n; i++) {
+		if (composite[i >> 3] & (1 << (i & 7)))
+			continue;
+		size_t p = 2 * i + 1;
+		for (size_t j = (p * p - 1) / 2; j <= m; j += p)
+			composite[j >> 3] |= 1 << (j & 7);
+	}
 	
-	// Immediate responses to avoid one object creation
-	switch (TYPE(other)) {
-		case T_DATA: {
-			if (rb_obj_class(other) == cGMPInteger) {
-				mpz_t *od;
-				Data_Get_Struct(other, mpz_t, od);
-				
-				if (mpz_cmp(*i, *od) == 0)
-					return Qtrue;
-				else
-					return Qfalse;
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
+	size_t primes = 1;
+	for (size_t i = 1; i <= m; i++)
+		primes += !(composite[i >> 3] & (1 << (i & 7)));
+	
+	uint32_t *list = malloc(primes * sizeof(uint32_t));
+	if (list != NULL) {
+		list[(*count)++] = 2;
+		for (size_t i = 1; i <= m; i++)
+			if (!(composite[i >> 3] & (1 << (i & 7))))
+				list[(*count)++] = (uint32_t) (2 * i + 1);
+	}
+	
+	free(composite);
+	return list;
+}
+
+// r = f[0] * ... * f[n - 1], as a balanced tree over word-sized products
+static void
+z_ulong_product( mpz_ptr r, const uint32_t *f, size_t n ) {
+	if (n <= 32) {
+		unsigned long word = 1;
+		mpz_set_ui(r, 1);
+		for (size_t i = 0; i < n; i++) {
+			if (word > ULONG_MAX / f[i]) {
+				mpz_mul_ui(r, r, word);
+				word = 1;
 			}
-			break;
+			word *= f[i];
 		}
-		case T_FIXNUM: {
-			signed long ol = FIX2LONG(other);
-			
-			if (mpz_cmp_si(*i, ol) == 0)
-				return Qtrue;
-			else
-				return Qfalse;
-			
-			break;
+		mpz_mul_ui(r, r, word);
+		return;
+	}
+	
+	mpz_t t;
+	mpz_init(t);
+	z_ulong_product(r, f, n / 2);
+	z_ulong_product(t, f + n / 2, n - n / 2);
+	mpz_mul(r, r, t);
+	mpz_clear(t);
+}
+
+typedef struct {
+	mpz_t *items;
+	size_t n, half;
+	unsigned threads;		// for each pair
+	rgmp_checkpoint *cp;
+} z_product_level;
+
+static void
+z_product_pair( void *data, size_t i ) {
+	z_product_level *level = data;
+	mpz_ptr a = level->items[i], b = level->items[level->half + i];
+	mpz_t t;
+	
+	// The product of all items stays the same whether or not this pair
+	// gets done, so a stopped tree can be run again as is
+	mpz_init(t);
+	z_mul_parallel(t, a, b, level->threads, level->cp);
+	if (!rgmp_stopped(level->cp)) {
+		mpz_swap(a, t);
+		mpz_set_ui(b, 1);
+	}
+	mpz_clear(t);
+}
+
+// items[0] = items[0] * ... * items[n - 1], multiplying pairs level by
+// level; while there are fewer pairs than threads, each pair gets the
+// spare threads for z_mul_parallel
+static void
+z_product_parallel( mpz_t *items, size_t n, unsigned threads, rgmp_checkpoint *cp ) {
+	while (n > 1 && !rgmp_poll(cp)) {
+		z_product_level level = { items, n, (n + 1) / 2, 1, cp };
+		size_t pairs = n / 2;
+		if (pairs < threads)
+			level.threads = threads / pairs;
+		
+		rgmp_parallel_for(pairs, threads, z_product_pair, &level, cp);
+		n = level.half;
+	}
+}
+
+// Exponent of p in n! (Legendre's formula)
+static unsigned long
+legendre( unsigned long n, unsigned long p ) {
+	unsigned long e = 0;
+	while (n >= p) {
+		n /= p;
+		e += n;
+	}
+	return e;
+}
+
+static unsigned long
+z_factorial_exponent( const z_kernel *k, unsigned long p ) {
+	return legendre(k->n, p);
+}
+
+static unsigned long
+z_binomial_exponent( const z_kernel *k, unsigned long p ) {
+	return legendre(k->n, p) - legendre(k->k, p) - legendre(k->n - k->k, p);
+}
+
+static unsigned long
+z_primorial_exponent( const z_kernel *k, unsigned long p ) {
+	return 1;
+}
+
+typedef struct {
+	const uint32_t *factors;	// primes grouped by exponent bit
+	size_t *start, *length;		// of each chunk in factors
+	mpz_t *products;			// one per chunk
+} z_chunks;
+
+static void
+z_chunk_product( void *data, size_t i ) {
+	z_chunks *chunks = data;
+	z_ulong_product(chunks->products[i], chunks->factors + chunks->start[i], chunks->length[i]);
+}
+
+// k->r = prod p^exponent(p) over the primes p <= k->n
+static void
+z_prime_power_product( z_kernel *k, unsigned long (*exponent)(const z_kernel *, unsigned long) ) {
+	size_t count, total = 0, chunk_count = 0;
+	size_t per_bit[64] = { 0 }, offset[64], first_chunk[65];
+	unsigned long twos = 0;
+	int bits = 0;
+	
+	uint32_t *primes = z_sieve(k->n, &count);
+	if (primes == NULL) {
+		k->nomem = 1;
+		return;
+	}
+	
+	// Groups the odd primes by the bits set in their exponents
+	for (size_t i = 0; i < count; i++) {
+		unsigned long e = exponent(k, primes[i]);
+		if (primes[i] == 2) {
+			twos = e;
+			continue;
 		}
-		case T_BIGNUM: {
-			mpz_t tempOb;
-			VALUE str = rb_big2str(other, 10);
-			mpz_init_set_str(tempOb, StringValuePtr(str), 10);
-			
-			if (mpz_cmp(*i, tempOb) == 0) {
-				mpz_clear(tempOb);
-				return Qtrue;
-			} else {
-				mpz_clear(tempOb);
-				return Qfalse;
+		for (int b = 0; e != 0; b++, e >>= 1) {
+			if (e & 1) {
+				per_bit[b]++;
+				total++;
+				if (b + 1 > bits)
+					bits = b + 1;
 			}
-			
-			break;
 		}
-		default: {
-			rb_raise(rb_eTypeError, "input data type not supported");
+	}
+	
+	// Chunks small enough to keep every thread busy
+	size_t chunk = total / (4 * (size_t) k->threads);
+	if (chunk < Z_PRODUCT_CHUNK)
+		chunk = Z_PRODUCT_CHUNK;
+	for (int b = 0; b < bits; b++) {
+		offset[b] = (b == 0) ? 0 : offset[b - 1] + per_bit[b - 1];
+		first_chunk[b] = chunk_count;
+		chunk_count += (per_bit[b] + chunk - 1) / chunk;
+	}
+	first_chunk[bits] = chunk_count;
+	
+	z_chunks chunks;
+	uint32_t *factors = malloc((total + 1) * sizeof(uint32_t));
+	chunks.factors = factors;
+	chunks.start = malloc((chunk_count + 1) * sizeof(size_t));
+	chunks.length = malloc((chunk_count + 1) * sizeof(size_t));
+	chunks.products = malloc((chunk_count + 1) * sizeof(mpz_t));
+	if (factors == NULL || chunks.start == NULL || chunks.length == NULL || chunks.products == NULL) {
+		k->nomem = 1;
+		goto cleanup;
+	}
+	
+	size_t fill[64];
+	for (int b = 0; b < bits; b++)
+		fill[b] = offset[b];
+	for (size_t i = 0; i < count; i++) {
+		if (primes[i] == 2)
+			continue;
+		unsigned long e = exponent(k, primes[i]);
+		for (int b = 0; e != 0; b++, e >>= 1)
+			if (e & 1)
+				factors[fill[b]++] = primes[i];
+	}
+	for (int b = 0; b < bits; b++) {
+		for (size_t c = first_chunk[b]; c < first_chunk[b + 1]; c++) {
+			chunks.start[c] = offset[b] + (c - first_chunk[b]) * chunk;
+			chunks.length[c] = offset[b] + per_bit[b] - chunks.start[c];
+			if (chunks.length[c] > chunk)
+				chunks.length[c] = chunk;
 		}
 	}
+	for (size_t c = 0; c < chunk_count; c++)
+		mpz_init(chunks.products[c]);
+	
+	rgmp_parallel_for(chunk_count, k->threads, z_chunk_product, &chunks, &k->cp);
+	
+	// Horner's rule over the exponent bits, from the most significant one
+	mpz_set_ui(k->r, 1);
+	for (int b = bits - 1; b >= 0 && !rgmp_poll(&k->cp); b--) {
+		if (mpz_cmp_ui(k->r, 1) != 0) {
+			z_mul_parallel(k->t, k->r, k->r, k->threads, &k->cp);
+			mpz_swap(k->r, k->t);
+		}
+		
+		size_t n = first_chunk[b + 1] - first_chunk[b];
+		if (n == 0)
+			continue;
+		z_product_parallel(chunks.products + first_chunk[b], n, k->threads, &k->cp);
+		z_mul_parallel(k->t, k->r, chunks.products[first_chunk[b]], k->threads, &k->cp);
+		mpz_swap(k->r, k->t);
+	}
+	mpz_mul_2exp(k->r, k->r, twos);
 	
-	// I'm guessing no compilers will complain about the lack of this?
-	// Anyhow, just in case...
-	return Qfalse;
+	for (size_t c = 0; c < chunk_count; c++)
+		mpz_clear(chunks.products[c]);
+
+cleanup:
+	free(primes);
+	free(factors);
+	free(chunks.start);
+	free(chunks.length);
+	free(chunks.products);
 }
 
-// Greater than (>)
-// {GMP::Integer} -> {TrueClass, FalseClass}
-VALUE
-z_greater_than_test( VALUE self, VALUE other ) {
-	// Creates a mpz_t pointer and loads self in it
-	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
+static void
+z_run_fac_parallel( z_kernel *k ) {
+	z_prime_power_product(k, z_factorial_exponent);
+}
+
+static void
+z_run_bin_parallel( z_kernel *k ) {
+	z_prime_power_product(k, z_binomial_exponent);
+}
+
+static void
+z_run_primorial_parallel( z_kernel *k ) {
+	z_prime_power_product(k, z_primorial_exponent);
+}
+
+static void
+z_run_primorial( z_kernel *k ) {
+	mpz_primorial_ui(k->r, k->n);
+}
+
+static void
+z_run_product( z_kernel *k ) {
+	z_product_parallel(k->items, k->count, k->threads, &k->cp);
+	if (!rgmp_stopped(&k->cp))
+		mpz_swap(k->r, k->items[0]);
+}
+
+// r = items[0] * ... * items[n - 1], as a balanced product tree, on the
+// given number of threads (0 picks GMP.threads when the operands reach
+// GMP.parallel_threshold limbs, 1 otherwise). The items must be private
+// copies: they are multiplied into each other in place.
+void
+z_product_tree( mpz_ptr r, mpz_t *items, size_t n, unsigned threads ) {
+	if (n == 0) {
+		mpz_set_ui(r, 1);
+		return;
+	}
 	
-	// Immediate responses to avoid one object creation
-	switch (TYPE(other)) {
-		case T_DATA: {
-			if (rb_obj_class(other) == cGMPInteger) {
-				mpz_t *od;
-				Data_Get_Struct(other, mpz_t, od);
-				
-				if (mpz_cmp(*i, *od) > 0)
-					return Qtrue;
-				else
-					return Qfalse;
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
-			break;
+	size_t work = 0;
+	for (size_t i = 0; i < n; i++)
+		work += mpz_size(items[i]);
+	if (threads == 0)
+		threads = (work >= parallel_threshold) ? rgmp_threads : 1;
+	
+	if (threads == 1 && !RGMP_NOGVL(work)) {
+		rgmp_checkpoint cp = { 0 };
+		z_product_parallel(items, n, 1, &cp);
+		mpz_swap(r, items[0]);
+		return;
+	}
+	
+	z_kernel k;
+	z_kernel_init(&k, z_run_product);
+	k.items = items;
+	k.count = n;
+	k.threads = threads;
+	z_kernel_call(&k, r);
+}
+//// end of parallel combinatorics
+////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////
+//// Product and remainder trees
+// A product tree over n leaves: level 0 is the leaves themselves, and level
+// h + 1 holds the products of the pairs of level h (an odd last node is
+// carried up as is), up to the root. Going back down, every node reduces
+// its parent's remainder, so that x is reduced modulo all the leaves for
+// about the cost of a few multiplications of x's size. The tree types are
+// declared in rgmp.h, as GMP::CRTBasis (gmpcrt.c) builds on them.
+
+static void
+z_tree_product_task( void *data, size_t i ) {
+	z_tree_step *s = data;
+	if (2 * i + 1 < s->below_count)
+		z_mul_parallel(s->above[i], s->below[2 * i], s->below[2 * i + 1], s->threads, s->cp);
+	else
+		mpz_set(s->above[i], s->below[2 * i]);
+}
+
+static void
+z_tree_remainder_task( void *data, size_t i ) {
+	z_tree_step *s = data;
+	mpz_srcptr x = s->above[i / 2], m = s->below[i];
+	
+	// Remainders already smaller than the node (e.g. the root's own
+	// remainder in a batch gcd) need no division, nor m^2
+	if (mpz_cmp(x, m) < 0 || (s->square && mpz_cmp(x, m) == 0 && mpz_cmp_ui(m, 1) != 0)) {
+		mpz_set(s->out[i], x);
+	} else if (s->square) {
+		mpz_t square;
+		mpz_init(square);
+		z_mul_parallel(square, m, m, s->threads, s->cp);
+		if (!rgmp_stopped(s->cp))
+			mpz_tdiv_r(s->out[i], x, square);
+		mpz_clear(square);
+	} else {
+		mpz_tdiv_r(s->out[i], x, m);
+	}
+}
+
+void
+z_tree_clear_nodes( mpz_t *nodes, size_t count ) {
+	for (size_t i = 0; i < count; i++)
+		mpz_clear(nodes[i]);
+	free(nodes);
+}
+
+// Frees every level above the leaves, which belong to the caller
+void
+z_tree_free( z_tree *T ) {
+	for (int h = 1; h < T->height; h++) {
+		z_tree_level *L = &T->level[h];
+		if (L->nodes != NULL)
+			z_tree_clear_nodes(L->nodes, L->count);
+		if (L->spill != NULL)
+			fclose(L->spill);
+		L->nodes = NULL;
+		L->spill = NULL;
+	}
+	T->height = 0;
+}
+
+// Moves a level's nodes out to an already unlinked file in dir
+static int
+z_tree_spill( z_tree_level *L, const char *dir ) {
+	size_t length = strlen(dir) + sizeof("/rgmp-tree-XXXXXX");
+	char *path = malloc(length);
+	if (path == NULL)
+		return ENOMEM;
+	snprintf(path, length, "%s/rgmp-tree-XXXXXX", dir);
+	
+	int fd = mkstemp(path), error = (fd < 0) ? errno : 0;
+	if (fd >= 0)
+		unlink(path);
+	free(path);
+	if (error)
+		return error;
+	
+	FILE *f = fdopen(fd, "w+b");
+	if (f == NULL) {
+		error = errno;
+		close(fd);
+		return error;
+	}
+	
+	for (size_t i = 0; i < L->count && !error; i++) {
+		size_t size = mpz_size(L->nodes[i]);
+		if (fwrite(&size, sizeof(size), 1, f) != 1
+				|| fwrite(mpz_limbs_read(L->nodes[i]), sizeof(mp_limb_t), size, f) != size)
+			error = errno ? errno : EIO;
+	}
+	if (!error && fflush(f) != 0)
+		error = errno ? errno : EIO;
+	if (error) {
+		fclose(f);
+		return error;
+	}
+	
+	z_tree_clear_nodes(L->nodes, L->count);
+	L->nodes = NULL;
+	L->spill = f;
+	return 0;
+}
+
+// Reads a spilled level back in
+static int
+z_tree_unspill( z_tree_level *L ) {
+	mpz_t *nodes = malloc(L->count * sizeof(mpz_t));
+	if (nodes == NULL)
+		return ENOMEM;
+	for (size_t i = 0; i < L->count; i++)
+		mpz_init(nodes[i]);
+	
+	int error = 0;
+	rewind(L->spill);
+	for (size_t i = 0; i < L->count && !error; i++) {
+		size_t size;
+		if (fread(&size, sizeof(size), 1, L->spill) != 1
+				|| fread(mpz_limbs_write(nodes[i], size ? size : 1), sizeof(mp_limb_t), size, L->spill) != size)
+			error = ferror(L->spill) ? (errno ? errno : EIO) : EIO;
+		else
+			mpz_limbs_finish(nodes[i], size);
+	}
+	if (error) {
+		z_tree_clear_nodes(nodes, L->count);
+		return error;
+	}
+	
+	fclose(L->spill);
+	L->spill = NULL;
+	L->nodes = nodes;
+	return 0;
+}
+
+// Builds the tree over the n >= 1 leaves, spilling each level but the
+// leaves and the root once the next one is done (when T->spill is set).
+// Anything built before is freed first, so that a stopped build can simply
+// be run again.
+void
+z_tree_build( z_tree *T, mpz_t *leaves, size_t n ) {
+	z_tree_free(T);
+	T->level[0].nodes = leaves;
+	T->level[0].count = n;
+	T->level[0].spill = NULL;
+	T->height = 1;
+	
+	while (T->level[T->height - 1].count > 1) {
+		z_tree_level *below = &T->level[T->height - 1], *above = &T->level[T->height];
+		size_t count = (below->count + 1) / 2;
+		
+		above->spill = NULL;
+		above->nodes = malloc(count * sizeof(mpz_t));
+		if (above->nodes == NULL) {
+			T->error = ENOMEM;
+			return;
 		}
-		case T_FIXNUM: {
-			signed long ol = FIX2LONG(other);
-			if (mpz_cmp_si(*i, ol) > 0)
-				return Qtrue;
-			else
-				return Qfalse;
+		for (size_t i = 0; i < count; i++)
+			mpz_init(above->nodes[i]);
+		above->count = count;
+		T->height++;
+		
+		z_tree_step s = { below->nodes, above->nodes, NULL, below->count,
+				(count < T->threads) ? T->threads / count : 1, 0, T->cp };
+		rgmp_parallel_for(count, T->threads, z_tree_product_task, &s, T->cp);
+		if (rgmp_stopped(T->cp))
+			return;
+		
+		if (T->spill != NULL && T->height > 2 && (T->error = z_tree_spill(below, T->spill)))
+			return;
+	}
+}
+
+// out[i] = x mod leaf i (or leaf i squared), for x >= 0, from the root down.
+// Spilled levels are read back one at a time and freed once used.
+void
+z_tree_remainders( z_tree *T, mpz_srcptr x, mpz_t *out, int square ) {
+	mpz_t root;
+	mpz_t *above = &root;
+	size_t above_count = 0;		// remainders to free (none for the root)
+	mpz_roinit_n(root, mpz_limbs_read(x), mpz_size(x));
+	
+	for (int h = T->height - 1; h >= 0; h--) {
+		z_tree_level *L = &T->level[h];
+		int spilled = (L->spill != NULL);
+		if (spilled && (T->error = z_tree_unspill(L)))
 			break;
-		}
-		case T_BIGNUM: {
-			mpz_t tempOb;
-			VALUE str = rb_big2str(other, 10);
-			mpz_init_set_str(tempOb, StringValuePtr(str), 10);
-			if (mpz_cmp(*i, tempOb) > 0) {
-				mpz_clear(tempOb);
-				return Qtrue;
-			} else {
-				mpz_clear(tempOb);
-				return Qfalse;
+		
+		mpz_t *next = out;
+		if (h > 0) {
+			next = malloc(L->count * sizeof(mpz_t));
+			if (next == NULL) {
+				T->error = ENOMEM;
+				break;
 			}
-			break;
+			for (size_t i = 0; i < L->count; i++)
+				mpz_init(next[i]);
 		}
-		default: {
-			rb_raise(rb_eTypeError, "input data type not supported");
+		
+		z_tree_step s = { L->nodes, above, next, L->count,
+				(L->count < T->threads) ? T->threads / L->count : 1, square, T->cp };
+		rgmp_parallel_for(L->count, T->threads, z_tree_remainder_task, &s, T->cp);
+		
+		if (above_count > 0)
+			z_tree_clear_nodes(above, above_count);
+		above = next;
+		above_count = (h > 0) ? L->count : 0;
+		if (spilled) {
+			z_tree_clear_nodes(L->nodes, L->count);
+			L->nodes = NULL;
 		}
+		if (rgmp_stopped(T->cp))
+			break;
 	}
 	
-	// I'm guessing no compilers will complain about the lack of this?
-	// Anyhow, just in case...
-	return Qfalse;
+	if (above_count > 0)
+		z_tree_clear_nodes(above, above_count);
 }
 
-// Less than (<)
-// {GMP::Integer} -> {TrueClass, FalseClass}
-VALUE
-z_less_than_test( VALUE self, VALUE other ) {
-	// Creates a mpz_t pointer and loads self in it
-	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
+// Runs job(data), a computation over T of the given size in limbs, without
+// the GVL when it is large, parallel or spilling, then raises whatever went
+// wrong. T->threads 0 picks GMP.threads when the work reaches
+// GMP.parallel_threshold, 1 otherwise.
+void
+z_tree_call( z_tree *T, size_t work, void *(*job)(void *), void *data, rgmp_checkpoint *cp ) {
+	if (T->threads == 0)
+		T->threads = (work >= parallel_threshold) ? rgmp_threads : 1;
+	T->cp = cp;
+	
+	if (T->threads > 1 || T->spill != NULL || RGMP_NOGVL(work)) {
+		int state = rgmp_without_gvl(job, data, cp);
+		if (state)
+			rb_jump_tag(state);
+	} else {
+		job(data);
+	}
 	
-	// Immediate responses to avoid one object creation
-	switch (TYPE(other)) {
-		case T_DATA: {
-			if (rb_obj_class(other) == cGMPInteger) {
-				mpz_t *od;
-				Data_Get_Struct(other, mpz_t, od);
-				
-				if (mpz_cmp(*i, *od) < 0)
-					return Qtrue;
-				else
-					return Qfalse;
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
+	if (T->error == ENOMEM)
+		rb_memerror();
+	if (T->error)
+		rb_syserr_fail(T->error, T->spill);
+}
+//// end of product and remainder trees
+////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////
+//// Binary arithmetical operators (operations taking two values)
+// Operand dispatch (see z_operator in rgmp.h)
+// z_apply classifies the operand once and calls the matching entry of the
+// operator, so Fixnum operands never need a temporary mpz_t.
+// r = i OP other (r may be i itself)
+void
+z_apply( mpz_ptr r, mpz_srcptr i, VALUE other, const z_operator *op ) {
+	switch (operand_kind(other)) {
+		case OPERAND_INTEGER: {
+			z_apply_zz(r, i, MPZ_OF(other), op);
 			break;
 		}
-		case T_FIXNUM: {
-			signed long ol = FIX2LONG(other);
-			if (mpz_cmp_si(*i, ol) < 0)
-				return Qtrue;
-			else
-				return Qfalse;
+		case OPERAND_FIXNUM: {
+			z_apply_zl(r, i, FIX2LONG(other), op);
 			break;
 		}
-		case T_BIGNUM: {
-			mpz_t tempOb;
-			VALUE str = rb_big2str(other, 10);
-			mpz_init_set_str(tempOb, StringValuePtr(str), 10);
-			if (mpz_cmp(*i, tempOb) < 0) {
-				mpz_clear(tempOb);
-				return Qtrue;
-			} else {
-				mpz_clear(tempOb);
-				return Qfalse;
-			}
+		case OPERAND_BIGNUM: {
+			if (!op->bignums)
+				rb_raise(rb_eRangeError, "operand too big");
+			
+			mpz_t tempBig;
+			mpz_init(tempBig);
+			RGMP_COUNT(STAT_TEMPORARIES, 1);
+			num2mpz(tempBig, other);
+			z_apply_zz(r, i, tempBig, op);
+			mpz_clear(tempBig);
 			break;
 		}
 		default: {
 			rb_raise(rb_eTypeError, "input data type not supported");
 		}
 	}
+}
+
+// Fixnum versions of the GMP functions that only take unsigned longs
+static void
+z_add_long( mpz_ptr r, mpz_srcptr i, long l ) {
+	if (l >= 0)
+		mpz_add_ui(r, i, l);
+	else
+		mpz_sub_ui(r, i, -(unsigned long) l);
+}
+
+static void
+z_sub_long( mpz_ptr r, mpz_srcptr i, long l ) {
+	if (l >= 0)
+		mpz_sub_ui(r, i, l);
+	else
+		mpz_add_ui(r, i, -(unsigned long) l);
+}
+
+// Floor division, like Ruby's
+static void
+z_div_mpz( mpz_ptr r, mpz_srcptr i, mpz_srcptr d ) {
+	if (mpz_sgn(d) == 0)
+		rb_raise(rb_eZeroDivError, "divided by 0");
+	mpz_fdiv_q(r, i, d);
+}
+
+static void
+z_div_long( mpz_ptr r, mpz_srcptr i, long l ) {
+	if (l == 0)
+		rb_raise(rb_eZeroDivError, "divided by 0");
+	
+	// floor(i / -d) == floor(-i / d)
+	if (l > 0) {
+		mpz_fdiv_q_ui(r, i, l);
+	} else {
+		mpz_neg(r, i);
+		mpz_fdiv_q_ui(r, r, -(unsigned long) l);
+	}
+}
+
+// Modulo (always non-negative, as in GMP)
+static void
+z_mod_mpz( mpz_ptr r, mpz_srcptr i, mpz_srcptr b ) {
+	if (mpz_sgn(b) == 0)
+		rb_raise(rb_eRuntimeError, "base cannot be zero");
+	mpz_mod(r, i, b);
+}
+
+static void
+z_mod_long( mpz_ptr r, mpz_srcptr i, long l ) {
+	if (l == 0)
+		rb_raise(rb_eRuntimeError, "base cannot be zero");
+	mpz_fdiv_r_ui(r, i, (l > 0) ? (unsigned long) l : -(unsigned long) l);
+}
+
+// The other division flavours, for the three-address methods: truncating
+// and ceiling quotients, the remainders of all three, and exact division.
+// Negative Fixnum divisors are handled by flipping the rounding direction
+// (e.g. floor(i / -d) == -ceil(i / d)).
+#define Z_DIVISION_MPZ(name) \
+static void \
+z_##name##_mpz( mpz_ptr r, mpz_srcptr i, mpz_srcptr d ) { \
+	if (mpz_sgn(d) == 0) \
+		rb_raise(rb_eZeroDivError, "divided by 0"); \
+	mpz_##name(r, i, d); \
+}
+
+Z_DIVISION_MPZ(tdiv_q)
+Z_DIVISION_MPZ(cdiv_q)
+Z_DIVISION_MPZ(fdiv_r)
+Z_DIVISION_MPZ(tdiv_r)
+Z_DIVISION_MPZ(cdiv_r)
+Z_DIVISION_MPZ(divexact)
+
+static void
+z_tdiv_q_long( mpz_ptr r, mpz_srcptr i, long l ) {
+	if (l == 0)
+		rb_raise(rb_eZeroDivError, "divided by 0");
+	mpz_tdiv_q_ui(r, i, (l > 0) ? (unsigned long) l : -(unsigned long) l);
+	if (l < 0)
+		mpz_neg(r, r);
+}
+
+static void
+z_cdiv_q_long( mpz_ptr r, mpz_srcptr i, long l ) {
+	if (l == 0)
+		rb_raise(rb_eZeroDivError, "divided by 0");
 	
-	// I'm guessing no compilers will complain about the lack of this?
-	// Anyhow, just in case...
-	return Qfalse;
+	if (l > 0) {
+		mpz_cdiv_q_ui(r, i, l);
+	} else {
+		mpz_fdiv_q_ui(r, i, -(unsigned long) l);
+		mpz_neg(r, r);
+	}
 }
 
-// Greater than or equal to (>=)
-// {GMP::Integer} -> {TrueClass, FalseClass}
+static void
+z_fdiv_r_long( mpz_ptr r, mpz_srcptr i, long l ) {
+	if (l == 0)
+		rb_raise(rb_eZeroDivError, "divided by 0");
+	
+	if (l > 0)
+		mpz_fdiv_r_ui(r, i, l);
+	else
+		mpz_cdiv_r_ui(r, i, -(unsigned long) l);
+}
+
+static void
+z_tdiv_r_long( mpz_ptr r, mpz_srcptr i, long l ) {
+	if (l == 0)
+		rb_raise(rb_eZeroDivError, "divided by 0");
+	mpz_tdiv_r_ui(r, i, (l > 0) ? (unsigned long) l : -(unsigned long) l);
+}
+
+static void
+z_cdiv_r_long( mpz_ptr r, mpz_srcptr i, long l ) {
+	if (l == 0)
+		rb_raise(rb_eZeroDivError, "divided by 0");
+	
+	if (l > 0)
+		mpz_cdiv_r_ui(r, i, l);
+	else
+		mpz_fdiv_r_ui(r, i, -(unsigned long) l);
+}
+
+static void
+z_divexact_long( mpz_ptr r, mpz_srcptr i, long l ) {
+	if (l == 0)
+		rb_raise(rb_eZeroDivError, "divided by 0");
+	mpz_divexact_ui(r, i, (l > 0) ? (unsigned long) l : -(unsigned long) l);
+	if (l < 0)
+		mpz_neg(r, r);
+}
+
+// GMP only has integral powers with unsigned long exponents
+static void
+z_pow_mpz( mpz_ptr r, mpz_srcptr i, mpz_srcptr e ) {
+	if (mpz_sgn(e) < 0)
+		rb_raise(rb_eRangeError, "exponent must be non-negative");
+	
+	if (!mpz_fits_ulong_p(e))
+		rb_raise(rb_eRangeError, "exponent must fit in a ulong");
+	
+	mpz_pow_ui(r, i, mpz_get_ui(e));
+}
+
+static void
+z_pow_long( mpz_ptr r, mpz_srcptr i, long l ) {
+	if (l < 0)
+		rb_raise(rb_eRangeError, "exponent must be non-negative");
+	mpz_pow_ui(r, i, l);
+}
+
+// Square-and-multiply over the exponent's bits, checkpointing before each
+// squaring; the last few squarings are the bulk of the work. e is known to
+// be a non-negative ulong (see z_pow_work)
+static void
+z_pow_chunked( mpz_ptr r, mpz_srcptr i, mpz_srcptr e, rgmp_checkpoint *cp ) {
+	unsigned long el = mpz_get_ui(e);
+	
+	// Powers of two (and 0, 1) are mere shifts for mpz_pow_ui
+	if (mpz_cmpabs_ui(i, 1) <= 0 || mpz_scan1(i, 0) + 1 == mpz_sizeinbase(i, 2)) {
+		mpz_pow_ui(r, i, el);
+		return;
+	}
+	
+	int bits = 0;
+	while ((el >> bits) >= 256)
+		bits++;
+	
+	mpz_pow_ui(r, i, el >> bits);
+	while (bits-- > 0) {
+		if (rgmp_poll(cp))
+			return;
+		mpz_mul(r, r, r);
+		if ((el >> bits) & 1)
+			mpz_mul(r, r, i);
+	}
+}
+
+// The logic operators have no unsigned long variants at all, so the Fixnum
+// goes in as a read-only mpz_t living on the stack
+static void
+z_and_long( mpz_ptr r, mpz_srcptr i, long l ) {
+	mpz_t lz;
+	mp_limb_t limb;
+	mpz_and(r, i, long2mpz(lz, &limb, l));
+}
+
+static void
+z_ior_long( mpz_ptr r, mpz_srcptr i, long l ) {
+	mpz_t lz;
+	mp_limb_t limb;
+	mpz_ior(r, i, long2mpz(lz, &limb, l));
+}
+
+static void
+z_xor_long( mpz_ptr r, mpz_srcptr i, long l ) {
+	mpz_t lz;
+	mp_limb_t limb;
+	mpz_xor(r, i, long2mpz(lz, &limb, l));
+}
+
+// gcd and lcm only depend on the absolute value of their operands
+static void
+z_gcd_long( mpz_ptr r, mpz_srcptr i, long l ) {
+	mpz_gcd_ui(r, i, (l > 0) ? (unsigned long) l : -(unsigned long) l);
+}
+
+static void
+z_lcm_long( mpz_ptr r, mpz_srcptr i, long l ) {
+	mpz_lcm_ui(r, i, (l > 0) ? (unsigned long) l : -(unsigned long) l);
+}
+
+const z_operator z_add_op = { mpz_add, z_add_long, 1 };
+const z_operator z_sub_op = { mpz_sub, z_sub_long, 1 };
+const z_operator z_mul_op = { mpz_mul, mpz_mul_si, 1, z_operands_work, NULL, z_mul_chunked };
+const z_operator z_div_op = { z_div_mpz, z_div_long, 1, z_division_work };
+const z_operator z_mod_op = { z_mod_mpz, z_mod_long, 1, z_division_work };
+const z_operator z_tdiv_q_op = { z_tdiv_q_mpz, z_tdiv_q_long, 1, z_division_work };
+const z_operator z_cdiv_q_op = { z_cdiv_q_mpz, z_cdiv_q_long, 1, z_division_work };
+const z_operator z_fdiv_r_op = { z_fdiv_r_mpz, z_fdiv_r_long, 1, z_division_work };
+const z_operator z_tdiv_r_op = { z_tdiv_r_mpz, z_tdiv_r_long, 1, z_division_work };
+const z_operator z_cdiv_r_op = { z_cdiv_r_mpz, z_cdiv_r_long, 1, z_division_work };
+const z_operator z_divexact_op = { z_divexact_mpz, z_divexact_long, 1, z_division_work };
+const z_operator z_pow_op = { z_pow_mpz, z_pow_long, 0, z_pow_work, z_pow_long_work, z_pow_chunked };
+const z_operator z_and_op = { mpz_and, z_and_long, 1 };
+const z_operator z_ior_op = { mpz_ior, z_ior_long, 1 };
+const z_operator z_xor_op = { mpz_xor, z_xor_long, 1 };
+const z_operator z_gcd_op = { mpz_gcd, z_gcd_long, 1, z_operands_work };
+const z_operator z_lcm_op = { mpz_lcm, z_lcm_long, 1, z_operands_work };
+
+// Creates a new GMP::Integer holding self OP other
 VALUE
-z_greater_than_or_equal_to_test( VALUE self, VALUE other ) {
-	// Creates a mpz_t pointer and loads self in it
+z_binary_operation( VALUE self, VALUE other, const z_operator *op ) {
+	// Creates pointers to self's and the result's mpz_t structures
+	mpz_t *r;
+	VALUE result = integer_create(&r);
 	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
 	
-	// Immediate responses to avoid one object creation
-	switch (TYPE(other)) {
-		case T_DATA: {
-			if (rb_obj_class(other) == cGMPInteger) {
-				mpz_t *od;
-				Data_Get_Struct(other, mpz_t, od);
-				
-				if (mpz_cmp(*i, *od) >= 0)
-					return Qtrue;
-				else
-					return Qfalse;
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
-			break;
-		}
-		case T_FIXNUM: {
-			signed long ol = FIX2LONG(other);
-			if (mpz_cmp_si(*i, ol) >= 0)
-				return Qtrue;
-			else
-				return Qfalse;
-			break;
-		}
-		case T_BIGNUM: {
-			mpz_t tempOb;
-			VALUE str = rb_big2str(other, 10);
-			mpz_init_set_str(tempOb, StringValuePtr(str), 10);
-			if (mpz_cmp(*i, tempOb) >= 0) {
-				mpz_clear(tempOb);
-				return Qtrue;
-			} else {
-				mpz_clear(tempOb);
-				return Qfalse;
-			}
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "input data type not supported");
-		}
+	// Loads self into *i
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
+	
+	z_apply(*r, *i, other, op);
+	
+	return result;
+}
+
+// Addition (+)
+// {GMP::Integer, Fixnum, Bignum} -> {GMP::Integer}
+VALUE
+z_addition( VALUE self, VALUE summand ) {
+	return z_binary_operation(self, summand, &z_add_op);
+}
+
+// Subtraction (-)
+// {GMP::Integer, Fixnum, Bignum} -> {GMP::Integer}
+VALUE
+z_subtraction( VALUE self, VALUE subtraend ) {
+	return z_binary_operation(self, subtraend, &z_sub_op);
+}
+
+// Multiplication (*)
+// {GMP::Integer, Fixnum, Bignum} -> {GMP::Integer}
+VALUE
+z_multiplication( VALUE self, VALUE multiplicand ) {
+	return z_binary_operation(self, multiplicand, &z_mul_op);
+}
+
+// Division (/)
+// {GMP::Integer, Fixnum, Bignum} -> {GMP::Integer}
+VALUE
+z_division( VALUE self, VALUE dividend ) {
+	return z_binary_operation(self, dividend, &z_div_op);
+}
+
+// Modulo (from modular arithmetic) (%)
+// {GMP::Integer, Fixnum, Bignum} -> {GMP::Integer}
+VALUE
+z_modulo( VALUE self, VALUE base ) {
+	return z_binary_operation(self, base, &z_mod_op);
+}
+
+// Exponetiation (**)
+// {GMP::Integer, Fixnum} -> {GMP::Integer}
+VALUE
+z_power( VALUE self, VALUE exp ) {
+	return z_binary_operation(self, exp, &z_pow_op);
+}
+
+// r = i * 2^shift, or r = floor(i / 2^shift) when right is set. A negative
+// shift goes the other way, instead of wrapping to a huge unsigned count
+void
+z_shift_apply( mpz_ptr r, mpz_srcptr i, VALUE shift, int right ) {
+	// Placeholder for the shift amount
+	long longShift;	// No pun intended
+	
+	if (!(FIXNUM_P(shift) || TYPE(shift) == T_BIGNUM))
+		rb_raise(rb_eTypeError, "shift is not of a supported type");
+	
+	longShift = NUM2LONG(shift);
+	if (longShift < 0) {
+		right = !right;
+		longShift = -(unsigned long) longShift;
 	}
 	
-	// I'm guessing no compilers will complain about the lack of this?
-	// Anyhow, just in case...
-	return Qfalse;
+	if (right)
+		mpz_fdiv_q_2exp(r, i, (unsigned long) longShift);
+	else
+		mpz_mul_2exp(r, i, (unsigned long) longShift);
 }
 
-// Less than or equal to (<=)
-// {GMP::Integer} -> {TrueClass, FalseClass}
+// Left shift (also multiplication by a power of 2)
+// {Fixnum, Bignum} -> {GMP::Integer}
 VALUE
-z_less_than_or_equal_to_test( VALUE self, VALUE other ) {
-	// Creates a mpz_t pointer and loads self in it
+z_left_shift( VALUE self, VALUE shift ) {
+	// Creates pointers to self's and the result's mpz_t structures
+	mpz_t *r;
+	VALUE result = integer_create(&r);
 	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
 	
-	// Immediate responses to avoid one object creation
-	switch (TYPE(other)) {
-		case T_DATA: {
-			if (rb_obj_class(other) == cGMPInteger) {
-				mpz_t *od;
-				Data_Get_Struct(other, mpz_t, od);
-				
-				if (mpz_cmp(*i, *od) <= 0)
-					return Qtrue;
-				else
-					return Qfalse;
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
-			break;
-		}
-		case T_FIXNUM: {
-			signed long ol = FIX2LONG(other);
-			if (mpz_cmp_si(*i, ol) <= 0)
-				return Qtrue;
-			else
-				return Qfalse;
-			break;
-		}
-		case T_BIGNUM: {
-			mpz_t tempOb;
-			VALUE str = rb_big2str(other, 10);
-			mpz_init_set_str(tempOb, StringValuePtr(str), 10);
-			if (mpz_cmp(*i, tempOb) <= 0) {
-				mpz_clear(tempOb);
-				return Qtrue;
-			} else {
-				mpz_clear(tempOb);
-				return Qfalse;
-			}
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "input data type not supported");
-		}
-	}
+	// Loads self into *i
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
+	
+	z_shift_apply(*r, *i, shift, 0);
+	
+	return result;
+}
+
+// Right shift (also division by a power of 2)
+// {Fixnum, Bignum} -> {GMP::Integer}
+VALUE
+z_right_shift( VALUE self, VALUE shift ) {
+	// Creates pointers to self's and the result's mpz_t structures
+	mpz_t *r;
+	VALUE result = integer_create(&r);
+	mpz_t *i;
+	
+	// Loads self into *i
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
+	
+	z_shift_apply(*r, *i, shift, 1);
+	
+	return result;
+}
+//// end of binary operator methods
+////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////
+//// Unary arithmetical operators (operations over a single value)
+// Plus (+a)
+// {GMP::Integer} -> {GMP::Integer}
+VALUE
+z_positive( VALUE self ) {
+	return self;
+}
+
+// Negation (-a)
+// {GMP::Integer} -> {GMP::Integer}
+VALUE
+z_negation( VALUE self ) {
+	// Creates pointers to self's and the result's mpz_t structures
+	mpz_t *r;
+	VALUE result = integer_create(&r);
+	mpz_t *i;
+	
+	// Loads self into *i
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
+	
+	// Negates i, and copies the result to r
+	mpz_neg(*r, *i);
+	
+	return result;
+}
+//// end of unary operators methods
+////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////
+//// Logic operators
+// Logic AND (&)
+// {GMP::Integer, Fixnum, Bignum} -> {GMP::Integer}
+VALUE
+z_logic_and( VALUE self, VALUE other ) {
+	return z_binary_operation(self, other, &z_and_op);
+}
+
+// Logic OR (inclusive OR) (|)
+// {GMP::Integer, Fixnum, Bignum} -> {GMP::Integer}
+VALUE
+z_logic_ior( VALUE self, VALUE other ) {
+	return z_binary_operation(self, other, &z_ior_op);
+}
+
+// Logic XOR (exclusive OR) (^)
+// {GMP::Integer, Fixnum, Bignum} -> {GMP::Integer}
+VALUE 
+z_logic_xor( VALUE self, VALUE other ) {
+	return z_binary_operation(self, other, &z_xor_op);
+}
+
+// Logic NOT (~)
+// {GMP::Integer} -> {GMP::Integer}
+VALUE
+z_logic_not( VALUE self ) {
+	// Creates pointers to self's and the result's mpz_t structures
+	mpz_t *r;
+	VALUE result = integer_create(&r);
+	mpz_t *i;
+	
+	// Loads self into *i
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
+	
+	// Sets result as the one's complement of self
+	mpz_com(*r, *i);
 	
-	// I'm guessing no compilers will complain about the lack of this?
-	// Anyhow, just in case...
-	return Qfalse;
+	return result;
 }
+//// end of logic manipulation methods
+////////////////////////////////////////////////////////////////////
 
-// Generic comparison (<=>)
-// {GMP::Integer} -> {Fixnum}
-VALUE
-z_generic_comparison( VALUE self, VALUE other ) {
+////////////////////////////////////////////////////////////////////
+//// Comparison methods
+// Compares self with other, returning a negative number, zero or a positive
+// number, like mpz_cmp
+int
+z_compare( VALUE self, VALUE other ) {
 	// Creates a mpz_t pointer and loads self in it
 	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
-	// Immediate responses to avoid one object creation
-	switch (TYPE(other)) {
-		case T_DATA: {
-			if (rb_obj_class(other) == cGMPInteger) {
-				mpz_t *od;
-				Data_Get_Struct(other, mpz_t, od);
-				return INT2FIX(mpz_cmp(*i, *od));
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
-			break;
+	switch (operand_kind(other)) {
+		case OPERAND_INTEGER: {
+			return mpz_cmp(*i, MPZ_OF(other));
 		}
-		case T_FIXNUM: {
-			signed long ol = FIX2LONG(other);
-			return INT2FIX(mpz_cmp_si(*i, ol));
-			break;
+		case OPERAND_FIXNUM: {
+			return mpz_cmp_si(*i, FIX2LONG(other));
 		}
-		case T_BIGNUM: {
+		case OPERAND_BIGNUM: {
 			mpz_t tempOb;
-			VALUE str = rb_big2str(other, 10);
-			mpz_init_set_str(tempOb, StringValuePtr(str), 10);
-			return INT2FIX(mpz_cmp(*i, tempOb));
-			break;
+			mpz_init(tempOb);
+			RGMP_COUNT(STAT_TEMPORARIES, 1);
+			num2mpz(tempOb, other);
+			int result = mpz_cmp(*i, tempOb);
+			mpz_clear(tempOb);
+			return result;
 		}
 		default: {
 			rb_raise(rb_eTypeError, "input data type not supported");
 		}
 	}
+}
+
+// Equality (==)
+// {GMP::Integer, Fixnum, Bignum} -> {TrueClass, FalseClass}
+VALUE
+z_equality_test( VALUE self, VALUE other ) {
+	return (z_compare(self, other) == 0) ? Qtrue : Qfalse;
+}
+
+// Greater than (>)
+// {GMP::Integer, Fixnum, Bignum} -> {TrueClass, FalseClass}
+VALUE
+z_greater_than_test( VALUE self, VALUE other ) {
+	return (z_compare(self, other) > 0) ? Qtrue : Qfalse;
+}
+
+// Less than (<)
+// {GMP::Integer, Fixnum, Bignum} -> {TrueClass, FalseClass}
+VALUE
+z_less_than_test( VALUE self, VALUE other ) {
+	return (z_compare(self, other) < 0) ? Qtrue : Qfalse;
+}
+
+// Greater than or equal to (>=)
+// {GMP::Integer, Fixnum, Bignum} -> {TrueClass, FalseClass}
+VALUE
+z_greater_than_or_equal_to_test( VALUE self, VALUE other ) {
+	return (z_compare(self, other) >= 0) ? Qtrue : Qfalse;
+}
+
+// Less than or equal to (<=)
+// {GMP::Integer, Fixnum, Bignum} -> {TrueClass, FalseClass}
+VALUE
+z_less_than_or_equal_to_test( VALUE self, VALUE other ) {
+	return (z_compare(self, other) <= 0) ? Qtrue : Qfalse;
+}
+
+// Generic comparison (<=>)
+// {GMP::Integer, Fixnum, Bignum} -> {Fixnum}
+VALUE
+z_generic_comparison( VALUE self, VALUE other ) {
+	int result = z_compare(self, other);
 	
-	// I'm guessing no compilers will complain about the lack of this?
-	// Anyhow, just in case...
-	return Qfalse;
+	// mpz_cmp only promises the sign of its result
+	return INT2FIX((result > 0) - (result < 0));
 }
 
 //// end of comparison methods
@@ -1004,7 +1913,7 @@ VALUE
 z_next_prime_inplace( VALUE self ) {
 	// Creates a mpz_t pointer and loads self in it
 	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
 	mpz_nextprime(*i, *i);
 	
@@ -1017,7 +1926,7 @@ VALUE
 z_absolute_inplace( VALUE self ) {
 	// Creates a mpz_t pointer and loads self in it
 	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
 	mpz_abs(*i, *i);
 	
@@ -1030,7 +1939,7 @@ VALUE
 z_negation_inplace( VALUE self ) {
 	// Creates a mpz_t pointer and loads self in it
 	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
 	mpz_neg(*i, *i);
 	
@@ -1043,7 +1952,7 @@ VALUE
 z_sqrt_inplace( VALUE self ) {
 	// Creates a mpz_t pointer and loads self in it
 	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
 	mpz_sqrt(*i, *i);
 	
@@ -1058,7 +1967,7 @@ z_root_inplace( VALUE self, VALUE degree ) {
 	// Also loads degree into an unsigned long
 	mpz_t *i;
 	unsigned long longDegree = NUM2LONG(degree);
-	Data_Get_Struct(self, mpz_t, i);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
 	// If the degree is zero, GMP will normally give a floating point error
 	// A possible solution is to make the degree -1, which works as expected
@@ -1080,8 +1989,8 @@ z_invert_inplace( VALUE self, VALUE base ) {
 	int check;
 	
 	// Copies back the mpz_t pointers wrapped in ruby data objects
-	Data_Get_Struct(self, mpz_t, i);
-	Data_Get_Struct(base, mpz_t, b);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
+	TypedData_Get_Struct(base, mpz_t, &integer_type, b);
 	
 	check = mpz_invert(*i, *i, *b);
 	
@@ -1118,7 +2027,7 @@ z_set_bit_inplace( VALUE self, VALUE index, VALUE newValue ) {
 		rb_raise(rb_eRangeError, "bit position out of range");
 	
 	// Copies back the mpz_t pointer wrapped in a ruby data object
-	Data_Get_Struct(self, mpz_t, i);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
 	// Sets the bit accordingly
 	if (mpz_tstbit(*i, longIndex) != intNewValue)
@@ -1133,79 +2042,172 @@ VALUE
 z_addition_inplace( VALUE self, VALUE summand ) {
 	// Creates a mpz_t pointer and loads self in it
 	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
-	switch (TYPE(summand)) {
-		case T_DATA: {
-			if (rb_obj_class(summand) == cGMPInteger) {
-				mpz_t *sd;
-				Data_Get_Struct(summand, mpz_t, sd);
-				mpz_add(*i, *i, *sd);
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
+	z_apply(*i, *i, summand, &z_add_op);
+	
+	return Qnil;
+}
+
+// Subtraction
+// {GMP::Integer, Fixnum, Bignum} -> {}
+VALUE
+z_subtraction_inplace( VALUE self, VALUE subtraend ) {
+	// Creates a mpz_t pointer and loads self in it
+	mpz_t *i;
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
+	
+	z_apply(*i, *i, subtraend, &z_sub_op);
+	
+	return Qnil;
+}
+
+// Multiplication
+// {GMP::Integer, Fixnum, Bignum} -> {}
+VALUE
+z_multiplication_inplace( VALUE self, VALUE multiplicand ) {
+	// Creates a mpz_t pointer and loads self in it
+	mpz_t *i;
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
+	
+	z_apply(*i, *i, multiplicand, &z_mul_op);
+	
+	return Qnil;
+}
+
+// self += first * second (or -=, when subtract is set)
+void
+z_addmul_apply( mpz_ptr i, VALUE first, VALUE second, int subtract ) {
+	mpz_t *f;
+	TypedData_Get_Struct(first, mpz_t, &integer_type, f);
+	
+	switch (operand_kind(second)) {
+		case OPERAND_INTEGER: {
+			if (subtract)
+				mpz_submul(i, *f, MPZ_OF(second));
+			else
+				mpz_addmul(i, *f, MPZ_OF(second));
 			break;
 		}
-		case T_FIXNUM: {
-			// Yep, also smells like a bad hack
-			// Unfortunately, GMP does not have an addition function that deals
-			// with signed ints
-			mpz_t tempSuf;
-			mpz_init_set_si(tempSuf, FIX2LONG(summand));
-			mpz_add(*i, *i, tempSuf);
-			mpz_clear(tempSuf);
+		case OPERAND_FIXNUM: {
+			// Only unsigned multipliers are supported, so a negative one
+			// turns addmul into submul and vice versa
+			long l = FIX2LONG(second);
+			if (l < 0)
+				subtract = !subtract;
+			unsigned long ul = (l < 0) ? -(unsigned long) l : (unsigned long) l;
+			
+			if (subtract)
+				mpz_submul_ui(i, *f, ul);
+			else
+				mpz_addmul_ui(i, *f, ul);
 			break;
 		}
-		case T_BIGNUM: {
-			mpz_t tempSub;
-			VALUE str = rb_big2str(summand, 10);
-			mpz_init_set_str(tempSub, StringValuePtr(str), 10);
-			mpz_add(*i, *i, tempSub);
-			mpz_clear(tempSub);
+		case OPERAND_BIGNUM: {
+			mpz_t tempBig;
+			mpz_init(tempBig);
+			RGMP_COUNT(STAT_TEMPORARIES, 1);
+			num2mpz(tempBig, second);
+			if (subtract)
+				mpz_submul(i, *f, tempBig);
+			else
+				mpz_addmul(i, *f, tempBig);
+			mpz_clear(tempBig);
 			break;
 		}
 		default: {
 			rb_raise(rb_eTypeError, "input data type not supported");
 		}
 	}
+}
+
+// Multiply two values and then add to self
+// {GMP::Integer}, {GMP::Integer, Fixnum, Bignum}
+VALUE
+z_addmul_inplace( VALUE self, VALUE first, VALUE second ) {
+	// Creates a mpz_t pointer and loads self in it
+	mpz_t *i;
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
+	
+	z_addmul_apply(*i, first, second, 0);
 	
 	return Qnil;
 }
 
-// Subtraction
-// {GMP::Integer, Fixnum, Bignum} -> {}
+// Multiply two values and then subtract from self
+// {GMP::Integer}, {GMP::Integer, Fixnum, Bignum}
 VALUE
-z_subtraction_inplace( VALUE self, VALUE subtraend ) {
+z_submul_inplace( VALUE self, VALUE first, VALUE second ) {
 	// Creates a mpz_t pointer and loads self in it
 	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
-	switch (TYPE(subtraend)) {
-		case T_DATA: {
-			if (rb_obj_class(subtraend) == cGMPInteger) {
-				mpz_t *sd;
-				Data_Get_Struct(subtraend, mpz_t, sd);
-				mpz_sub(*i, *i, *sd);
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
+	z_addmul_apply(*i, first, second, 1);
+	
+	return Qnil;
+}
+//// end of inplace methods
+////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////
+//// Three-address methods (self = a OP b, reusing self's limbs)
+// Self may be one of the operands too; GMP handles the overlap. The first
+// operand has to be a GMP::Integer, the second one goes through z_apply.
+static VALUE
+z_set_binary( VALUE self, VALUE a, VALUE b, const z_operator *op ) {
+	// Creates pointers for self's and a's mpz_t structures
+	mpz_t *r, *i;
+	TypedData_Get_Struct(self, mpz_t, &integer_type, r);
+	TypedData_Get_Struct(a, mpz_t, &integer_type, i);
+	
+	z_apply(*r, *i, b, op);
+	
+	return Qnil;
+}
+
+// Declares z_set_<name>, a set_<name> method dispatching on z_<name>_op
+#define Z_SET_BINARY(name) \
+VALUE \
+z_set_##name( VALUE self, VALUE a, VALUE b ) { \
+	return z_set_binary(self, a, b, &z_##name##_op); \
+}
+
+Z_SET_BINARY(add)
+Z_SET_BINARY(sub)
+Z_SET_BINARY(mul)
+Z_SET_BINARY(div)
+Z_SET_BINARY(tdiv_q)
+Z_SET_BINARY(cdiv_q)
+Z_SET_BINARY(mod)
+Z_SET_BINARY(fdiv_r)
+Z_SET_BINARY(tdiv_r)
+Z_SET_BINARY(cdiv_r)
+Z_SET_BINARY(divexact)
+Z_SET_BINARY(pow)
+Z_SET_BINARY(and)
+Z_SET_BINARY(ior)
+Z_SET_BINARY(xor)
+Z_SET_BINARY(gcd)
+Z_SET_BINARY(lcm)
+
+// Copies a into self
+// {GMP::Integer, Fixnum, Bignum} -> {NilClass}
+VALUE
+z_set( VALUE self, VALUE a ) {
+	mpz_t *r;
+	TypedData_Get_Struct(self, mpz_t, &integer_type, r);
+	
+	switch (operand_kind(a)) {
+		case OPERAND_INTEGER: {
+			mpz_set(*r, MPZ_OF(a));
 			break;
 		}
-		case T_FIXNUM: {
-			// Yep, also smells like a bad hack
-			// Unfortunately, GMP does not have a subtraction function that
-			// deals with signed ints
-			mpz_t tempSuf;
-			mpz_init_set_si(tempSuf, FIX2LONG(subtraend));
-			mpz_sub(*i, *i, tempSuf);
+		case OPERAND_FIXNUM: {
+			mpz_set_si(*r, FIX2LONG(a));
 			break;
 		}
-		case T_BIGNUM: {
-			mpz_t tempSub;
-			VALUE str = rb_big2str(subtraend, 10);
-			mpz_init_set_str(tempSub, StringValuePtr(str), 10);
-			mpz_sub(*i, *i, tempSub);
-			mpz_clear(tempSub);
+		case OPERAND_BIGNUM: {
+			num2mpz(*r, a);
 			break;
 		}
 		default: {
@@ -1216,37 +2218,42 @@ z_subtraction_inplace( VALUE self, VALUE subtraend ) {
 	return Qnil;
 }
 
-// Multiplication
-// {GMP::Integer, Fixnum, Bignum} -> {}
+// Floor division with remainder: self = a div b, remainder = a mod b
+// {GMP::Integer}, {GMP::Integer}, {GMP::Integer, Fixnum, Bignum} -> {NilClass}
 VALUE
-z_multiplication_inplace( VALUE self, VALUE multiplicand ) {
-	// Creates a mpz_t pointer and loads self in it
-	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
-		
-	// Decides what to do based on the multiplicand's type/class
-	switch (TYPE(multiplicand)) {
-		case T_DATA: {
-			if (rb_obj_class(multiplicand) == cGMPInteger) {
-				mpz_t *sd;
-				Data_Get_Struct(multiplicand, mpz_t, sd);
-				mpz_mul(*i, *i, *sd);
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
+z_set_divmod( VALUE self, VALUE remainder, VALUE a, VALUE b ) {
+	mpz_t *q, *r, *i;
+	TypedData_Get_Struct(self, mpz_t, &integer_type, q);
+	TypedData_Get_Struct(remainder, mpz_t, &integer_type, r);
+	TypedData_Get_Struct(a, mpz_t, &integer_type, i);
+	
+	if (q == r)
+		rb_raise(rb_eArgError, "quotient and remainder must be different objects");
+	
+	switch (operand_kind(b)) {
+		case OPERAND_INTEGER: {
+			mpz_srcptr d = MPZ_OF(b);
+			if (mpz_sgn(d) == 0)
+				rb_raise(rb_eZeroDivError, "divided by 0");
+			mpz_fdiv_qr(*q, *r, *i, d);
 			break;
 		}
-		case T_FIXNUM: {
-			signed long sl = FIX2LONG(multiplicand);
-			mpz_mul_si(*i, *i, sl);
+		case OPERAND_FIXNUM: {
+			mpz_t dFix;
+			mp_limb_t dLimb;
+			long l = FIX2LONG(b);
+			if (l == 0)
+				rb_raise(rb_eZeroDivError, "divided by 0");
+			mpz_fdiv_qr(*q, *r, *i, long2mpz(dFix, &dLimb, l));
 			break;
 		}
-		case T_BIGNUM: {
-			mpz_t tempMub;
-			VALUE str = rb_big2str(multiplicand, 10);
-			mpz_init_set_str(tempMub, StringValuePtr(str), 10);
-			mpz_mul(*i, *i, tempMub);
-			mpz_clear(tempMub);
+		case OPERAND_BIGNUM: {
+			mpz_t tempBig;
+			mpz_init(tempBig);
+			RGMP_COUNT(STAT_TEMPORARIES, 1);
+			num2mpz(tempBig, b);
+			mpz_fdiv_qr(*q, *r, *i, tempBig);
+			mpz_clear(tempBig);
 			break;
 		}
 		default: {
@@ -1257,76 +2264,129 @@ z_multiplication_inplace( VALUE self, VALUE multiplicand ) {
 	return Qnil;
 }
 
-// Multiply two values and then add to self
-// {GMP::Integer}, {GMP::Integer}
+// self = a^exp mod base
+// {GMP::Integer, Fixnum, Bignum}, {GMP::Integer, Fixnum, Bignum}, {GMP::Integer, Fixnum, Bignum} -> {NilClass}
 VALUE
-z_addmul_inplace( VALUE self, VALUE first, VALUE second ) {
-	// Create pointers to self, first and second
-	mpz_t *i, *f, *s;
+z_set_powmod( VALUE self, VALUE a, VALUE exp, VALUE base ) {
+	mpz_t *r;
+	TypedData_Get_Struct(self, mpz_t, &integer_type, r);
 	
-	// Loads all three from Ruby
-	Data_Get_Struct(second, mpz_t, s);
-	Data_Get_Struct(first, mpz_t, f);
-	Data_Get_Struct(self, mpz_t, i);
+	VALUE holder = Qnil;
+	z_powm_apply(*r, z_integral_operand(a, &holder), exp, base);
+	RB_GC_GUARD(holder);
 	
-	// Does the calculation
-	mpz_addmul(*i, *f, *s);
+	return Qnil;
+}
+
+// self = a * 2^shift
+// {GMP::Integer}, {Fixnum, Bignum} -> {NilClass}
+VALUE
+z_set_lshift( VALUE self, VALUE a, VALUE shift ) {
+	mpz_t *r, *i;
+	TypedData_Get_Struct(self, mpz_t, &integer_type, r);
+	TypedData_Get_Struct(a, mpz_t, &integer_type, i);
+	
+	z_shift_apply(*r, *i, shift, 0);
 	
 	return Qnil;
 }
 
-// Multiply two values and then subtract from self
-// {GMP::Integer}, {GMP::Integer}
+// self = floor(a / 2^shift)
+// {GMP::Integer}, {Fixnum, Bignum} -> {NilClass}
 VALUE
-z_submul_inplace( VALUE self, VALUE first, VALUE second ) {
-	// Create pointers to self, first and second
-	mpz_t *i, *f, *s;
+z_set_rshift( VALUE self, VALUE a, VALUE shift ) {
+	mpz_t *r, *i;
+	TypedData_Get_Struct(self, mpz_t, &integer_type, r);
+	TypedData_Get_Struct(a, mpz_t, &integer_type, i);
 	
-	// Loads all three from Ruby
-	Data_Get_Struct(second, mpz_t, s);
-	Data_Get_Struct(first, mpz_t, f);
-	Data_Get_Struct(self, mpz_t, i);
+	z_shift_apply(*r, *i, shift, 1);
 	
-	// Does the calculation
-	mpz_submul(*i, *f, *s);
+	return Qnil;
+}
+
+// self = floor(sqrt(a))
+// {GMP::Integer} -> {NilClass}
+VALUE
+z_set_sqrt( VALUE self, VALUE a ) {
+	mpz_t *r, *i;
+	TypedData_Get_Struct(self, mpz_t, &integer_type, r);
+	TypedData_Get_Struct(a, mpz_t, &integer_type, i);
+	
+	if (mpz_sgn(*i) == -1)
+		rb_raise(rb_eRuntimeError, "number is negative");
+	
+	mpz_sqrt(*r, *i);
 	
 	return Qnil;
 }
-//// end of inplace methods
+
+// self = truncated nth root of a
+// {GMP::Integer}, {Fixnum} -> {NilClass}
+VALUE
+z_set_root( VALUE self, VALUE a, VALUE degree ) {
+	mpz_t *r, *i;
+	unsigned long longDegree = NUM2LONG(degree);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, r);
+	TypedData_Get_Struct(a, mpz_t, &integer_type, i);
+	
+	// Same degree zero hack as in GMP::Integer.root
+	if (longDegree == (unsigned long) 0)
+		--longDegree;
+	
+	if (mpz_sgn(*i) == -1 && longDegree % 2 == 0)
+		rb_raise(rb_eRuntimeError, "number is negative, but degree is even");
+	
+	mpz_root(*r, *i, longDegree);
+	
+	return Qnil;
+}
+
+// Declares z_set_<name>, a set_<name> method wrapping mpz_<name>(self, a)
+#define Z_SET_UNARY(name) \
+VALUE \
+z_set_##name( VALUE self, VALUE a ) { \
+	mpz_t *r, *i; \
+	TypedData_Get_Struct(self, mpz_t, &integer_type, r); \
+	TypedData_Get_Struct(a, mpz_t, &integer_type, i); \
+	mpz_##name(*r, *i); \
+	return Qnil; \
+}
+
+Z_SET_UNARY(neg)
+Z_SET_UNARY(abs)
+Z_SET_UNARY(com)
+//// end of three-address methods
 ////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////
 //// Question-like methods
 // Does 'base' divide 'self'?
-// {GMP::Integer, Fixnum} -> {TrueClass, FalseClass}
+// {GMP::Integer, Fixnum, Bignum} -> {TrueClass, FalseClass}
 VALUE
 z_divisible( VALUE self, VALUE base ) {
 	// Creates a mpz_t pointer and loads self in it
 	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
-	// Placeholder for the result (either Qtrue or Qfalse)
-	// TODO: check whether this gives a performance penalty
-	// in comparison to returning from within the case block
-	VALUE result;
+	int divisible;
 	
-	switch (TYPE(base)) {
-		case T_DATA: {
-			mpz_t *sd;
-			Data_Get_Struct(base, mpz_t, sd);
-			
-			if (! mpz_divisible_p(*i, *sd))
-				result = Qfalse;
-			else
-				result = Qtrue;
+	switch (operand_kind(base)) {
+		case OPERAND_INTEGER: {
+			divisible = mpz_divisible_p(*i, MPZ_OF(base));
 			break;
 		}
-		case T_FIXNUM: {
-			unsigned long sl = FIX2LONG(base);
-			if (! mpz_divisible_ui_p(*i, sl))
-				result = Qfalse;
-			else
-				result = Qtrue;
+		case OPERAND_FIXNUM: {
+			long l = FIX2LONG(base);
+			divisible = mpz_divisible_ui_p(*i, (l > 0) ? (unsigned long) l : -(unsigned long) l);
+			break;
+		}
+		case OPERAND_BIGNUM: {
+			mpz_t tempBig;
+			mpz_init(tempBig);
+			RGMP_COUNT(STAT_TEMPORARIES, 1);
+			num2mpz(tempBig, base);
+			divisible = mpz_divisible_p(*i, tempBig);
+			mpz_clear(tempBig);
 			break;
 		}
 		default: {
@@ -1334,14 +2394,14 @@ z_divisible( VALUE self, VALUE base ) {
 		}
 	}
 	
-	return result;
+	return divisible ? Qtrue : Qfalse;
 }
 
 VALUE
 z_perfect_power( VALUE self ) {
 	// Creates a mpz_t pointer and loads self in it
 	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
 	// As we do not need a switch/case statement here, let's just
 	// return stuff directly within the if block, for performance's
@@ -1356,7 +2416,7 @@ VALUE
 z_perfect_square( VALUE self ) {
 	// Creates a mpz_t pointer and loads self in it
 	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
 	// As we do not need a switch/case statement here, let's just
 	// return stuff directly within the if block, for performance's
@@ -1371,7 +2431,7 @@ VALUE
 z_probable_prime( VALUE self, VALUE numberOfTests ) {
 	// Creates a mpz_t pointer and loads self in it
 	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
 	// Converts numberOfTests from Fixnum to int
 	int numTests = FIX2INT(numberOfTests);
@@ -1392,7 +2452,7 @@ VALUE
 z_even( VALUE self ) {
 	// Creates a mpz_t pointer and loads self in it
 	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
 	// As we do not need a switch/case statement here, let's just
 	// return stuff directly within the if block, for performance's
@@ -1407,7 +2467,7 @@ VALUE
 z_odd( VALUE self ) {
 	// Creates a mpz_t pointer and loads self in it
 	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
 	// As we do not need a switch/case statement here, let's just
 	// return stuff directly within the if block, for performance's
@@ -1423,15 +2483,15 @@ z_odd( VALUE self ) {
 VALUE
 z_precise_equality( VALUE self, VALUE other ) {
 	// Makes sure other's class is also GMP::Integer
-	if (! rb_obj_class(other) == cGMPInteger)
+	if (operand_kind(other) != OPERAND_INTEGER)
 		return Qfalse;
 	
 	// Creates pointers to self's and the other's mpz_t structures
 	mpz_t *i, *o;
 	
 	// Copies back the mpz_t pointers wrapped in ruby data objects
-	Data_Get_Struct(self, mpz_t, i);
-	Data_Get_Struct(other, mpz_t, o);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
+	TypedData_Get_Struct(other, mpz_t, &integer_type, o);
 	
 	if (mpz_cmp(*i, *o) == 0)
 		return Qtrue;
@@ -1445,7 +2505,7 @@ VALUE
 z_zero( VALUE self ) {
 	// Creates a mpz_t pointer and loads self in it
 	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
 	if (mpz_sgn(*i) == 0)
 		return Qtrue;
@@ -1459,7 +2519,7 @@ VALUE
 z_nonzero( VALUE self ) {
 	// Creates a mpz_t pointer and loads self in it
 	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
 	if (mpz_sgn(*i) != 0)
 		return Qtrue;
@@ -1476,37 +2536,33 @@ z_nonzero( VALUE self ) {
 VALUE
 z_absolute( VALUE self ) {
 	// Creates pointers to self's and the result's mpz_t structures
-	mpz_t *r = malloc(sizeof(*r));
+	mpz_t *r;
+	VALUE result = integer_create(&r);
 	mpz_t *i;
 	
 	// Loads self into *i
-	Data_Get_Struct(self, mpz_t, i);
-	
-	// Inits the result
-	mpz_init(*r);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
 	// Sets the result as the absolute value of self
 	mpz_abs(*r, *i);
 	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
+	return result;
 }
 
 VALUE
 z_next_prime( VALUE self ) {
 	// Creates pointers to self's and the result's mpz_t structures
-	mpz_t *r = malloc(sizeof(*r));
+	mpz_t *r;
+	VALUE result = integer_create(&r);
 	mpz_t *i;
 	
 	// Loads self into *i
-	Data_Get_Struct(self, mpz_t, i);
-	
-	// Inits the result
-	mpz_init(*r);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
 	// (probably) Sets the result as the next prime greater than itself
 	mpz_nextprime(*r, *i);
 	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
+	return result;
 }
 
 // Number of digits in a specific base
@@ -1519,7 +2575,7 @@ z_size_in_base( VALUE self, VALUE base ) {
 	
 	// Creates a mpz_t pointer and loads self in it
 	mpz_t *i;
-	Data_Get_Struct(self, mpz_t, i);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
 	// Converts the base from Fixnum to int and checks if its valid
 	int intBase = FIX2INT(base);
@@ -1539,8 +2595,8 @@ z_swap( VALUE self, VALUE other ) {
 	mpz_t *i, *o;
 	
 	// Copies back the mpz_t pointers wrapped in ruby data objects
-	Data_Get_Struct(self, mpz_t, i);
-	Data_Get_Struct(other, mpz_t, o);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
+	TypedData_Get_Struct(other, mpz_t, &integer_type, o);
 	
 	// Swaps the contents of self and other
 	mpz_swap(*i, *o);
@@ -1553,19 +2609,17 @@ z_swap( VALUE self, VALUE other ) {
 VALUE
 z_next( VALUE self ) {
 	// Creates pointers to self's and the result's mpz_t structures
-	mpz_t *r = malloc(sizeof(*r));
+	mpz_t *r;
+	VALUE result = integer_create(&r);
 	mpz_t *i;
 	
 	// Loads self into *i
-	Data_Get_Struct(self, mpz_t, i);
-	
-	// Inits the result
-	mpz_init(*r);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
 	// Sets the result as the next number from self
 	mpz_add_ui(*r, *i, (unsigned long) 1);
 	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
+	return result;
 }
 
 // Gets the specific bit
@@ -1585,7 +2639,7 @@ z_get_bit( VALUE self, VALUE index ) {
 		rb_raise(rb_eRangeError, "bit position out of range");
 	
 	// Copies back the mpz_t pointer wrapped in a ruby data object
-	Data_Get_Struct(self, mpz_t, i);
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
 	
 	return INT2FIX(mpz_tstbit(*i, longIndex));
 }
@@ -1600,88 +2654,99 @@ z_coerce( VALUE self, VALUE other ) {
 //// end of other operations
 ////////////////////////////////////////////////////////////////////
 
+// r = i^e mod m through z_run_powm, with e already in k->b
+static void
+z_powm_kernel( z_kernel *k, mpz_ptr r, mpz_srcptr i, mpz_srcptr m ) {
+	mpz_abs(k->m, m);
+	if (mpz_sgn(k->b) < 0) {
+		mpz_invert(k->a, i, k->m);
+		mpz_neg(k->b, k->b);
+	} else {
+		mpz_mod(k->a, i, k->m);
+	}
+	RGMP_COUNT(STAT_TEMPORARIES, 3);
+	z_kernel_call(k, r);
+}
+
+// r = i^e mod m, without the GVL when big enough (see z_run_powm). Negative
+// exponents need an inverse, which may not exist. It is checked on a
+// temporary, since r may alias any of the operands
+void
+z_powm_mpz( mpz_ptr r, mpz_srcptr i, mpz_srcptr e, mpz_srcptr m ) {
+	if (mpz_sgn(m) == 0)
+		rb_raise(rb_eZeroDivError, "base cannot be zero");
+	
+	if (mpz_sgn(e) < 0) {
+		mpz_t inverse;
+		int invertible;
+		
+		mpz_init(inverse);
+		RGMP_COUNT(STAT_TEMPORARIES, 1);
+		invertible = mpz_invert(inverse, i, m);
+		mpz_clear(inverse);
+		
+		if (!invertible)
+			rb_raise(rb_eRuntimeError, "input is not invertible on this base");
+	}
+	
+	if (RGMP_NOGVL(work_product(mpz_size(m), mpz_size(e)))) {
+		z_kernel k;
+		z_kernel_init(&k, z_run_powm);
+		mpz_set(k.b, e);
+		z_powm_kernel(&k, r, i, m);
+	} else {
+		mpz_powm(r, i, e, m);
+	}
+}
+
+// r = i^e mod m, for word-sized exponents
+void
+z_powm_ui( mpz_ptr r, mpz_srcptr i, unsigned long e, mpz_srcptr m ) {
+	if (mpz_sgn(m) == 0)
+		rb_raise(rb_eZeroDivError, "base cannot be zero");
+	
+	if (RGMP_NOGVL(mpz_size(m))) {
+		z_kernel k;
+		z_kernel_init(&k, z_run_powm);
+		mpz_set_ui(k.b, e);
+		z_powm_kernel(&k, r, i, m);
+	} else {
+		mpz_powm_ui(r, i, e, m);
+	}
+}
+
 ////////////////////////////////////////////////////////////////////
 //// Singletons/Class methods
+// r = i^exp mod base, shared by powermod and set_powmod. Any integral
+// exponent and modulus goes, and negative exponents (whatever their type)
+// invert i first, raising when it is not invertible.
+void
+z_powm_apply( mpz_ptr r, mpz_srcptr i, VALUE exp, VALUE base ) {
+	VALUE baseHolder = Qnil, expHolder = Qnil;
+	mpz_srcptr b = z_integral_operand(base, &baseHolder);
+	
+	if (FIXNUM_P(exp) && FIX2LONG(exp) >= 0)
+		z_powm_ui(r, i, FIX2LONG(exp), b);
+	else
+		z_powm_mpz(r, i, z_integral_operand(exp, &expHolder), b);
+	
+	RB_GC_GUARD(baseHolder);
+	RB_GC_GUARD(expHolder);
+}
+
 // Exponetiation with modulo (powermod)
-// {GMP::Integer, Fixnum} -> {GMP::Integer}
+// {GMP::Integer, Fixnum, Bignum}, {GMP::Integer, Fixnum, Bignum}, {GMP::Integer, Fixnum, Bignum} -> {GMP::Integer}
 VALUE
 z_powermod( VALUE klass, VALUE self, VALUE exp, VALUE base ) {
-	// Creates pointers to self's and the result's mpz_t structures
-	mpz_t *r = malloc(sizeof(*r));
-	mpz_t *i;
-	
-	// Loads self into *i
-	Data_Get_Struct(self, mpz_t, i);
-	
-	// Inits the result
-	mpz_init(*r);
+	// Creates a pointer to the result's mpz_t structure
+	mpz_t *r;
+	VALUE result = integer_create(&r);
 	
-	// Decides what to do based on the exponent's type/class
-	// TODO: check if pointer voodoo can let us avoid the switches
-	switch (TYPE(exp)) {
-		case T_DATA: {
-			mpz_t *ed;
-			Data_Get_Struct(exp, mpz_t, ed);
-			
-			switch (TYPE(base)) {
-				case T_DATA: {
-					mpz_t *bd;
-					Data_Get_Struct(base, mpz_t, bd);
-					mpz_powm(*r, *i, *ed, *bd);
-					break;
-				}
-				case T_FIXNUM: {
-					// This smells like a horrible hack
-					// Unfortunately, GMP does not allow the base to be
-					// an unsigned long
-					unsigned long bl = FIX2LONG(base);
-					// Please don't kill me for this
-					mpz_t *blTemp = malloc(sizeof(mpz_t));
-					mpz_init_set_ui(*blTemp, bl);
-					mpz_powm(*r, *i, *ed, *blTemp);
-					break;
-				}
-				default: {
-					rb_raise(rb_eTypeError, "base's type not supported");
-				}
-			}
-			
-			break;
-		}
-		case T_FIXNUM: {
-			unsigned long el = FIX2LONG(exp);
-			
-			switch (TYPE(base)) {
-				case T_DATA: {
-					mpz_t *bd;
-					Data_Get_Struct(base, mpz_t, bd);
-					mpz_powm_ui(*r, *i, el, *bd);
-					break;
-				}
-				case T_FIXNUM: {
-					// This smells like a horrible hack
-					// Unfortunately, GMP does not allow the base to be
-					// an unsigned long
-					unsigned long bl = FIX2LONG(base);
-					// Please don't kill me for this
-					mpz_t *blTemp = malloc(sizeof(mpz_t));
-					mpz_init_set_ui(*blTemp, bl);
-					mpz_powm_ui(*r, *i, el, *blTemp);
-					break;
-				}
-				default: {
-					rb_raise(rb_eTypeError, "base's type not supported");
-				}
-			}
-			
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "exponent's type not supported");
-		}
-	}
+	VALUE holder = Qnil;
+	z_powm_apply(*r, z_integral_operand(self, &holder), exp, base);
+	RB_GC_GUARD(holder);
 	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
+	return result;
 }
 
 // Square root
@@ -1689,14 +2754,12 @@ z_powermod( VALUE klass, VALUE self, VALUE exp, VALUE base ) {
 VALUE
 z_sqrt_singleton( VALUE klass, VALUE number ) {
 	// Creates pointers to self's and the result's mpz_t structures
-	mpz_t *r = malloc(sizeof(*r));
+	mpz_t *r;
+	VALUE result = integer_create(&r);
 	mpz_t *n;
 	
 	// Loads self into *n
-	Data_Get_Struct(number, mpz_t, n);
-	
-	// Inits the result
-	mpz_init(*r);
+	TypedData_Get_Struct(number, mpz_t, &integer_type, n);
 	
 	// Checks if the number is positive, raising an exception if not
 	if (mpz_sgn(*n) == -1)
@@ -1705,7 +2768,7 @@ z_sqrt_singleton( VALUE klass, VALUE number ) {
 	// Takes the floor of the square root
 	mpz_sqrt(*r, *n);
 	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
+	return result;
 }
 
 // Nth root
@@ -1715,12 +2778,13 @@ z_root_singleton( VALUE klass, VALUE number, VALUE degree ) {
 	// Creates pointers to number's and the result's mpz_t structures
 	// Also, creates the degree placeholder
 	unsigned long longDegree;
-	mpz_t *r = malloc(sizeof(*r));
+	mpz_t *r;
+	VALUE result = integer_create(&r);
 	mpz_t *n;
 	
 	// Copies back the mpz_t pointer wrapped in a ruby data object
 	// as well as the root value
-	Data_Get_Struct(number, mpz_t, n);
+	TypedData_Get_Struct(number, mpz_t, &integer_type, n);
 	longDegree = FIX2LONG(degree);
 	
 	// If the degree is zero, GMP will normally give a floating point error
@@ -1733,12 +2797,9 @@ z_root_singleton( VALUE klass, VALUE number, VALUE degree ) {
 	if (mpz_sgn(*n) == -1 && longDegree % 2 == 0)
 		rb_raise(rb_eRuntimeError, "number is negative, but degree is even");
 	
-	// Inits the result
-	mpz_init(*r);
-	
 	mpz_root(*r, *n, longDegree);
 	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
+	return result;
 }
 
 // Fibonacci numbers generator
@@ -1747,18 +2808,24 @@ VALUE
 z_fibonacci_singleton( VALUE klass, VALUE index ) {
 	// Creates pointer to the result's mpz_t structure, and loads
 	// creates a placeholder for the index
-	mpz_t *r = malloc(sizeof(*r));
+	mpz_t *r;
+	VALUE result = integer_create(&r);
 	unsigned long longIndex;
 	
 	// Loads the index into a long
 	longIndex = FIX2LONG(index);
 	
-	// Inits the result
-	mpz_init(*r);
-	
-	mpz_fib_ui(*r, longIndex);
+	// F(n) has about 0.69*n bits
+	if (RGMP_NOGVL(longIndex / 92)) {
+		z_kernel k;
+		z_kernel_init(&k, z_run_fib);
+		k.n = longIndex;
+		z_kernel_call(&k, *r);
+	} else {
+		mpz_fib_ui(*r, longIndex);
+	}
 	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
+	return result;
 }
 
 // Fibonacci pairs generator
@@ -1766,23 +2833,17 @@ z_fibonacci_singleton( VALUE klass, VALUE index ) {
 VALUE
 z_fibonacci2_singleton( VALUE klass, VALUE index ) {
 	// Creates placeholders for the two results
-	mpz_t *x = malloc(sizeof(*x));
-	mpz_t *y = malloc(sizeof(*y));
+	mpz_t *x;
+	VALUE rx = integer_create(&x);
+	mpz_t *y;
+	VALUE ry = integer_create(&y);
 	
 	// Loads the index into a long
 	unsigned long longIndex = FIX2LONG(index);
 	
-	// Inits both results
-	mpz_init(*x);
-	mpz_init(*y);
-	
 	// Does the calculation
 	mpz_fib2_ui(*x, *y, longIndex);
 	
-	// Converts the results into Ruby data objects
-	VALUE rx = Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, x);
-	VALUE ry = Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, y);
-	
 	return rb_ary_new3(2, ry, rx);
 }
 
@@ -1792,18 +2853,24 @@ VALUE
 z_lucas_singleton( VALUE klass, VALUE index ) {
 	// Creates pointer to the result's mpz_t structure, and loads
 	// creates a placeholder for the index
-	mpz_t *r = malloc(sizeof(*r));
+	mpz_t *r;
+	VALUE result = integer_create(&r);
 	unsigned long longIndex;
 	
 	// Loads the index into a long
 	longIndex = FIX2LONG(index);
 	
-	// Inits the result
-	mpz_init(*r);
-	
-	mpz_lucnum_ui(*r, longIndex);
+	// L(n) has about 0.69*n bits too
+	if (RGMP_NOGVL(longIndex / 92)) {
+		z_kernel k;
+		z_kernel_init(&k, z_run_lucnum);
+		k.n = longIndex;
+		z_kernel_call(&k, *r);
+	} else {
+		mpz_lucnum_ui(*r, longIndex);
+	}
 	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
+	return result;
 }
 
 // Lucas pairs generator
@@ -1811,77 +2878,132 @@ z_lucas_singleton( VALUE klass, VALUE index ) {
 VALUE
 z_lucas2_singleton( VALUE klass, VALUE index ) {
 	// Creates placeholders for the two results
-	mpz_t *x = malloc(sizeof(*x));
-	mpz_t *y = malloc(sizeof(*y));
+	mpz_t *x;
+	VALUE rx = integer_create(&x);
+	mpz_t *y;
+	VALUE ry = integer_create(&y);
 	
 	// Loads the index into a long
 	unsigned long longIndex = FIX2LONG(index);
 	
-	// Inits both results
-	mpz_init(*x);
-	mpz_init(*y);
-	
 	// Does the calculation
 	mpz_lucnum2_ui(*x, *y, longIndex);
 	
-	// Converts the results into Ruby data objects
-	VALUE rx = Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, x);
-	VALUE ry = Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, y);
-	
 	return rb_ary_new3(2, ry, rx);
 }
 
 // Factorial (n!)
-// {Fixnum} -> {GMP::Integer}
+// {Fixnum}, threads: {Fixnum} -> {GMP::Integer}
+// Results of at least GMP.parallel_threshold limbs are computed on
+// GMP.threads threads unless told otherwise
 VALUE
-z_factorial_singleton( VALUE klass, VALUE number ) {
+z_factorial_singleton( int argc, VALUE *argv, VALUE klass ) {
+	VALUE number, options;
+	rb_scan_args(argc, argv, "1:", &number, &options);
+	
+	if (!FIXNUM_P(number) || FIX2LONG(number) < 0)
+		rb_raise(rb_eRangeError, "n must be a non-negative Fixnum");
+	if ((unsigned long) FIX2LONG(number) > FAC_MAX)
+		rb_raise(rb_eRangeError, "n is too large");
+	
 	// Creates pointer to the result's mpz_t structure, and loads
 	// creates a placeholder for the number
-	mpz_t *r = malloc(sizeof(*r));
+	mpz_t *r;
+	VALUE result = integer_create(&r);
 	unsigned long longNumber;
 	
 	// Loads the number into a long
 	longNumber = FIX2LONG(number);
 	
-	// Inits the result
-	mpz_init(*r);
-	
-	mpz_fac_ui(*r, longNumber);
+	size_t work = z_factorial_work(longNumber);
+	unsigned threads = rgmp_threads_option(options, (work >= parallel_threshold) ? rgmp_threads : 1);
+	
+	if (threads > 1 && longNumber <= Z_SIEVE_LIMIT) {
+		z_kernel k;
+		z_kernel_init(&k, z_run_fac_parallel);
+		k.n = longNumber;
+		k.threads = threads;
+		z_kernel_call(&k, *r);
+	} else if (RGMP_NOGVL(work)) {
+		z_kernel k;
+		z_kernel_init(&k, z_run_fac);
+		k.n = longNumber;
+		z_kernel_call(&k, *r);
+	} else {
+		mpz_fac_ui(*r, longNumber);
+	}
 	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
+	return result;
 }
 
 // Binomial coefficient/Combination (combinatorics)
-// {GMP::Integer}, {Fixnum} -> {GMP::Integer}
+// {GMP::Integer, Fixnum}, {Fixnum}, threads: {Fixnum} -> {GMP::Integer}
 // TODO: check whether N and K have names
 VALUE
-z_binomial_singleton( VALUE klass, VALUE n, VALUE k ) {
+z_binomial_singleton( int argc, VALUE *argv, VALUE klass ) {
+	VALUE n, k, options;
+	rb_scan_args(argc, argv, "2:", &n, &k, &options);
+	
 	// Checks whether k has a valid type
 	if (TYPE(k) != T_FIXNUM)
 		rb_raise(rb_eTypeError, "k is not of a supported data type");
 	
+	// Zero until the size of the result is known
+	unsigned threads = rgmp_threads_option(options, 0);
+	
 	// Creates pointer to the result's mpz_t structure, and loads
 	// creates a placeholder for the number
-	mpz_t *r = malloc(sizeof(*r));
+	mpz_t *r;
+	VALUE result = integer_create(&r);
 	unsigned long longK;
 	
 	// Loads the number into a long
 	longK = FIX2LONG(k);
 	
-	// Inits the result
-	mpz_init(*r);
-	
 	// Decides what to do based on n's type
 	switch (TYPE(n)) {
 		case T_DATA: {
 			mpz_t *sd;
-			Data_Get_Struct(n, mpz_t, sd);
-			mpz_bin_ui(*r, *sd, longK);
+			TypedData_Get_Struct(n, mpz_t, &integer_type, sd);
+			
+			// bin(n, k) has at most k*log2(n) bits
+			if (RGMP_NOGVL(work_product(mpz_size(*sd), longK))) {
+				z_kernel k;
+				z_kernel_init(&k, z_run_bin);
+				k.k = longK;
+				mpz_set(k.a, *sd);
+				RGMP_COUNT(STAT_TEMPORARIES, 1);
+				z_kernel_call(&k, *r);
+			} else {
+				mpz_bin_ui(*r, *sd, longK);
+			}
 			break;
 		}
 		case T_FIXNUM: {
 			unsigned long sl = FIX2LONG(n);
-			mpz_bin_uiui(*r, sl, longK);
+			
+			// Only min(k, n - k) factors are actually multiplied
+			unsigned long factors = (longK <= sl / 2) ? longK : sl - longK;
+			size_t work = (longK <= sl) ? z_factorial_work(factors) : 0;
+			if (threads == 0)
+				threads = (work >= parallel_threshold) ? rgmp_threads : 1;
+			
+			if (threads > 1 && longK <= sl && sl <= Z_SIEVE_LIMIT) {
+				z_kernel k;
+				z_kernel_init(&k, z_run_bin_parallel);
+				k.n = sl;
+				k.k = longK;
+				k.threads = threads;
+				z_kernel_call(&k, *r);
+			} else if (RGMP_NOGVL(work)) {
+				z_kernel k;
+				z_kernel_init(&k, z_run_bin_uiui);
+				k.n = sl;
+				k.k = longK;
+				z_kernel_call(&k, *r);
+			} else {
+				mpz_bin_uiui(*r, sl, longK);
+			}
 			break;
 		}
 		default: {
@@ -1889,7 +3011,43 @@ z_binomial_singleton( VALUE klass, VALUE n, VALUE k ) {
 		}
 	}
 	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
+	return result;
+}
+
+// Primorial (product of all primes up to n)
+// {Fixnum}, threads: {Fixnum} -> {GMP::Integer}
+VALUE
+z_primorial_singleton( int argc, VALUE *argv, VALUE klass ) {
+	VALUE number, options;
+	rb_scan_args(argc, argv, "1:", &number, &options);
+	
+	if (!FIXNUM_P(number) || FIX2LONG(number) < 0)
+		rb_raise(rb_eRangeError, "n must be a non-negative Fixnum");
+	
+	mpz_t *r;
+	VALUE result = integer_create(&r);
+	unsigned long longNumber = FIX2LONG(number);
+	
+	// n# has about 1.44n bits
+	size_t work = longNumber / 44;
+	unsigned threads = rgmp_threads_option(options, (work >= parallel_threshold) ? rgmp_threads : 1);
+	
+	if (threads > 1 && longNumber <= Z_SIEVE_LIMIT) {
+		z_kernel k;
+		z_kernel_init(&k, z_run_primorial_parallel);
+		k.n = longNumber;
+		k.threads = threads;
+		z_kernel_call(&k, *r);
+	} else if (RGMP_NOGVL(work)) {
+		z_kernel k;
+		z_kernel_init(&k, z_run_primorial);
+		k.n = longNumber;
+		z_kernel_call(&k, *r);
+	} else {
+		mpz_primorial_ui(*r, longNumber);
+	}
+	
+	return result;
 }
 
 // Factor removal (divides exhaustively by one factor until no longer possible)
@@ -1899,54 +3057,51 @@ VALUE
 z_remove_singleton( VALUE klass, VALUE number, VALUE factor ) {
 	// Creates pointers to the number's, factor's and result's mpz_t
 	// structures
-	mpz_t *r = malloc(sizeof(*r));
+	mpz_t *r;
+	VALUE result = integer_create(&r);
 	mpz_t *n, *f;
 	
 	// Copies back the mpz_t pointers wrapped in ruby data objects
-	Data_Get_Struct(number, mpz_t, n);
-	Data_Get_Struct(factor, mpz_t, f);
+	TypedData_Get_Struct(number, mpz_t, &integer_type, n);
+	TypedData_Get_Struct(factor, mpz_t, &integer_type, f);
 	
 	if (mpz_cmp_ui(*f, 1) <= 0)
 		rb_raise(rb_eRangeError, "factor must be bigger than 1");
 	
-	// Inits the result
-	mpz_init(*r);
-	
 	mpz_remove(*r, *n, *f);
 	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
+	return result;
 }
 
 // Comparison of absolutes
-// {GMP::Integer}, {GMP::Integer, Fixnum} -> {Fixnum}
+// {GMP::Integer}, {GMP::Integer, Fixnum, Bignum} -> {Fixnum}
 VALUE
 z_comp_abs_singleton( VALUE klass, VALUE number, VALUE other ) {
 	// Creates pointers to the number's mpz_t structures
 	// Also creates the int placeholder for the result
-	// TODO: check whether all these declarations without immediate
-	// attributions give a performance penalty
 	mpz_t *n;
 	int result;
 	
 	// Copies back the mpz_t pointer wrapped in a ruby data object
-	Data_Get_Struct(number, mpz_t, n);
+	TypedData_Get_Struct(number, mpz_t, &integer_type, n);
 	
-	switch (TYPE(other)) {
-		case T_DATA: {
-			if (rb_obj_class(other) == cGMPInteger) {
-				// Creates and loads the mpz_t structure for other
-				mpz_t *od;
-				Data_Get_Struct(other, mpz_t, od);
-				result = mpz_cmpabs(*n, *od);
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
+	switch (operand_kind(other)) {
+		case OPERAND_INTEGER: {
+			result = mpz_cmpabs(*n, MPZ_OF(other));
 			break;
 		}
-		case T_FIXNUM: {
-			// Loads other into an unsigned long
-			unsigned long ol = FIX2LONG(other);
-			result = mpz_cmpabs_ui(*n, ol);
+		case OPERAND_FIXNUM: {
+			long ol = FIX2LONG(other);
+			result = mpz_cmpabs_ui(*n, (ol > 0) ? (unsigned long) ol : -(unsigned long) ol);
+			break;
+		}
+		case OPERAND_BIGNUM: {
+			mpz_t tempBig;
+			mpz_init(tempBig);
+			RGMP_COUNT(STAT_TEMPORARIES, 1);
+			num2mpz(tempBig, other);
+			result = mpz_cmpabs(*n, tempBig);
+			mpz_clear(tempBig);
 			break;
 		}
 		default: {
@@ -1954,7 +3109,7 @@ z_comp_abs_singleton( VALUE klass, VALUE number, VALUE other ) {
 		}
 	}
 	
-	return INT2FIX(result);
+	return INT2FIX((result > 0) - (result < 0));
 }
 
 // Inversion (number theory; a*ã == 1 (mod m))
@@ -1965,101 +3120,35 @@ z_invert_singleton( VALUE klass, VALUE number, VALUE base ) {
 	// structures
 	// Also creates an int which will be used to check if the number has an
 	// inverse on that base
-	mpz_t *r = malloc(sizeof(*r));
+	mpz_t *r;
+	VALUE result = integer_create(&r);
 	mpz_t *n, *b;
 	int check;
 	
 	// Copies back the mpz_t pointers wrapped in ruby data objects
-	Data_Get_Struct(number, mpz_t, n);
-	Data_Get_Struct(base, mpz_t, b);
-	
-	// Inits the result
-	mpz_init(*r);
+	TypedData_Get_Struct(number, mpz_t, &integer_type, n);
+	TypedData_Get_Struct(base, mpz_t, &integer_type, b);
 	
 	check = mpz_invert(*r, *n, *b);
 	
 	if (check == 0)
 		rb_raise(rb_eRuntimeError, "input is not invertible on this base");
 	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
+	return result;
 }
 
 // Least common multiple
-// {GMP::Integer}, {GMP::Integer, Fixnum} -> {GMP::Integer}
+// {GMP::Integer}, {GMP::Integer, Fixnum, Bignum} -> {GMP::Integer}
 VALUE
 z_lcm_singleton( VALUE klass, VALUE number, VALUE other ) {
-	// Creates pointers to self's and the result's mpz_t structures
-	mpz_t *r = malloc(sizeof(*r));
-	mpz_t *n;
-	
-	// Loads self into *n
-	Data_Get_Struct(number, mpz_t, n);
-	
-	// Inits the result
-	mpz_init(*r);
-	
-	// Decides what to do based on other's type/class
-	switch (TYPE(other)) {
-		case T_DATA: {
-			if (rb_obj_class(other) == cGMPInteger) {
-				mpz_t *od;
-				Data_Get_Struct(other, mpz_t, od);
-				mpz_lcm(*r, *n, *od);
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
-			break;
-		}
-		case T_FIXNUM: {
-			unsigned long ol = FIX2LONG(other);
-			mpz_lcm_ui(*r, *n, ol);
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "input data type not supported");
-		}
-	}
-	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
+	return z_binary_operation(number, other, &z_lcm_op);
 }
 
 // Greatest common divisor
-// {GMP::Integer}, {GMP::Integer} -> {GMP::Integer}
+// {GMP::Integer}, {GMP::Integer, Fixnum, Bignum} -> {GMP::Integer}
 VALUE
 z_gcd_singleton( VALUE klass, VALUE number, VALUE other ) {
-	// Creates pointers to self's and the result's mpz_t structures
-	mpz_t *r = malloc(sizeof(*r));
-	mpz_t *n;
-	
-	// Loads self into *n
-	Data_Get_Struct(number, mpz_t, n);
-	
-	// Inits the result
-	mpz_init(*r);
-	
-	// Decides what to do based on other's type/class
-	switch (TYPE(other)) {
-		case T_DATA: {
-			if (rb_obj_class(other) == cGMPInteger) {
-				mpz_t *od;
-				Data_Get_Struct(other, mpz_t, od);
-				mpz_gcd(*r, *n, *od);
-			} else {
-				rb_raise(rb_eTypeError, "input data type not supported");
-			}
-			break;
-		}
-		case T_FIXNUM: {
-			unsigned long ol = FIX2LONG(other);
-			mpz_gcd_ui(*r, *n, ol);
-			break;
-		}
-		default: {
-			rb_raise(rb_eTypeError, "input data type not supported");
-		}
-	}
-	
-	return Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, r);
+	return z_binary_operation(number, other, &z_gcd_op);
 }
 
 // Jacobi symbol
@@ -2072,8 +3161,8 @@ z_jacobi_singleton( VALUE klass, VALUE a, VALUE b ) {
 	int result;
 	
 	// Copies back the mpz_t pointers wrapped in ruby data objects
-	Data_Get_Struct(a, mpz_t, az);
-	Data_Get_Struct(b, mpz_t, bz);
+	TypedData_Get_Struct(a, mpz_t, &integer_type, az);
+	TypedData_Get_Struct(b, mpz_t, &integer_type, bz);
 	
 	// Not sure if this is necessary, and it probably adds a little overhead
 	// GMP does not complain if the following is not the case
@@ -2096,8 +3185,8 @@ z_kronecker( VALUE klass, VALUE a, VALUE b ) {
 	int result;
 	
 	// Copies back the mpz_t pointers wrapped in ruby data objects
-	Data_Get_Struct(a, mpz_t, az);
-	Data_Get_Struct(b, mpz_t, bz);
+	TypedData_Get_Struct(a, mpz_t, &integer_type, az);
+	TypedData_Get_Struct(b, mpz_t, &integer_type, bz);
 	
 	result = mpz_kronecker(*az, *bz);
 	
@@ -2109,35 +3198,896 @@ z_kronecker( VALUE klass, VALUE a, VALUE b ) {
 VALUE
 z_extended_gcd( VALUE klass, VALUE a, VALUE b ) {
 	// Creates pointers to a's, b's, and the results' structures.
-	mpz_t *g = malloc(sizeof(*g));
-	mpz_t *s = malloc(sizeof(*s));
-	mpz_t *t = malloc(sizeof(*t));
+	mpz_t *g;
+	VALUE rg = integer_create(&g);
+	mpz_t *s;
+	VALUE rs = integer_create(&s);
+	mpz_t *t;
+	VALUE rt = integer_create(&t);
 	mpz_t *ma, *mb;
 	
 	// Loads a and b
-	Data_Get_Struct(a, mpz_t, ma);
-	Data_Get_Struct(b, mpz_t, mb);
-	
-	// Inits the results
-	mpz_init(*t);
-	mpz_init(*s);
-	mpz_init(*g);
+	TypedData_Get_Struct(a, mpz_t, &integer_type, ma);
+	TypedData_Get_Struct(b, mpz_t, &integer_type, mb);
 	
 	// Does the calculation
 	mpz_gcdext(*g, *s, *t, *ma, *mb);
 	
-	// Wraps ther esults into Ruby objects
-	VALUE rt = Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, t);
-	VALUE rs = Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, s);
-	VALUE rg = Data_Wrap_Struct(cGMPInteger, integer_mark, integer_free, g);
-	
 	return rb_ary_new3(3, rg, rs, rt);
 }
+
+// Multiplication on several threads, whatever GMP.parallel_threshold says
+// {GMP::Integer, Fixnum, Bignum}, {GMP::Integer, Fixnum, Bignum}, threads: {Fixnum} -> {GMP::Integer}
+VALUE
+z_parallel_mul_singleton( int argc, VALUE *argv, VALUE klass ) {
+	VALUE a, b, options;
+	rb_scan_args(argc, argv, "2:", &a, &b, &options);
+	unsigned threads = rgmp_threads_option(options, rgmp_threads);
+	
+	enum operand_kind ka = operand_kind(a), kb = operand_kind(b);
+	if (ka != OPERAND_INTEGER && ka != OPERAND_FIXNUM && ka != OPERAND_BIGNUM)
+		rb_raise(rb_eTypeError, "first operand is not of a supported data type");
+	if (kb != OPERAND_INTEGER && kb != OPERAND_FIXNUM && kb != OPERAND_BIGNUM)
+		rb_raise(rb_eTypeError, "second operand is not of a supported data type");
+	
+	mpz_t *r;
+	VALUE result = integer_create(&r);
+	
+	z_kernel k;
+	z_kernel_init(&k, z_run_parallel_mul);
+	k.threads = threads;
+	integral2mpz(k.a, a);
+	integral2mpz(k.b, b);
+	RGMP_COUNT(STAT_TEMPORARIES, 2);
+	z_kernel_call(&k, *r);
+	
+	return result;
+}
+
+// Copies the elements of the Array, followed by extra scratch integers
+void
+z_items_load( z_items *z, long extra ) {
+	long length = RARRAY_LEN(z->array);
+	
+	z->items = ALLOC_N(mpz_t, length + extra);
+	for (long i = 0; i < length; i++) {
+		mpz_init(z->items[i]);
+		z->count++;
+		integral2mpz(z->items[i], rb_ary_entry(z->array, i));
+	}
+	for (long i = 0; i < extra; i++) {
+		mpz_init(z->items[length + i]);
+		z->count++;
+	}
+	RGMP_COUNT(STAT_TEMPORARIES, length + extra);
+}
+
+static VALUE
+z_items_product( VALUE p ) {
+	z_items *z = (z_items *) p;
+	z_items_load(z, 0);
+	z_product_tree(z->r, z->items, z->count, z->threads);
+	return Qnil;
+}
+
+// Montgomery's trick: with c(i) = a(0) * ... * a(i), a single inversion of
+// c(n-1) gives every 1/a(i) = c(i-1) / c(i), walking back down the prefix
+// products, for 3(n - 1) multiplications. z->r holds the modulus, and the
+// prefix products are kept in the result objects themselves.
+static VALUE
+z_items_invert( VALUE p ) {
+	z_items *z = (z_items *) p;
+	z_items_load(z, 2);
+	
+	long n = (long) z->count - 2;
+	mpz_ptr m = z->r, inverse = z->items[n], t = z->items[n + 1];
+	VALUE results = rb_ary_new_capa(n);
+	
+	for (long i = 0; i < n; i++) {
+		mpz_t *c;
+		rb_ary_push(results, integer_create(&c));
+		mpz_mod(z->items[i], z->items[i], m);
+		
+		if (i == 0) {
+			mpz_set(*c, z->items[0]);
+		} else {
+			mpz_mul(t, MPZ_OF(RARRAY_AREF(results, i - 1)), z->items[i]);
+			mpz_tdiv_r(*c, t, m);
+		}
+	}
+	if (n == 0)
+		return results;
+	
+	// Only non-invertible elements make the whole product non-invertible
+	if (!mpz_invert(inverse, MPZ_OF(RARRAY_AREF(results, n - 1)), m)) {
+		for (long i = 0; i < n; i++) {
+			mpz_gcd(t, z->items[i], m);
+			if (mpz_cmp_ui(t, 1) != 0)
+				rb_raise(rb_eRuntimeError, "element %ld is not invertible on this base", i);
+		}
+	}
+	
+	for (long i = n - 1; i > 0; i--) {
+		mpz_ptr c = MPZ_OF(RARRAY_AREF(results, i));
+		mpz_mul(t, inverse, MPZ_OF(RARRAY_AREF(results, i - 1)));
+		mpz_tdiv_r(c, t, m);
+		mpz_mul(t, inverse, z->items[i]);
+		mpz_tdiv_r(inverse, t, m);
+	}
+	mpz_set(MPZ_OF(RARRAY_AREF(results, 0)), inverse);
+	
+	return results;
+}
+
+VALUE
+z_items_free( VALUE p ) {
+	z_items *z = (z_items *) p;
+	for (size_t i = 0; i < z->count; i++)
+		mpz_clear(z->items[i]);
+	xfree(z->items);
+	return Qnil;
+}
+
+// The private copies of the pairs of a multi_powermod, freed by
+// z_pairs_free even when loading or evaluating them raises
+typedef struct {
+	VALUE pairs, base;
+	mpz_t *items;		// bases, exponents, then the modulus
+	size_t count;		// items initialized so far
+	mpz_ptr r;
+} z_pairs;
+
+static VALUE
+z_pairs_powm( VALUE p ) {
+	z_pairs *z = (z_pairs *) p;
+	size_t n = RARRAY_LEN(z->pairs);
+	
+	z->items = ALLOC_N(mpz_t, 2 * n + 1);
+	for (size_t i = 0; i < 2 * n + 1; i++) {
+		mpz_init(z->items[i]);
+		z->count++;
+	}
+	RGMP_COUNT(STAT_TEMPORARIES, 2 * n + 1);
+	mpz_t *bases = z->items, *exps = z->items + n;
+	mpz_ptr m = z->items[2 * n];
+	
+	integral2mpz(m, z->base);
+	mpz_abs(m, m);
+	if (mpz_sgn(m) == 0)
+		rb_raise(rb_eZeroDivError, "base cannot be zero");
+	
+	size_t work = 0;
+	for (size_t i = 0; i < n; i++) {
+		VALUE pair = rb_ary_entry(z->pairs, i);
+		if (!RB_TYPE_P(pair, T_ARRAY) || RARRAY_LEN(pair) != 2)
+			rb_raise(rb_eArgError, "pairs must be [base, exponent] Arrays");
+		integral2mpz(bases[i], rb_ary_entry(pair, 0));
+		integral2mpz(exps[i], rb_ary_entry(pair, 1));
+		
+		// Negative exponents raise the inverse instead
+		if (mpz_sgn(exps[i]) < 0) {
+			if (!mpz_invert(bases[i], bases[i], m))
+				rb_raise(rb_eRuntimeError, "input is not invertible on this base");
+			mpz_neg(exps[i], exps[i]);
+		}
+		mpz_mod(bases[i], bases[i], m);
+		work += mpz_size(exps[i]);
+	}
+	
+	if (RGMP_NOGVL(work_product(mpz_size(m), work))) {
+		z_kernel k;
+		z_kernel_init(&k, z_run_multi_powm);
+		mpz_set(k.m, m);
+		k.items = z->items;
+		k.count = n;
+		RGMP_COUNT(STAT_TEMPORARIES, 1);
+		z_kernel_call(&k, z->r);
+	} else {
+		rgmp_checkpoint cp = { 0 };
+		mpz_t t;
+		mpz_init(t);
+		RGMP_COUNT(STAT_TEMPORARIES, 1);
+		int done = z_multi_powm(z->r, bases, exps, n, m, t, &cp);
+		mpz_clear(t);
+		if (!done)
+			rb_memerror();
+	}
+	return Qnil;
+}
+
+static VALUE
+z_pairs_free( VALUE p ) {
+	z_pairs *z = (z_pairs *) p;
+	for (size_t i = 0; i < z->count; i++)
+		mpz_clear(z->items[i]);
+	xfree(z->items);
+	return Qnil;
+}
+
+// Product of modular powers, a^x * b^y * ... mod base, sharing the squarings
+// {Array <[{GMP::Integer, Fixnum, Bignum}, {GMP::Integer, Fixnum, Bignum}]>}, {GMP::Integer, Fixnum, Bignum} -> {GMP::Integer}
+VALUE
+z_multi_powermod_singleton( VALUE klass, VALUE pairs, VALUE base ) {
+	Check_Type(pairs, T_ARRAY);
+	
+	mpz_t *r;
+	VALUE result = integer_create(&r);
+	
+	z_pairs z = { pairs, base, NULL, 0, *r };
+	rb_ensure(z_pairs_powm, (VALUE) &z, z_pairs_free, (VALUE) &z);
+	
+	return result;
+}
+
+// Product of an Array, as a balanced product tree
+// {Array <GMP::Integer, Fixnum, Bignum>}, threads: {Fixnum} -> {GMP::Integer}
+VALUE
+z_product_singleton( int argc, VALUE *argv, VALUE klass ) {
+	VALUE array, options;
+	rb_scan_args(argc, argv, "1:", &array, &options);
+	Check_Type(array, T_ARRAY);
+	
+	mpz_t *r;
+	VALUE result = integer_create(&r);
+	
+	z_items z = { array, NULL, 0, *r, rgmp_threads_option(options, 0) };
+	rb_ensure(z_items_product, (VALUE) &z, z_items_free, (VALUE) &z);
+	
+	return result;
+}
+
+// Inverses of every element of an Array modulo the same base, for the cost of
+// a single inversion and 3(n - 1) modular multiplications
+// {Array <GMP::Integer, Fixnum, Bignum>}, {GMP::Integer, Fixnum, Bignum} -> {Array <GMP::Integer>}
+VALUE
+z_batch_invert_singleton( VALUE klass, VALUE array, VALUE base ) {
+	Check_Type(array, T_ARRAY);
+	
+	// The modulus lives in a GMP::Integer of its own, so that it is freed
+	// with it whatever raises
+	mpz_t *m;
+	VALUE modulus = integer_create(&m);
+	integral2mpz(*m, base);
+	mpz_abs(*m, *m);
+	if (mpz_sgn(*m) == 0)
+		rb_raise(rb_eZeroDivError, "base cannot be zero");
+	
+	z_items z = { array, NULL, 0, *m, 1 };
+	VALUE results = rb_ensure(z_items_invert, (VALUE) &z, z_items_free, (VALUE) &z);
+	
+	RB_GC_GUARD(modulus);
+	return results;
+}
+
+// Bernstein's batch gcd: with P the product of all moduli, gcd(N, P / N) is
+// gcd((P mod N^2) / N, N), and the remainder tree gives every P mod N^2
+typedef struct {
+	z_items z;			// the moduli, followed by their gcds
+	size_t n;
+	z_tree tree;
+	char *spill;
+	rgmp_checkpoint cp;
+} z_batch_gcd;
+
+static void
+z_batch_gcd_leaf( void *data, size_t i ) {
+	z_batch_gcd *b = data;
+	mpz_ptr g = b->z.items[b->n + i], N = b->z.items[i];
+	mpz_divexact(g, g, N);
+	mpz_gcd(g, g, N);
+}
+
+static void *
+z_batch_gcd_nogvl( void *p ) {
+	z_batch_gcd *b = p;
+	z_tree *T = &b->tree;
+	
+	z_tree_build(T, b->z.items, b->n);
+	if (!T->error && !rgmp_stopped(&b->cp))
+		z_tree_remainders(T, T->level[T->height - 1].nodes[0], b->z.items + b->n, 1);
+	if (!T->error && !rgmp_stopped(&b->cp))
+		rgmp_parallel_for(b->n, T->threads, z_batch_gcd_leaf, b, &b->cp);
+	return NULL;
+}
+
+static VALUE
+z_batch_gcd_run( VALUE p ) {
+	z_batch_gcd *b = (z_batch_gcd *) p;
+	z_items_load(&b->z, RARRAY_LEN(b->z.array));
+	b->n = b->z.count / 2;
+	
+	size_t work = 0;
+	for (size_t i = 0; i < b->n; i++) {
+		mpz_abs(b->z.items[i], b->z.items[i]);
+		if (mpz_sgn(b->z.items[i]) == 0)
+			rb_raise(rb_eRangeError, "moduli cannot be zero");
+		work += mpz_size(b->z.items[i]);
+	}
+	
+	VALUE results = rb_ary_new_capa(b->n);
+	if (b->n == 0)
+		return results;
+	
+	b->tree.spill = b->spill;
+	z_tree_call(&b->tree, work, z_batch_gcd_nogvl, b, &b->cp);
+	
+	for (size_t i = 0; i < b->n; i++) {
+		mpz_t *g;
+		rb_ary_push(results, integer_create(&g));
+		mpz_swap(*g, b->z.items[b->n + i]);
+	}
+	return results;
+}
+
+static VALUE
+z_batch_gcd_free( VALUE p ) {
+	z_batch_gcd *b = (z_batch_gcd *) p;
+	z_tree_free(&b->tree);
+	xfree(b->spill);
+	return z_items_free((VALUE) &b->z);
+}
+
+// gcd of every modulus with the product of all the others, through product
+// and remainder trees instead of pairwise gcds; spill: names a directory to
+// write the tree levels to while they are not needed
+// {Array <GMP::Integer, Fixnum, Bignum>}, threads: {Fixnum}, spill: {String} -> {Array <GMP::Integer>}
+VALUE
+z_batch_gcd_singleton( int argc, VALUE *argv, VALUE klass ) {
+	VALUE array, options, spill;
+	rb_scan_args(argc, argv, "1:", &array, &options);
+	Check_Type(array, T_ARRAY);
+	
+	z_batch_gcd b;
+	memset(&b, 0, sizeof(b));
+	b.z.array = array;
+	b.tree.threads = rgmp_options(options, 0, "spill", &spill);
+	if (!NIL_P(spill)) {
+		FilePathValue(spill);
+		b.spill = ruby_strdup(StringValueCStr(spill));
+	}
+	
+	return rb_ensure(z_batch_gcd_run, (VALUE) &b, z_batch_gcd_free, (VALUE) &b);
+}
+
+// One number reduced modulo many, through the remainder tree of the moduli
+typedef struct {
+	z_items z;			// the moduli, their residues, then the number
+	size_t n;
+	VALUE number;
+	int packed;
+	z_tree tree;
+	rgmp_checkpoint cp;
+} z_mod_many;
+
+static void *
+z_mod_many_nogvl( void *p ) {
+	z_mod_many *b = p;
+	z_tree *T = &b->tree;
+	
+	z_tree_build(T, b->z.items, b->n);
+	if (!T->error && !rgmp_stopped(&b->cp))
+		z_tree_remainders(T, b->z.items[2 * b->n], b->z.items + b->n, 0);
+	return NULL;
+}
+
+static VALUE
+z_mod_many_run( VALUE p ) {
+	z_mod_many *b = (z_mod_many *) p;
+	z_items_load(&b->z, RARRAY_LEN(b->z.array) + 1);
+	b->n = (b->z.count - 1) / 2;
+	mpz_t *moduli = b->z.items, *residues = b->z.items + b->n;
+	mpz_ptr x = b->z.items[2 * b->n];
+	
+	size_t work = 0;
+	int fits = 1;
+	for (size_t i = 0; i < b->n; i++) {
+		mpz_abs(moduli[i], moduli[i]);
+		if (mpz_sgn(moduli[i]) == 0)
+			rb_raise(rb_eZeroDivError, "divided by 0");
+		work += mpz_size(moduli[i]);
+		fits = fits && mpz_fits_ulong_p(moduli[i]);
+	}
+	if (b->packed && !fits)
+		rb_raise(rb_eRangeError, "packed residues need moduli that fit in a machine word");
+	
+	// The tree reduces |x|; residues of a negative x are then m - r
+	integral2mpz(x, b->number);
+	int negative = (mpz_sgn(x) < 0);
+	mpz_abs(x, x);
+	if (b->n > 0)
+		z_tree_call(&b->tree, work + mpz_size(x), z_mod_many_nogvl, b, &b->cp);
+	for (size_t i = 0; i < b->n; i++) {
+		if (negative && mpz_sgn(residues[i]) != 0)
+			mpz_sub(residues[i], moduli[i], residues[i]);
+	}
+	
+	if (b->packed) {
+		VALUE packed = rb_str_new(NULL, b->n * sizeof(unsigned long));
+		unsigned long *words = (unsigned long *) RSTRING_PTR(packed);
+		for (size_t i = 0; i < b->n; i++)
+			words[i] = mpz_get_ui(residues[i]);
+		return packed;
+	}
+	
+	VALUE results = rb_ary_new_capa(b->n);
+	for (size_t i = 0; i < b->n; i++) {
+		mpz_t *r;
+		rb_ary_push(results, integer_create(&r));
+		mpz_swap(*r, residues[i]);
+	}
+	return results;
+}
+
+static VALUE
+z_mod_many_free( VALUE p ) {
+	z_mod_many *b = (z_mod_many *) p;
+	z_tree_free(&b->tree);
+	return z_items_free((VALUE) &b->z);
+}
+
+// number mod every modulus of an Array (non-negative, like %), through a
+// remainder tree instead of one division per modulus. packed: true returns
+// the residues as a String of native unsigned longs (see String#unpack's
+// "L!"), for moduli that fit in a machine word.
+// {GMP::Integer, Fixnum, Bignum}, {Array <GMP::Integer, Fixnum, Bignum>}, threads: {Fixnum}, packed: {TrueClass, FalseClass} -> {Array <GMP::Integer>, String}
+VALUE
+z_mod_many_singleton( int argc, VALUE *argv, VALUE klass ) {
+	VALUE number, array, options, packed;
+	rb_scan_args(argc, argv, "2:", &number, &array, &options);
+	Check_Type(array, T_ARRAY);
+	
+	z_mod_many b;
+	memset(&b, 0, sizeof(b));
+	b.z.array = array;
+	b.number = number;
+	b.tree.threads = rgmp_options(options, 0, "packed", &packed);
+	b.packed = RTEST(packed);
+	
+	return rb_ensure(z_mod_many_run, (VALUE) &b, z_mod_many_free, (VALUE) &b);
+}
+
+// Sum of an Array, into a single accumulator
+// {Array <GMP::Integer, Fixnum, Bignum>} -> {GMP::Integer}
+VALUE
+z_sum_singleton( VALUE klass, VALUE array ) {
+	Check_Type(array, T_ARRAY);
+	
+	mpz_t *r;
+	VALUE result = integer_create(&r);
+	
+	for (long i = 0; i < RARRAY_LEN(array); i++) {
+		VALUE element = rb_ary_entry(array, i);
+		
+		switch (operand_kind(element)) {
+			case OPERAND_INTEGER: {
+				mpz_add(*r, *r, MPZ_OF(element));
+				break;
+			}
+			case OPERAND_FIXNUM: {
+				long l = FIX2LONG(element);
+				if (l >= 0)
+					mpz_add_ui(*r, *r, l);
+				else
+					mpz_sub_ui(*r, *r, -(unsigned long) l);
+				break;
+			}
+			case OPERAND_BIGNUM: {
+				mpz_t tempBig;
+				mpz_init(tempBig);
+				RGMP_COUNT(STAT_TEMPORARIES, 1);
+				num2mpz(tempBig, element);
+				mpz_add(*r, *r, tempBig);
+				mpz_clear(tempBig);
+				break;
+			}
+			default: {
+				rb_raise(rb_eTypeError, "expected GMP::Integer or Integer, got %s", rb_obj_classname(element));
+			}
+		}
+	}
+	
+	return result;
+}
 //// end of singleton/class methods
 ////////////////////////////////////////////////////////////////////
 
 
 
+////////////////////////////////////////////////////////////////////
+//// Primality
+// Trial division by the odd primes below Z_TRIAL_LIMIT, grouped so that each
+// group's product fits in a word: a single mpz_fdiv_ui per group, then word
+// divisions, screen out most composites before any Miller-Rabin round.
+// Larger candidates make the rounds dearer, and are sieved further.
+// Z_TRIAL_LIMIT is defined in rgmp.h, as the prime sieve (gmpprimes.c)
+// relies on it too.
+static unsigned long z_sieve_primes[Z_TRIAL_LIMIT / 2];
+static unsigned long z_sieve_products[Z_TRIAL_LIMIT / 2];
+static size_t z_sieve_ends[Z_TRIAL_LIMIT / 2];	// one past each group's last prime
+static size_t z_sieve_groups;
+
+static void
+z_sieve_init( void ) {
+	char composite[Z_TRIAL_LIMIT] = { 0 };
+	size_t count = 0;
+	unsigned long product = 1;
+	
+	for (unsigned long p = 3; p < Z_TRIAL_LIMIT; p += 2) {
+		if (composite[p])
+			continue;
+		for (unsigned long q = p * p; q < Z_TRIAL_LIMIT; q += 2 * p)
+			composite[q] = 1;
+		
+		if (product > ULONG_MAX / p) {
+			z_sieve_products[z_sieve_groups] = product;
+			z_sieve_ends[z_sieve_groups++] = count;
+			product = 1;
+		}
+		product *= p;
+		z_sieve_primes[count++] = p;
+	}
+	z_sieve_products[z_sieve_groups] = product;
+	z_sieve_ends[z_sieve_groups++] = count;
+}
+
+// Trial division of n >= 0 by the odd primes up to about 4 * bits * limbs
+// (the cost of a round over that of a division by a group): 0 for a
+// composite (or n < 2), 2 for a prime (a small one, or any n without a
+// factor up to its square root), 1 when n is left for a probabilistic test
+static int
+z_trial_division( mpz_srcptr n ) {
+	if (mpz_cmp_ui(n, 2) < 0)
+		return 0;
+	if (mpz_even_p(n))
+		return mpz_cmp_ui(n, 2) == 0 ? 2 : 0;
+	
+	size_t bound = work_product(4 * mpz_sizeinbase(n, 2), mpz_size(n));
+	size_t first = 0;
+	unsigned long last = 2;
+	for (size_t g = 0; g < z_sieve_groups && last < bound; g++) {
+		unsigned long r = mpz_fdiv_ui(n, z_sieve_products[g]);
+		for (size_t i = first; i < z_sieve_ends[g]; i++) {
+			if (r % z_sieve_primes[i] == 0)
+				return mpz_cmp_ui(n, z_sieve_primes[i]) == 0 ? 2 : 0;
+		}
+		first = z_sieve_ends[g];
+		last = z_sieve_primes[first - 1];
+	}
+	return mpz_cmp_ui(n, last * last) <= 0 ? 2 : 1;
+}
+
+#ifdef Z_WORD_PRIMES
+// a * b / 2^64 mod n (Montgomery's reduction), for odd n and ninv = 1/n
+// mod 2^64: the low words of a * b and m * n cancel out, with m = ab * ninv
+static inline unsigned long
+z_mulredc_ui( unsigned long a, unsigned long b, unsigned long n, unsigned long ninv ) {
+	unsigned __int128 t = (unsigned __int128) a * b;
+	unsigned long m = (unsigned long) t * ninv;
+	unsigned long th = (unsigned long) (t >> 64), mh = (unsigned long) (((unsigned __int128) m * n) >> 64);
+	return (th >= mh) ? th - mh : th - mh + n;
+}
+
+// Deterministic Miller-Rabin for a word, on the bases of Jim Sinclair's set
+// (no strong pseudoprime to all of them below 2^64), without touching GMP.
+// Residues are kept multiplied by R = 2^64, so that products only need a
+// Montgomery reduction instead of a 128-bit division.
+int
+z_word_prime( unsigned long n ) {
+	static const unsigned long small[] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 };
+	static const unsigned long bases[] = { 2, 325, 9375, 28178, 450775, 9780504, 1795265022 };
+	
+	if (n < 2)
+		return 0;
+	for (size_t i = 0; i < sizeof(small) / sizeof(*small); i++) {
+		if (n % small[i] == 0)
+			return n == small[i];
+	}
+	if (n < 37 * 37)
+		return 1;
+	
+	unsigned long ninv = n;		// correct to 3 bits, doubling at each step
+	for (int i = 0; i < 5; i++)
+		ninv *= 2 - n * ninv;
+	unsigned long one = -n % n, minus_one = n - one;
+	
+	unsigned long d = n - 1;
+	int s = __builtin_ctzl(d);
+	d >>= s;
+	for (size_t i = 0; i < sizeof(bases) / sizeof(*bases); i++) {
+		unsigned long a = bases[i] % n, x = one;
+		if (a == 0)
+			continue;
+		a = (unsigned long) (((unsigned __int128) a << 64) % n);
+		for (unsigned long e = d; e; e >>= 1, a = z_mulredc_ui(a, a, n, ninv)) {
+			if (e & 1)
+				x = z_mulredc_ui(x, a, n, ninv);
+		}
+		
+		int r = 1;
+		if (x == one || x == minus_one)
+			continue;
+		for (; r < s; r++) {
+			x = z_mulredc_ui(x, x, n, ninv);
+			if (x == minus_one)
+				break;
+		}
+		if (r == s)
+			return 0;
+	}
+	return 1;
+}
+#endif
+
+// Strong Lucas probable prime test, with Selfridge's parameters: D the first
+// of 5, -7, 9, -11, ... with (D/n) = -1, P = 1 and Q = (1 - D) / 4. With
+// n + 1 = d * 2^s, n passes when U(d) = 0 or V(d * 2^r) = 0 for some r < s.
+// n must be odd, larger than Z_TRIAL_LIMIT and not a perfect square.
+static int
+z_strong_lucas( mpz_srcptr n ) {
+	long D = 5;
+	mpz_t t, d, U, V, Qk;
+	mpz_init(t);
+	for (;; D = (D > 0) ? -D - 2 : -D + 2) {
+		mpz_set_si(t, D);
+		if (mpz_jacobi(t, n) == -1)
+			break;
+	}
+	long Q = (1 - D) / 4;
+	
+	mpz_init(d);
+	mpz_init_set_ui(U, 1);
+	mpz_init_set_ui(V, 1);
+	mpz_init_set_si(Qk, Q);
+	mpz_add_ui(d, n, 1);
+	mp_bitcnt_t s = mpz_scan1(d, 0);
+	mpz_tdiv_q_2exp(d, d, s);
+	
+	// From (U(k), V(k), Q^k) for the leading bits k of d: U(2k) = U(k) V(k),
+	// V(2k) = V(k)^2 - 2 Q^k, then U(2k + 1) = (U(2k) + V(2k)) / 2 and
+	// V(2k + 1) = (D U(2k) + V(2k)) / 2 for a set bit
+	for (mp_bitcnt_t b = mpz_sizeinbase(d, 2) - 1; b-- > 0;) {
+		mpz_mul(U, U, V);
+		mpz_mod(U, U, n);
+		mpz_mul(V, V, V);
+		mpz_submul_ui(V, Qk, 2);
+		mpz_mod(V, V, n);
+		mpz_mul(Qk, Qk, Qk);
+		mpz_mod(Qk, Qk, n);
+		
+		if (mpz_tstbit(d, b)) {
+			mpz_mul_si(t, U, D);
+			mpz_add(U, U, V);
+			if (mpz_odd_p(U))
+				mpz_add(U, U, n);
+			mpz_tdiv_q_2exp(U, U, 1);
+			mpz_mod(U, U, n);
+			mpz_add(V, V, t);
+			if (mpz_odd_p(V))
+				mpz_add(V, V, n);
+			mpz_tdiv_q_2exp(V, V, 1);
+			mpz_mod(V, V, n);
+			mpz_mul_si(Qk, Qk, Q);
+			mpz_mod(Qk, Qk, n);
+		}
+	}
+	
+	int prime = (mpz_sgn(U) == 0 || mpz_sgn(V) == 0);
+	for (mp_bitcnt_t r = 1; r < s && !prime; r++) {
+		mpz_mul(V, V, V);
+		mpz_submul_ui(V, Qk, 2);
+		mpz_mod(V, V, n);
+		mpz_mul(Qk, Qk, Qk);
+		mpz_mod(Qk, Qk, n);
+		prime = (mpz_sgn(V) == 0);
+	}
+	
+	mpz_clear(t);
+	mpz_clear(d);
+	mpz_clear(U);
+	mpz_clear(V);
+	mpz_clear(Qk);
+	return prime;
+}
+
+// A strong base-2 Miller-Rabin round and a strong Lucas test on an odd
+// n > Z_TRIAL_LIMIT, already cleared of small factors
+int
+z_bpsw_test( mpz_srcptr n ) {
+	mpz_t d, x, n1;
+	mpz_init(d);
+	mpz_init(x);
+	mpz_init(n1);
+	mpz_sub_ui(n1, n, 1);
+	mp_bitcnt_t s = mpz_scan1(n1, 0);
+	mpz_tdiv_q_2exp(d, n1, s);
+	mpz_set_ui(x, 2);
+	mpz_powm(x, x, d, n);
+	
+	int prime = (mpz_cmp_ui(x, 1) == 0 || mpz_cmp(x, n1) == 0);
+	for (mp_bitcnt_t r = 1; r < s && !prime; r++) {
+		mpz_mul(x, x, x);
+		mpz_mod(x, x, n);
+		if (mpz_cmp_ui(x, 1) == 0)
+			break;
+		prime = (mpz_cmp(x, n1) == 0);
+	}
+	if (prime)
+		prime = !mpz_perfect_square_p(n) && z_strong_lucas(n);
+	
+	mpz_clear(d);
+	mpz_clear(x);
+	mpz_clear(n1);
+	return prime;
+}
+
+// Baillie-PSW on |n|: trial division, then z_bpsw_test. No composite passes
+// it below 2^64, where words take z_word_prime instead; none is known above.
+static int
+z_bpsw( mpz_srcptr n ) {
+	mpz_t view;
+	n = mpz_roinit_n(view, mpz_limbs_read(n), mpz_size(n));
+#ifdef Z_WORD_PRIMES
+	if (mpz_size(n) <= 1)
+		return z_word_prime(mpz_get_ui(n));
+#endif
+	
+	int result = z_trial_division(n);
+	return (result == 1) ? z_bpsw_test(n) : (result == 2);
+}
+
+typedef struct {
+	mpz_t n;
+	int prime;
+} z_bpsw_call;
+
+static void *
+z_bpsw_nogvl( void *p ) {
+	z_bpsw_call *c = p;
+	c->prime = z_bpsw(c->n);
+	return NULL;
+}
+
+// Baillie-PSW on n, on a private copy without the GVL when it is large
+static VALUE
+z_bpsw_value( mpz_srcptr n ) {
+	if (!RGMP_NOGVL(work_product(mpz_size(n), mpz_size(n))))
+		return z_bpsw(n) ? Qtrue : Qfalse;
+	
+	z_bpsw_call c;
+	rgmp_checkpoint cp = { 0 };
+	mpz_init_set(c.n, n);
+	RGMP_COUNT(STAT_TEMPORARIES, 1);
+	int state = rgmp_without_gvl(z_bpsw_nogvl, &c, &cp);
+	mpz_clear(c.n);
+	if (state)
+		rb_jump_tag(state);
+	return c.prime ? Qtrue : Qfalse;
+}
+
+// A batch of candidates: their private copies and one result byte each
+typedef struct {
+	z_items z;
+	int reps;
+	char *results;
+	unsigned threads;
+	rgmp_checkpoint cp;
+} z_primality;
+
+static void
+z_primality_task( void *data, size_t i ) {
+	z_primality *b = data;
+	mpz_t view;
+	mpz_srcptr n = mpz_roinit_n(view, mpz_limbs_read(b->z.items[i]), mpz_size(b->z.items[i]));
+	
+	int result = z_trial_division(n);
+	if (result == 1)
+		result = mpz_probab_prime_p(n, b->reps);
+	b->results[i] = (char) result;
+}
+
+static void *
+z_primality_nogvl( void *p ) {
+	z_primality *b = p;
+	rgmp_parallel_for(b->z.count, b->threads, z_primality_task, b, &b->cp);
+	return NULL;
+}
+
+static VALUE
+z_primality_run( VALUE p ) {
+	z_primality *b = (z_primality *) p;
+	z_items_load(&b->z, 0);
+	b->results = ALLOC_N(char, b->z.count);
+	
+	size_t work = 0;
+	for (size_t i = 0; i < b->z.count; i++) {
+		size_t size = mpz_size(b->z.items[i]);
+		work += work_product(work_product(size, size), b->reps);
+	}
+	if (b->threads == 0)
+		b->threads = (work >= parallel_threshold) ? rgmp_threads : 1;
+	
+	if (b->threads > 1 || RGMP_NOGVL(work)) {
+		int state = rgmp_without_gvl(z_primality_nogvl, b, &b->cp);
+		if (state)
+			rb_jump_tag(state);
+	} else {
+		for (size_t i = 0; i < b->z.count; i++)
+			z_primality_task(b, i);
+	}
+	return rb_str_new(b->results, (long) b->z.count);
+}
+
+static VALUE
+z_primality_free( VALUE p ) {
+	z_primality *b = (z_primality *) p;
+	xfree(b->results);
+	return z_items_free((VALUE) &b->z);
+}
+
+// probable_prime? for every element of an Array, packed into a String of
+// one byte per element: 0 for composites, 1 for probable primes and 2 for
+// certain ones (String#unpack's "C*"). Small factors are sieved out first,
+// and the Miller-Rabin rounds run on several threads for large batches.
+// {Array <GMP::Integer, Fixnum, Bignum>}, {Fixnum}, threads: {Fixnum} -> {String}
+VALUE
+z_probable_primes_singleton( int argc, VALUE *argv, VALUE klass ) {
+	VALUE array, reps, options;
+	rb_scan_args(argc, argv, "2:", &array, &reps, &options);
+	Check_Type(array, T_ARRAY);
+	
+	z_primality b;
+	memset(&b, 0, sizeof(b));
+	b.z.array = array;
+	b.reps = NUM2INT(reps);
+	b.threads = rgmp_threads_option(options, 0);
+	
+	return rb_ensure(z_primality_run, (VALUE) &b, z_primality_free, (VALUE) &b);
+}
+
+// Baillie-PSW primality test of the absolute value: a single strong base-2
+// Miller-Rabin round and a strong Lucas test, instead of probable_prime?'s
+// reps rounds. Exact below 2^64 (where words take a deterministic set of
+// Miller-Rabin bases instead), with no known counterexample above.
+// {} -> {TrueClass, FalseClass}
+VALUE
+z_prime( VALUE self ) {
+	mpz_t *i;
+	TypedData_Get_Struct(self, mpz_t, &integer_type, i);
+	return z_bpsw_value(*i);
+}
+
+// prime? for any integer, Fixnums staying off GMP altogether
+// {GMP::Integer, Fixnum, Bignum} -> {TrueClass, FalseClass}
+VALUE
+z_prime_singleton( VALUE klass, VALUE n ) {
+	switch (operand_kind(n)) {
+	case OPERAND_FIXNUM: {
+		long l = FIX2LONG(n);
+#ifdef Z_WORD_PRIMES
+		return z_word_prime((l < 0) ? -(unsigned long) l : (unsigned long) l) ? Qtrue : Qfalse;
+#else
+		mpz_t z;
+		mp_limb_t limb;
+		return z_bpsw_value(long2mpz(z, &limb, l));
+#endif
+	}
+	case OPERAND_INTEGER:
+		return z_bpsw_value(MPZ_OF(n));
+	case OPERAND_BIGNUM: {
+		mpz_t *z;
+		VALUE integer = integer_create(&z);
+		integral2mpz(*z, n);
+		VALUE result = z_bpsw_value(*z);
+		RB_GC_GUARD(integer);
+		return result;
+	}
+	default:
+		rb_raise(rb_eTypeError, "input data type not supported");
+	}
+}
+//// end of primality
+////////////////////////////////////////////////////////////////////
+
 void
 Init_gmpz() {
 	// Defines the module GMP and class GMP::Integer
@@ -2195,11 +4145,41 @@ Init_gmpz() {
 	rb_define_method(cGMPInteger, "addmul", z_addmul_inplace, 2);
 	rb_define_method(cGMPInteger, "submul", z_submul_inplace, 2);
 	
+	// Three-address methods
+	rb_define_method(cGMPInteger, "set", z_set, 1);
+	rb_define_method(cGMPInteger, "set_add", z_set_add, 2);
+	rb_define_method(cGMPInteger, "set_sub", z_set_sub, 2);
+	rb_define_method(cGMPInteger, "set_mul", z_set_mul, 2);
+	rb_define_method(cGMPInteger, "set_div", z_set_div, 2);
+	rb_define_method(cGMPInteger, "set_tdiv", z_set_tdiv_q, 2);
+	rb_define_method(cGMPInteger, "set_cdiv", z_set_cdiv_q, 2);
+	rb_define_method(cGMPInteger, "set_mod", z_set_mod, 2);
+	rb_define_method(cGMPInteger, "set_fmod", z_set_fdiv_r, 2);
+	rb_define_method(cGMPInteger, "set_tmod", z_set_tdiv_r, 2);
+	rb_define_method(cGMPInteger, "set_cmod", z_set_cdiv_r, 2);
+	rb_define_method(cGMPInteger, "set_divexact", z_set_divexact, 2);
+	rb_define_method(cGMPInteger, "set_divmod", z_set_divmod, 3);
+	rb_define_method(cGMPInteger, "set_pow", z_set_pow, 2);
+	rb_define_method(cGMPInteger, "set_powmod", z_set_powmod, 3);
+	rb_define_method(cGMPInteger, "set_lshift", z_set_lshift, 2);
+	rb_define_method(cGMPInteger, "set_rshift", z_set_rshift, 2);
+	rb_define_method(cGMPInteger, "set_and", z_set_and, 2);
+	rb_define_method(cGMPInteger, "set_ior", z_set_ior, 2);
+	rb_define_method(cGMPInteger, "set_xor", z_set_xor, 2);
+	rb_define_method(cGMPInteger, "set_gcd", z_set_gcd, 2);
+	rb_define_method(cGMPInteger, "set_lcm", z_set_lcm, 2);
+	rb_define_method(cGMPInteger, "set_sqrt", z_set_sqrt, 1);
+	rb_define_method(cGMPInteger, "set_root", z_set_root, 2);
+	rb_define_method(cGMPInteger, "set_neg", z_set_neg, 1);
+	rb_define_method(cGMPInteger, "set_abs", z_set_abs, 1);
+	rb_define_method(cGMPInteger, "set_com", z_set_com, 1);
+	
 	// Question-like methods
 	rb_define_method(cGMPInteger, "divisible_by?", z_divisible, 1);
 	rb_define_method(cGMPInteger, "perfect_power?", z_perfect_power, 0);
 	rb_define_method(cGMPInteger, "perfect_square?", z_perfect_square, 0);
 	rb_define_method(cGMPInteger, "probable_prime?", z_probable_prime, 1);
+	rb_define_method(cGMPInteger, "prime?", z_prime, 0);
 	rb_define_method(cGMPInteger, "even?", z_even, 0);
 	rb_define_method(cGMPInteger, "odd?", z_odd, 0);
 	rb_define_method(cGMPInteger, "eql?", z_precise_equality, 1);
@@ -2217,22 +4197,32 @@ Init_gmpz() {
 	
 	// Singletons/Class methods
 	rb_define_singleton_method(cGMPInteger, "powermod", z_powermod, 3);
+	rb_define_singleton_method(cGMPInteger, "multi_powermod", z_multi_powermod_singleton, 2);
 	rb_define_singleton_method(cGMPInteger, "sqrt", z_sqrt_singleton, 1);
 	rb_define_singleton_method(cGMPInteger, "root", z_root_singleton, 2);
 	rb_define_singleton_method(cGMPInteger, "fib", z_fibonacci_singleton, 1);
 	rb_define_singleton_method(cGMPInteger, "fib2", z_fibonacci2_singleton, 1);
 	rb_define_singleton_method(cGMPInteger, "luc", z_lucas_singleton, 1);
 	rb_define_singleton_method(cGMPInteger, "luc2", z_lucas2_singleton, 1);
-	rb_define_singleton_method(cGMPInteger, "fac", z_factorial_singleton, 1);
-	rb_define_singleton_method(cGMPInteger, "bin", z_binomial_singleton, 2);
+	rb_define_singleton_method(cGMPInteger, "fac", z_factorial_singleton, -1);
+	rb_define_singleton_method(cGMPInteger, "bin", z_binomial_singleton, -1);
+	rb_define_singleton_method(cGMPInteger, "primorial", z_primorial_singleton, -1);
 	rb_define_singleton_method(cGMPInteger, "remove", z_remove_singleton, 2);
 	rb_define_singleton_method(cGMPInteger, "cmpabs", z_comp_abs_singleton, 2);
 	rb_define_singleton_method(cGMPInteger, "invert", z_invert_singleton, 2);
+	rb_define_singleton_method(cGMPInteger, "batch_invert", z_batch_invert_singleton, 2);
+	rb_define_singleton_method(cGMPInteger, "batch_gcd", z_batch_gcd_singleton, -1);
+	rb_define_singleton_method(cGMPInteger, "mod_many", z_mod_many_singleton, -1);
+	rb_define_singleton_method(cGMPInteger, "probable_primes", z_probable_primes_singleton, -1);
+	rb_define_singleton_method(cGMPInteger, "prime?", z_prime_singleton, 1);
 	rb_define_singleton_method(cGMPInteger, "lcm", z_lcm_singleton, 2);
 	rb_define_singleton_method(cGMPInteger, "gcd", z_gcd_singleton, 2);
 	rb_define_singleton_method(cGMPInteger, "jacobi", z_jacobi_singleton, 2);
 	rb_define_singleton_method(cGMPInteger, "kronecker", z_kronecker, 2);
 	rb_define_singleton_method(cGMPInteger, "xgcd", z_extended_gcd, 2);
+	rb_define_singleton_method(cGMPInteger, "parallel_mul", z_parallel_mul_singleton, -1);
+	rb_define_singleton_method(cGMPInteger, "product", z_product_singleton, -1);
+	rb_define_singleton_method(cGMPInteger, "sum", z_sum_singleton, 1);
 	
 	// Aliases
 	rb_define_alias(cGMPInteger, "modulo", "%");
@@ -2242,4 +4232,7 @@ Init_gmpz() {
 	rb_define_alias(cGMPInteger, "not", "com");
 	// Whether or not this is a good idea is debatable, but for now...
 	rb_define_singleton_method(cGMPInteger, "legendre", z_jacobi_singleton, 2);
+	
+	// Small primes for trial division
+	z_sieve_init();
 }
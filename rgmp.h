@@ -24,8 +24,125 @@
 #include "mpf2mpfr.h"
 #endif
 
-extern VALUE mGMP;
+extern VALUE mGMP, mGMPPrimes;
 extern VALUE cGMPInteger, cGMPRational, cGMPFloat;
+extern VALUE cGMPModulus, cGMPModInt, cGMPPowmTable, cGMPCRTBasis;
+extern VALUE eGMPDeadlineExceeded;
+
+
+/* Shared helpers */
+
+// All three classes are TypedData objects. When the interpreter supports it,
+// the GMP struct is embedded in the Ruby object itself, saving one malloc
+// and one pointer chase per value.
+// The structs hold no references to Ruby objects, so the types are trivially
+// write-barrier protected (i.e. not "shady": old-generation GMP numbers never
+// land in the remembered set) and need neither dmark nor dcompact to be moved
+// by GC.compact.
+#ifdef TYPED_DATA_EMBEDDED
+#define RGMP_TYPED_FLAGS (RUBY_TYPED_FREE_IMMEDIATELY | RUBY_TYPED_WB_PROTECTED | RUBY_TYPED_EMBEDDABLE)
+#else
+#define RGMP_TYPED_FLAGS (RUBY_TYPED_FREE_IMMEDIATELY | RUBY_TYPED_WB_PROTECTED)
+#endif
+
+extern const rb_data_type_t integer_type, rational_type, float_type;
+
+// Ruby Integer <-> GMP conversions (limb-level, no string round-trips)
+extern void num2mpz(mpz_t, VALUE);
+extern VALUE mpz2num(mpz_t);
+extern void num2mpf(mpf_t, VALUE);
+
+// Instrumentation counters, compiled in with 'ruby extconf.rb --with-stats'
+// and read through GMP.stats (see gmp.c). Counts are attributed to the Ruby
+// method being run when they happen.
+enum rgmp_stat {
+	STAT_OBJECTS,		// GMP objects allocated
+	STAT_TEMPORARIES,	// temporary mpz_t/mpq_t/mpf_t inits
+	STAT_STRING_CONVERSIONS,	// number <-> string conversions
+	STAT_LIMB_BYTES,	// bytes of limb memory allocated
+	STAT_COUNT
+};
+#ifdef RGMP_STATS
+extern void rgmp_count(enum rgmp_stat, size_t);
+#define RGMP_COUNT(stat, n) rgmp_count((stat), (n))
+#else
+#define RGMP_COUNT(stat, n) ((void) 0)
+#endif
+
+// Long-running kernels release the GVL when their estimated size (in limbs
+// of the operands or the result) reaches nogvl_threshold (see gmp.c)
+extern size_t nogvl_threshold;
+#define RGMP_NOGVL(work) ((size_t) (work) >= nogvl_threshold)
+
+// Cancellation state of a kernel running without the GVL; kernels that can
+// stop halfway call rgmp_poll between chunks and return early when it says so.
+// Worker threads share it: cancelled and stopped are only accessed atomically,
+// and only ever go from 0 to 1 while the kernel runs.
+typedef struct {
+	int cancelled;			// set by Ruby's unblocking function
+	int stopped;			// the kernel returned before completing
+	int has_deadline;		// the calling thread is inside GMP.with_deadline
+	double deadline;		// CLOCK_MONOTONIC seconds
+#ifdef RGMP_STATS
+	ID method;				// the method that started the kernel
+	size_t counts[STAT_COUNT];	// counted without the GVL, charged to method
+#endif
+} rgmp_checkpoint;
+extern int rgmp_poll(rgmp_checkpoint *);
+
+// Whether the kernel stopped before completing
+static inline int
+rgmp_stopped( const rgmp_checkpoint *cp ) {
+	return __atomic_load_n(&cp->stopped, __ATOMIC_ACQUIRE);
+}
+extern int rgmp_without_gvl(void *(*)(void *), void *, rgmp_checkpoint *);
+
+// Parallel kernels run their tasks on up to rgmp_threads native threads
+// (GMP.threads); operators switch to them when their operands reach
+// parallel_threshold limbs (see gmp.c)
+#define RGMP_MAX_THREADS 256
+extern unsigned rgmp_threads;
+extern size_t parallel_threshold;
+extern void rgmp_parallel_for(size_t, unsigned, void (*)(void *, size_t), void *, rgmp_checkpoint *);
+extern unsigned rgmp_options(VALUE, unsigned, const char *, VALUE *);
+extern unsigned rgmp_threads_option(VALUE, unsigned);
+
+// a * b, saturating instead of wrapping around (for size estimates)
+static inline size_t
+work_product( size_t a, size_t b ) {
+	return (b != 0 && a > SIZE_MAX / b) ? SIZE_MAX : a * b;
+}
+
+// Operand classification for the binary operators (see operand_kind in gmp.c)
+enum operand_kind {
+	OPERAND_FIXNUM,
+	OPERAND_BIGNUM,
+	OPERAND_FLOAT,
+	OPERAND_INTEGER,
+	OPERAND_RATIONAL,
+	OPERAND_GMPF,
+	OPERAND_OTHER
+};
+extern enum operand_kind operand_kind(VALUE);
+extern void integral2mpz(mpz_t, VALUE);
+
+// Direct access to the GMP struct of an object already classified by
+// operand_kind (no further type checks)
+#ifndef TYPED_DATA_EMBEDDED
+#define RTYPEDDATA_GET_DATA(obj) DATA_PTR(obj)
+#endif
+#define MPZ_OF(obj) (*(mpz_t *) RTYPEDDATA_GET_DATA(obj))
+#define MPQ_OF(obj) (*(mpq_t *) RTYPEDDATA_GET_DATA(obj))
+#define MPF_OF(obj) (*(mpf_t *) RTYPEDDATA_GET_DATA(obj))
+
+// Makes z a read-only mpz_t holding l, backed by *limb, so that Fixnums can
+// be fed to the mpz_t-only GMP functions without allocating anything.
+// z must only ever be used as an input operand.
+static inline mpz_srcptr
+long2mpz( mpz_ptr z, mp_limb_t *limb, long l ) {
+	*limb = (l < 0) ? -(unsigned long) l : (unsigned long) l;
+	return mpz_roinit_n(z, limb, (l < 0) ? -1 : (l > 0));
+}
 
 
 /* GMP::Integer method prototyping */
@@ -34,11 +151,12 @@ extern VALUE cGMPInteger, cGMPRational, cGMPFloat;
 extern void Init_gmpz();
 
 // Garbage collection
-extern void integer_mark(mpz_t*);
-extern void integer_free(mpz_t*);
+extern void integer_free(void*);
+extern size_t integer_memsize(const void*);
 
 // Object allocation
 extern VALUE integer_allocate(VALUE);
+extern VALUE integer_create(mpz_t**);
 
 // Class constructor
 extern VALUE z_init(VALUE, VALUE);
@@ -48,6 +166,84 @@ extern VALUE z_to_string(VALUE, VALUE*, VALUE);
 extern VALUE z_to_integer(VALUE);
 extern VALUE z_to_float(VALUE);
 
+// Operand dispatch
+// A binary operator, as the GMP functions to call when the other operand is
+// a mpz_t (GMP::Integer or Bignum) and when it is a Fixnum
+typedef struct {
+	void (*zz)(mpz_ptr, mpz_srcptr, mpz_srcptr);
+	void (*zl)(mpz_ptr, mpz_srcptr, long);
+	int bignums;	// Whether Bignum operands make sense at all
+	// Estimated size of the work in limbs, to decide whether to release the
+	// GVL (NULL when it is never worth it, 0 when zz/zl would raise)
+	size_t (*zz_work)(mpz_srcptr, mpz_srcptr);
+	size_t (*zl_work)(mpz_srcptr, long);
+	// Checkpointed form of zz, run instead of zz and zl without the GVL so
+	// that it can be interrupted (NULL when the operation cannot be split)
+	void (*chunked)(mpz_ptr, mpz_srcptr, mpz_srcptr, rgmp_checkpoint *);
+} z_operator;
+
+extern const z_operator z_add_op, z_sub_op, z_mul_op, z_div_op, z_mod_op,
+		z_pow_op, z_and_op, z_ior_op, z_xor_op, z_gcd_op, z_lcm_op,
+		z_tdiv_q_op, z_cdiv_q_op, z_fdiv_r_op, z_tdiv_r_op, z_cdiv_r_op,
+		z_divexact_op;
+extern void z_apply(mpz_ptr, mpz_srcptr, VALUE, const z_operator*);
+extern VALUE z_binary_operation(VALUE, VALUE, const z_operator*);
+extern int z_compare(VALUE, VALUE);
+extern void z_addmul_apply(mpz_ptr, VALUE, VALUE, int);
+extern void z_shift_apply(mpz_ptr, mpz_srcptr, VALUE, int);
+extern void z_powm_apply(mpz_ptr, mpz_srcptr, VALUE, VALUE);
+extern void z_powm_mpz(mpz_ptr, mpz_srcptr, mpz_srcptr, mpz_srcptr);
+extern void z_powm_ui(mpz_ptr, mpz_srcptr, unsigned long, mpz_srcptr);
+extern void z_product_tree(mpz_ptr, mpz_t *, size_t, unsigned);
+extern void z_mul_parallel(mpz_ptr, mpz_srcptr, mpz_srcptr, unsigned, rgmp_checkpoint *);
+
+// Product and remainder trees (see gmpz.c), shared with GMP::CRTBasis
+#define Z_TREE_MAX_HEIGHT 65
+
+typedef struct {
+	mpz_t *nodes;
+	size_t count;
+	FILE *spill;		// the nodes, written out to disk instead
+} z_tree_level;
+
+typedef struct {
+	z_tree_level level[Z_TREE_MAX_HEIGHT];
+	int height;			// levels built, leaves included
+	unsigned threads;
+	rgmp_checkpoint *cp;
+	const char *spill;	// directory to spill built levels to, or NULL
+	int error;			// errno of a failed spill (or ENOMEM)
+} z_tree;
+
+// One level's worth of tasks: above[i] = below[2i] * below[2i + 1] going up,
+// out[i] = above[i / 2] mod below[i] (or below[i]^2) going down
+typedef struct {
+	mpz_t *below, *above, *out;
+	size_t below_count;
+	unsigned threads;	// for each node
+	int square;
+	rgmp_checkpoint *cp;
+} z_tree_step;
+
+extern void z_tree_clear_nodes(mpz_t *, size_t);
+extern void z_tree_free(z_tree *);
+extern void z_tree_build(z_tree *, mpz_t *, size_t);
+extern void z_tree_remainders(z_tree *, mpz_srcptr, mpz_t *, int);
+extern void z_tree_call(z_tree *, size_t, void *(*)(void *), void *, rgmp_checkpoint *);
+
+// The private copies of an Array's elements, freed by z_items_free even
+// when loading or multiplying them raises
+typedef struct {
+	VALUE array;
+	mpz_t *items;
+	size_t count;
+	mpz_ptr r;
+	unsigned threads;
+} z_items;
+
+extern void z_items_load(z_items *, long);
+extern VALUE z_items_free(VALUE);
+
 // Binary arithmetical operators
 extern VALUE z_addition(VALUE, VALUE);
 extern VALUE z_subtraction(VALUE, VALUE);
@@ -90,11 +286,41 @@ extern VALUE z_multiplication_inplace(VALUE, VALUE);
 extern VALUE z_addmul_inplace(VALUE, VALUE, VALUE);
 extern VALUE z_submul_inplace(VALUE, VALUE, VALUE);
 
+// Three-address methods
+extern VALUE z_set(VALUE, VALUE);
+extern VALUE z_set_add(VALUE, VALUE, VALUE);
+extern VALUE z_set_sub(VALUE, VALUE, VALUE);
+extern VALUE z_set_mul(VALUE, VALUE, VALUE);
+extern VALUE z_set_div(VALUE, VALUE, VALUE);
+extern VALUE z_set_tdiv_q(VALUE, VALUE, VALUE);
+extern VALUE z_set_cdiv_q(VALUE, VALUE, VALUE);
+extern VALUE z_set_mod(VALUE, VALUE, VALUE);
+extern VALUE z_set_fdiv_r(VALUE, VALUE, VALUE);
+extern VALUE z_set_tdiv_r(VALUE, VALUE, VALUE);
+extern VALUE z_set_cdiv_r(VALUE, VALUE, VALUE);
+extern VALUE z_set_divexact(VALUE, VALUE, VALUE);
+extern VALUE z_set_divmod(VALUE, VALUE, VALUE, VALUE);
+extern VALUE z_set_pow(VALUE, VALUE, VALUE);
+extern VALUE z_set_powmod(VALUE, VALUE, VALUE, VALUE);
+extern VALUE z_set_lshift(VALUE, VALUE, VALUE);
+extern VALUE z_set_rshift(VALUE, VALUE, VALUE);
+extern VALUE z_set_and(VALUE, VALUE, VALUE);
+extern VALUE z_set_ior(VALUE, VALUE, VALUE);
+extern VALUE z_set_xor(VALUE, VALUE, VALUE);
+extern VALUE z_set_gcd(VALUE, VALUE, VALUE);
+extern VALUE z_set_lcm(VALUE, VALUE, VALUE);
+extern VALUE z_set_sqrt(VALUE, VALUE);
+extern VALUE z_set_root(VALUE, VALUE, VALUE);
+extern VALUE z_set_neg(VALUE, VALUE);
+extern VALUE z_set_abs(VALUE, VALUE);
+extern VALUE z_set_com(VALUE, VALUE);
+
 // Question-like methods
 extern VALUE z_divisible(VALUE, VALUE);
 extern VALUE z_perfect_power(VALUE);
 extern VALUE z_perfect_square(VALUE);
 extern VALUE z_probable_prime(VALUE, VALUE);
+extern VALUE z_prime(VALUE);
 extern VALUE z_even(VALUE);
 extern VALUE z_odd(VALUE);
 extern VALUE z_precise_equality(VALUE, VALUE);
@@ -112,22 +338,40 @@ extern VALUE z_coerce(VALUE, VALUE);
 
 // Singletons/Class methods
 extern VALUE z_powermod(VALUE, VALUE, VALUE, VALUE);
+extern VALUE z_multi_powermod_singleton(VALUE, VALUE, VALUE);
 extern VALUE z_sqrt_singleton(VALUE, VALUE);
 extern VALUE z_root_singleton(VALUE, VALUE, VALUE);
 extern VALUE z_fibonacci_singleton(VALUE, VALUE);
 extern VALUE z_fibonacci2_singleton(VALUE, VALUE);
 extern VALUE z_lucas_singleton(VALUE, VALUE);
 extern VALUE z_lucas2_singleton(VALUE, VALUE);
-extern VALUE z_factorial_singleton(VALUE, VALUE);
-extern VALUE z_binomial_singleton(VALUE, VALUE, VALUE);
+extern VALUE z_factorial_singleton(int, VALUE*, VALUE);
+extern VALUE z_binomial_singleton(int, VALUE*, VALUE);
+extern VALUE z_primorial_singleton(int, VALUE*, VALUE);
 extern VALUE z_remove_singleton(VALUE, VALUE, VALUE);
 extern VALUE z_comp_abs_singleton(VALUE, VALUE, VALUE);
 extern VALUE z_invert_singleton(VALUE, VALUE, VALUE);
+extern VALUE z_batch_invert_singleton(VALUE, VALUE, VALUE);
+extern VALUE z_batch_gcd_singleton(int, VALUE*, VALUE);
+extern VALUE z_mod_many_singleton(int, VALUE*, VALUE);
+extern VALUE z_probable_primes_singleton(int, VALUE*, VALUE);
+extern VALUE z_prime_singleton(VALUE, VALUE);
 extern VALUE z_lcm_singleton(VALUE, VALUE, VALUE);
 extern VALUE z_gcd_singleton(VALUE, VALUE, VALUE);
 extern VALUE z_jacobi_singleton(VALUE, VALUE, VALUE);
 extern VALUE z_kronecker(VALUE, VALUE, VALUE);
 extern VALUE z_extended_gcd(VALUE, VALUE, VALUE);
+extern VALUE z_parallel_mul_singleton(int, VALUE*, VALUE);
+extern VALUE z_product_singleton(int, VALUE*, VALUE);
+extern VALUE z_sum_singleton(VALUE, VALUE);
+
+// Primality tests (see gmpz.c), shared with GMP::Primes
+#define Z_TRIAL_LIMIT 65536
+#if defined(__SIZEOF_INT128__) && GMP_NUMB_BITS == 64
+#define Z_WORD_PRIMES 1
+extern int z_word_prime(unsigned long);
+#endif
+extern int z_bpsw_test(mpz_srcptr);
 
 
 
@@ -137,11 +381,12 @@ extern VALUE z_extended_gcd(VALUE, VALUE, VALUE);
 extern void Init_gmpq();
 
 // Garbage collection
-extern void rational_mark(mpq_t*);
-extern void rational_free(mpq_t*);
+extern void rational_free(void*);
+extern size_t rational_memsize(const void*);
 
 // Object allocation
 extern VALUE rational_allocate(VALUE);
+extern VALUE rational_create(mpq_t**);
 
 // Class constructor
 extern VALUE q_init(VALUE, VALUE);
@@ -153,6 +398,20 @@ extern VALUE q_to_gmpz(VALUE);
 extern VALUE q_to_gmpq(VALUE);
 extern VALUE q_to_gmpf(VALUE);
 
+// Operand dispatch
+// A binary operator, as the GMP functions to call when the other operand is
+// a mpq_t, a mpz_t (GMP::Integer or Bignum) and a Fixnum
+typedef struct {
+	void (*qq)(mpq_ptr, mpq_srcptr, mpq_srcptr);
+	void (*qz)(mpq_ptr, mpq_srcptr, mpz_srcptr);
+	void (*ql)(mpq_ptr, mpq_srcptr, long);
+} q_operator;
+
+extern const q_operator q_add_op, q_sub_op, q_mul_op, q_div_op;
+extern void q_apply(mpq_ptr, mpq_srcptr, VALUE, const q_operator*);
+extern VALUE q_binary_operation(VALUE, VALUE, const q_operator*);
+extern int q_compare(VALUE, VALUE);
+
 // Binary arithmetical
 extern VALUE q_addition(VALUE, VALUE);
 extern VALUE q_subtraction(VALUE, VALUE);
@@ -171,6 +430,17 @@ extern VALUE q_greater_than_or_equal_to_test(VALUE, VALUE);
 extern VALUE q_less_than_or_equal_to_test(VALUE, VALUE);
 extern VALUE q_generic_comparison(VALUE, VALUE);
 
+// In-place methods
+extern VALUE q_addition_inplace(VALUE, VALUE);
+extern VALUE q_subtraction_inplace(VALUE, VALUE);
+extern VALUE q_multiplication_inplace(VALUE, VALUE);
+extern VALUE q_division_inplace(VALUE, VALUE);
+extern VALUE q_negation_inplace(VALUE);
+extern VALUE q_absolute_inplace(VALUE);
+extern VALUE q_invert_inplace(VALUE);
+extern VALUE q_addmul_inplace(VALUE, VALUE, VALUE);
+extern VALUE q_submul_inplace(VALUE, VALUE, VALUE);
+
 // Other operations
 extern VALUE q_swap(VALUE, VALUE);
 extern VALUE q_sign(VALUE);
@@ -178,6 +448,10 @@ extern VALUE q_absolute(VALUE);
 extern VALUE q_invert(VALUE);
 extern VALUE q_coerce(VALUE, VALUE);
 
+// Reductions over Arrays
+extern VALUE q_product_singleton(int, VALUE*, VALUE);
+extern VALUE q_sum_singleton(VALUE, VALUE);
+
 
 /* GMP::Float method prototyping */
 
@@ -185,11 +459,12 @@ extern VALUE q_coerce(VALUE, VALUE);
 extern void Init_gmpf();
 
 // Garbage collection
-extern void float_mark(mpf_t*);
-extern void float_free(mpf_t*);
+extern void float_free(void*);
+extern size_t float_memsize(const void*);
 
 // Object allocation
 extern VALUE float_allocate(VALUE);
+extern VALUE float_create(mpf_t**);
 
 // Class constructor
 extern VALUE f_init(VALUE, VALUE*, VALUE);
@@ -198,6 +473,23 @@ extern VALUE f_init(VALUE, VALUE*, VALUE);
 extern VALUE f_to_string(VALUE);
 extern VALUE f_to_float(VALUE);
 
+// Operand dispatch
+// A binary operator, as the functions to call when the other operand is a
+// mpf_t, a Fixnum, a Float, a mpz_t (GMP::Integer or Bignum) and a mpq_t.
+// NULL entries go through a temporary mpf_t (see f_apply in gmpf.c).
+typedef struct {
+	void (*ff)(mpf_ptr, mpf_srcptr, mpf_srcptr);
+	void (*fl)(mpf_ptr, mpf_srcptr, long);
+	void (*fd)(mpf_ptr, mpf_srcptr, double);
+	void (*fz)(mpf_ptr, mpf_srcptr, mpz_srcptr);
+	void (*fq)(mpf_ptr, mpf_srcptr, mpq_srcptr);
+} f_operator;
+
+extern const f_operator f_add_op, f_sub_op, f_mul_op, f_div_op, f_pow_op;
+extern void f_apply(mpf_ptr, mpf_srcptr, VALUE, const f_operator*);
+extern VALUE f_binary_operation(VALUE, VALUE, const f_operator*);
+extern int f_compare(VALUE, VALUE);
+
 // Binary arithmetical operators
 extern VALUE f_addition(VALUE, VALUE);
 extern VALUE f_subtraction(VALUE, VALUE);
@@ -233,12 +525,25 @@ extern VALUE f_absolute(VALUE);
 extern VALUE f_relative_difference(VALUE, VALUE);
 extern VALUE f_coerce(VALUE, VALUE);
 
+// In-place methods
+extern VALUE f_addition_inplace(VALUE, VALUE);
+extern VALUE f_subtraction_inplace(VALUE, VALUE);
+extern VALUE f_multiplication_inplace(VALUE, VALUE);
+extern VALUE f_division_inplace(VALUE, VALUE);
+extern VALUE f_negation_inplace(VALUE);
+extern VALUE f_absolute_inplace(VALUE);
+extern VALUE f_sqrt_inplace(int, VALUE*, VALUE);
+
 // Singletons/Class methods
 extern VALUE f_set_def_prec(VALUE, VALUE);
 extern VALUE f_get_def_prec(VALUE);
 extern VALUE f_sqrt_singleton(VALUE, VALUE);
 
 #ifdef MPFR
+// Special functions without the GVL
+typedef int (*f_function)(mpfr_ptr, mpfr_srcptr, mpfr_rnd_t);
+extern void f_function_apply(f_function, mpfr_ptr, mpfr_srcptr);
+
 // Question-like methods
 extern VALUE f_nan(VALUE);
 extern VALUE f_inf(VALUE);
@@ -316,4 +621,134 @@ extern VALUE f_expm1(VALUE, VALUE);
 extern VALUE f_maximum_of_two(VALUE, VALUE, VALUE);
 extern VALUE f_minimum_of_two(VALUE, VALUE, VALUE);
 extern VALUE f_fractional(VALUE);
+
+// In-place functions
+extern VALUE f_fma_inplace(VALUE, VALUE, VALUE);
+extern VALUE f_fms_inplace(VALUE, VALUE, VALUE);
+extern VALUE f_sine_inplace(int, VALUE*, VALUE);
+extern VALUE f_cossine_inplace(int, VALUE*, VALUE);
+extern VALUE f_tangent_inplace(int, VALUE*, VALUE);
+extern VALUE f_cotangent_inplace(int, VALUE*, VALUE);
+extern VALUE f_secant_inplace(int, VALUE*, VALUE);
+extern VALUE f_cosecant_inplace(int, VALUE*, VALUE);
+extern VALUE f_hsine_inplace(int, VALUE*, VALUE);
+extern VALUE f_hcossine_inplace(int, VALUE*, VALUE);
+extern VALUE f_htangent_inplace(int, VALUE*, VALUE);
+extern VALUE f_hcotangent_inplace(int, VALUE*, VALUE);
+extern VALUE f_hsecant_inplace(int, VALUE*, VALUE);
+extern VALUE f_hcosecant_inplace(int, VALUE*, VALUE);
+extern VALUE f_asine_inplace(int, VALUE*, VALUE);
+extern VALUE f_acossine_inplace(int, VALUE*, VALUE);
+extern VALUE f_atangent_inplace(int, VALUE*, VALUE);
+extern VALUE f_ahsine_inplace(int, VALUE*, VALUE);
+extern VALUE f_ahcossine_inplace(int, VALUE*, VALUE);
+extern VALUE f_ahtangent_inplace(int, VALUE*, VALUE);
+extern VALUE f_logn_inplace(int, VALUE*, VALUE);
+extern VALUE f_log2_inplace(int, VALUE*, VALUE);
+extern VALUE f_log10_inplace(int, VALUE*, VALUE);
+extern VALUE f_log1p_inplace(int, VALUE*, VALUE);
+extern VALUE f_exp_inplace(int, VALUE*, VALUE);
+extern VALUE f_exp2_inplace(int, VALUE*, VALUE);
+extern VALUE f_exp10_inplace(int, VALUE*, VALUE);
+extern VALUE f_expm1_inplace(int, VALUE*, VALUE);
+extern VALUE f_bessel_first_0_inplace(int, VALUE*, VALUE);
+extern VALUE f_bessel_first_1_inplace(int, VALUE*, VALUE);
+extern VALUE f_bessel_second_0_inplace(int, VALUE*, VALUE);
+extern VALUE f_bessel_second_1_inplace(int, VALUE*, VALUE);
+extern VALUE f_exp_integral_inplace(int, VALUE*, VALUE);
+extern VALUE f_dilogarithm_inplace(int, VALUE*, VALUE);
+extern VALUE f_gamma_inplace(int, VALUE*, VALUE);
+extern VALUE f_lngamma_inplace(int, VALUE*, VALUE);
+extern VALUE f_zeta_inplace(int, VALUE*, VALUE);
+extern VALUE f_error_function_inplace(int, VALUE*, VALUE);
+extern VALUE f_error_function_comp_inplace(int, VALUE*, VALUE);
+extern VALUE f_rec_sqrt_inplace(int, VALUE*, VALUE);
+extern VALUE f_cube_root_inplace(int, VALUE*, VALUE);
 #endif
+
+
+/* GMP::Modulus, GMP::ModInt and GMP::PowmTable method prototyping */
+
+// Initialization function
+extern void Init_gmpmod();
+
+// Object allocation
+extern VALUE modulus_allocate(VALUE);
+extern VALUE modint_allocate(VALUE);
+
+// Class constructors
+extern VALUE mod_init(VALUE, VALUE);
+extern VALUE mi_init(VALUE, VALUE, VALUE);
+
+// GMP::Modulus methods
+extern VALUE mod_residue(VALUE, VALUE);
+extern VALUE mod_modulus(VALUE);
+extern VALUE mod_to_string(VALUE);
+
+// Conversion methods
+extern VALUE mi_to_integer(VALUE);
+extern VALUE mi_to_gmpz(VALUE);
+extern VALUE mi_to_string(VALUE);
+extern VALUE mi_inspect(VALUE);
+extern VALUE mi_modulus(VALUE);
+
+// Arithmetical operators
+extern VALUE mi_addition(VALUE, VALUE);
+extern VALUE mi_subtraction(VALUE, VALUE);
+extern VALUE mi_multiplication(VALUE, VALUE);
+extern VALUE mi_division(VALUE, VALUE);
+extern VALUE mi_power(VALUE, VALUE);
+extern VALUE mi_negation(VALUE);
+extern VALUE mi_inverse(VALUE);
+
+// Comparisons
+extern VALUE mi_equality_test(VALUE, VALUE);
+extern VALUE mi_zero(VALUE);
+extern VALUE mi_coerce(VALUE, VALUE);
+
+// In-place methods
+extern VALUE mi_addition_inplace(VALUE, VALUE);
+extern VALUE mi_subtraction_inplace(VALUE, VALUE);
+extern VALUE mi_multiplication_inplace(VALUE, VALUE);
+extern VALUE mi_division_inplace(VALUE, VALUE);
+extern VALUE mi_power_inplace(VALUE, VALUE);
+extern VALUE mi_negation_inplace(VALUE);
+extern VALUE mi_inverse_inplace(VALUE);
+
+// GMP::PowmTable methods
+extern VALUE powm_table_allocate(VALUE);
+extern VALUE pt_init(VALUE, VALUE, VALUE, VALUE);
+extern VALUE pt_pow(VALUE, VALUE);
+extern VALUE pt_pow_many(int, VALUE*, VALUE);
+extern VALUE pt_modulus(VALUE);
+extern VALUE pt_max_bits(VALUE);
+
+
+/* GMP::CRTBasis method prototyping */
+
+// Initialization function
+extern void Init_gmpcrt();
+
+// Object allocation
+extern VALUE crt_basis_allocate(VALUE);
+
+// Class constructor
+extern VALUE crt_basis_init(int, VALUE*, VALUE);
+
+// GMP::CRTBasis methods
+extern VALUE crt_basis_crt(int, VALUE*, VALUE);
+extern VALUE crt_basis_modulus(VALUE);
+extern VALUE crt_basis_size(VALUE);
+
+// Singletons/Class methods
+extern VALUE z_crt_singleton(int, VALUE*, VALUE);
+
+
+/* GMP::Primes method prototyping */
+
+// Initialization function
+extern void Init_gmpprimes();
+
+// GMP::Primes methods
+extern VALUE primes_each(int, VALUE*, VALUE);
+extern VALUE primes_count(int, VALUE*, VALUE);